@@ -0,0 +1,112 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_allan.h
+ * @brief Public header file for the ICM20948 streaming Allan deviation estimator.
+ *
+ * The estimator computes the fully overlapping Allan variance of one axis at the
+ * octave cluster sizes m = 1, 2, 4 ... 2^(taus - 1) in a single pass. It keeps a
+ * ring of exact int64 cumulative sums covering the largest cluster, so every sample
+ * costs O(taus) and a whole recording costs O(n log n).
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_ALLAN_H_
+#define _ICM20948_ALLAN_H_
+
+#include <stdint.h>
+#include "icm20948_api.h"
+
+#define ICM20948_ALLAN_MAX_TAUS             (32)
+
+typedef struct {
+    int64_t *hist;
+    uint8_t taus;
+    uint64_t k;
+    int64_t cum;
+    double sum_sq[ICM20948_ALLAN_MAX_TAUS];
+    uint64_t terms[ICM20948_ALLAN_MAX_TAUS];
+} icm20948_allan_t;
+
+typedef struct {
+    double arw;                 // Random walk coefficient N, units/sqrt(Hz), from the -1/2 slope region
+    double bias_instability;    // Bias instability B, units, from the flat region
+    double tau_bias;            // Cluster time where the bias instability was found, s
+    double rrw;                 // Rate random walk K, units*sqrt(Hz), from the +1/2 slope region, 0 if not seen
+} icm20948_allan_coeff_t;
+
+/*!
+ * @brief This API initializes an Allan deviation estimator for one axis
+ *
+ * @param[in] est: Pointer to the estimator to be initialized
+ * @param[in] hist: Pointer to caller owned storage for 2^taus cumulative sums
+ * @param[in] taus: Number of octave cluster sizes to estimate
+ *
+ * @return Returns the status of initialization
+ */
+icm20948_return_code_t icm20948_allanInit(icm20948_allan_t *est, int64_t *hist, uint8_t taus);
+
+/*!
+ * @brief This API feeds a contiguous run of raw samples of one axis to the estimator
+ *
+ * @param[in] est: Pointer to the estimator
+ * @param[in] data: Pointer to the raw samples
+ * @param[in] len: Number of samples
+ *
+ * @return Returns the status of adding the samples
+ */
+icm20948_return_code_t icm20948_allanAdd(icm20948_allan_t *est, const int16_t *data, uint32_t len);
+
+/*!
+ * @brief This API retrieves the overlapping Allan deviation at cluster size 2^idx
+ *
+ * @param[in] est: Pointer to the estimator
+ * @param[in] idx: Cluster size index
+ *
+ * @return Returns the Allan deviation in LSB, or 0 if the recording is too short
+ */
+double icm20948_allanDeviation(const icm20948_allan_t *est, uint8_t idx);
+
+/*!
+ * @brief This API extracts the standard noise coefficients from an Allan deviation curve
+ * using the slope method of IEEE Std 952
+ *
+ * @param[in] tau: Pointer to the cluster times, ascending, in s
+ * @param[in] adev: Pointer to the Allan deviations at those cluster times
+ * @param[in] count: Number of points on the curve
+ * @param[out] coeff: Pointer to where the coefficients should be placed
+ *
+ * @return Returns the status of extracting the coefficients
+ */
+icm20948_return_code_t icm20948_allanCoefficients(const double *tau, const double *adev, uint8_t count, icm20948_allan_coeff_t *coeff);
+
+#endif // _ICM20948_ALLAN_H_
+
+#ifdef __cplusplus
+}
+#endif
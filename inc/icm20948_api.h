@@ -35,10 +35,14 @@ extern "C" {
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "icm20948_config.h"
+
+#define ICM20948_BURST_SIZE                 (12)
 
 typedef int8_t(*icm20948_read_fptr_t)(const uint8_t addr, uint8_t *data, const uint32_t len);
 typedef int8_t(*icm20948_write_fptr_t)(const uint8_t addr, const uint8_t *data, const uint32_t len);
 typedef void(*icm20948_delay_us_fptr_t)(uint32_t period);
+typedef void(*icm20948_lock_fptr_t)(void *ctx);
 
 typedef enum {
     ICM20948_RET_OK = 0,
@@ -82,12 +86,35 @@ typedef struct {
     icm20948_mod_enable_t en;
 } icm20948_mag_settings_t;
 
+typedef enum {
+    ICM20948_MOUNT_IDENTITY = 0x00,
+    ICM20948_MOUNT_SIGNED_PERM = 0x01,
+    ICM20948_MOUNT_MATRIX = 0x02
+} icm20948_mount_type_t;
+
+/*! @brief Board mounting transform taking chip axes to board axes. A zeroed
+ * struct is the identity. For ICM20948_MOUNT_SIGNED_PERM board axis i is
+ * sign[i] * chip axis perm[i]; for ICM20948_MOUNT_MATRIX board = m * chip. */
+typedef struct {
+    icm20948_mount_type_t type;
+    uint8_t perm[3];
+    int8_t sign[3];
+    float m[3][3];
+} icm20948_mount_t;
+
 typedef struct {
     icm20948_gyro_settings_t gyro;
     icm20948_accel_settings_t accel;
     icm20948_mag_settings_t mag;
+    icm20948_mount_t mount;
 } icm20948_settings_t;
 
+typedef enum {
+    ICM20948_SENSOR_ACCEL = 0x00,
+    ICM20948_SENSOR_GYRO = 0x01,
+    ICM20948_SENSOR_MAG = 0x02
+} icm20948_sensor_t;
+
 typedef struct {
     int16_t x;
     int16_t y;
@@ -106,6 +133,60 @@ typedef struct {
     int16_t z;
 } icm20948_mag_t;
 
+/*! @brief Block of 3-axis samples stored as a structure of arrays, so each
+ * axis can be swept as one contiguous run */
+typedef struct {
+    int16_t *x;
+    int16_t *y;
+    int16_t *z;
+    uint32_t len;
+} icm20948_block_t;
+
+/*! @brief Block of 3-axis scaled samples stored as a structure of arrays */
+typedef struct {
+    float *x;
+    float *y;
+    float *z;
+    uint32_t len;
+} icm20948_fblock_t;
+
+/*! @brief Sensors carried by each FIFO frame, accel first. Captured when frames are
+ * drained so they can be unpacked later whatever the FIFO is configured for by then. */
+typedef struct {
+    bool accel;
+    bool gyro;
+} icm20948_fifo_layout_t;
+
+#if ICM20948_FEATURE_VERIFY
+/*! @brief Verify-after-write counters */
+typedef struct {
+    uint32_t flushes;           // Configuration flushes verified
+    uint32_t readbacks;         // Readback bursts
+    uint32_t mismatches;        // Registers that read back differently from the shadow
+    uint32_t rewrites;          // Registers written again after a mismatch
+    uint32_t failures;          // Flushes that still mismatched after every retry
+} icm20948_verify_stats_t;
+#endif
+
+#if ICM20948_FEATURE_INSTRUMENTATION
+/*! @brief Bus activity counters, bytes include the address byte of each transfer */
+typedef struct {
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t bytes;
+    uint32_t bank_switches;
+    uint32_t errors;
+} icm20948_bus_stats_t;
+#endif
+
+/*! @brief Unit quaternion, Hamilton convention, rotating body frame vectors into the world frame */
+typedef struct {
+    float w;
+    float x;
+    float y;
+    float z;
+} icm20948_quat_t;
+
 /*!
  * @brief This API initializes the ICM20948 comms interface, and then does a read from the device
  * to verify working comms
@@ -118,8 +199,27 @@ typedef struct {
  */
 icm20948_return_code_t icm20948_init(icm20948_read_fptr_t r, icm20948_write_fptr_t w, icm20948_delay_us_fptr_t delay);
 
+#if ICM20948_FEATURE_LOCK
+/*!
+ * @brief This API installs the developers lock hooks, which makes the driver safe to call
+ * from several threads, e.g. reading samples in one and reconfiguring in another. The
+ * lock is held only around each bank select and the bus transfers and register shadow
+ * updates that depend on it; decoding and scaling run outside it. Pass NULL for both to
+ * run without locking, the default. Install the hooks before the threads start.
+ *
+ * @param[in] lock: Function pointer to the developers lock function, e.g. a mutex take or
+ * an interrupt mask. It is not called recursively.
+ * @param[in] unlock: Function pointer to the developers unlock function
+ * @param[in] ctx: Context handed back to the hooks
+ *
+ * @return Returns the status of installing the hooks
+ */
+icm20948_return_code_t icm20948_setLockHooks(icm20948_lock_fptr_t lock, icm20948_lock_fptr_t unlock, void *ctx);
+#endif
+
 /*!
- * @brief This API applys the developers settings for configuring the ICM20948 components
+ * @brief This API applys the developers settings for configuring the ICM20948 components.
+ * The mounting transform is validated first, and nothing is applied if it is invalid.
  *
  * @param[in] newSettings: Pointer to the new ICM20948 settings to be applied
  *
@@ -127,6 +227,18 @@ icm20948_return_code_t icm20948_init(icm20948_read_fptr_t r, icm20948_write_fptr
  */
 icm20948_return_code_t icm20948_applySettings(icm20948_settings_t *newSettings);
 
+/*!
+ * @brief This API applys settings as icm20948_applySettings does, for a chip fresh out of
+ * power-on reset: registers whose new value equals their reset value, e.g. sample rate
+ * dividers of 0, are not written. Use icm20948_applySettings once the chip may have been
+ * configured since reset.
+ *
+ * @param[in] newSettings: Pointer to the new ICM20948 settings to be applied
+ *
+ * @return Returns the status of applying settings
+ */
+icm20948_return_code_t icm20948_applySettingsFromReset(icm20948_settings_t *newSettings);
+
 /*!
  * @brief This API retrieves the current gyro data from the device
  *
@@ -147,6 +259,270 @@ icm20948_return_code_t icm20948_getGyroData(icm20948_gyro_t *gyro);
  */
 icm20948_return_code_t icm20948_getAccelData(icm20948_accel_t *accel);
 
+/*!
+ * @brief This API reads the accel and gyro output registers in one transfer straight into
+ * the caller's buffer. The driver's register shadow is not touched, so reads into
+ * different buffers can run from several threads (with lock hooks) or be double
+ * buffered. The buffer holds accel X/Y/Z then gyro X/Y/Z, big-endian, as on the bus.
+ *
+ * @param[out] buf: Pointer to ICM20948_BURST_SIZE bytes
+ *
+ * @return Returns the status of reading the burst
+ */
+icm20948_return_code_t icm20948_readBurst(uint8_t *buf);
+
+/*!
+ * @brief This API decodes a burst buffer into one slot of raw sample blocks, as raw
+ * counts in the sensor frame ready for icm20948_convertBlock
+ *
+ * @param[in] buf: Pointer to the ICM20948_BURST_SIZE bytes read by icm20948_readBurst
+ * @param[in,out] accel: Pointer to the raw accel block, or NULL to skip accel. len is the
+ * block capacity and is not changed.
+ * @param[in,out] gyro: Pointer to the raw gyro block, or NULL to skip gyro
+ * @param[in] idx: Slot of the blocks to write
+ *
+ * @return Returns the status of decoding the burst
+ */
+icm20948_return_code_t icm20948_decodeBurst(const uint8_t *buf, icm20948_block_t *accel, icm20948_block_t *gyro, uint32_t idx);
+
+/*!
+ * @brief This API reads one accel and gyro sample in a single burst and converts it
+ * into the caller's buffers, in board frame g and dps as icm20948_convertBlock does
+ *
+ * @param[out] accel: Pointer to 3 floats for accel X/Y/Z, or NULL to skip accel
+ * @param[out] gyro: Pointer to 3 floats for gyro X/Y/Z, or NULL to skip gyro
+ *
+ * @return Returns the status of reading the sample
+ */
+icm20948_return_code_t icm20948_readScaled(float *accel, float *gyro);
+
+/*!
+ * @brief This API sets the gyro and accel sample rate dividers. The new dividers take
+ * effect on the next call to icm20948_applySettings. Output data rate is
+ * 1125Hz / (1 + div), and both dividers default to 0x0A (~102Hz).
+ *
+ * @param[in] gyroDiv: Gyro sample rate divider
+ * @param[in] accelDiv: Accel sample rate divider (12 bits)
+ *
+ * @return Returns the status of setting the dividers
+ */
+icm20948_return_code_t icm20948_setSampleRateDiv(uint8_t gyroDiv, uint16_t accelDiv);
+
+/*!
+ * @brief This API writes the gyro user offset registers. Offsets are subtracted from
+ * the gyro output by the chip, in 0.0305dps LSBs regardless of the full scale setting,
+ * and reset to 0.
+ *
+ * @param[in] offs: Pointer to the X/Y/Z offsets
+ *
+ * @return Returns the status of writing the offsets
+ */
+icm20948_return_code_t icm20948_setGyroOffsets(const int16_t *offs);
+
+/*!
+ * @brief This API writes the accel offset registers. Offsets are 15 bits wide, in
+ * 0.98mg LSBs regardless of the full scale setting. The chip loads factory trim values
+ * into these registers at reset, so only write them to replace that trim. Axes that
+ * already hold the requested offset are not written.
+ *
+ * @param[in] offs: Pointer to the X/Y/Z offsets, each in -16384 to 16383
+ *
+ * @return Returns the status of writing the offsets
+ */
+icm20948_return_code_t icm20948_setAccelOffsets(const int16_t *offs);
+
+#if ICM20948_FEATURE_FIFO
+/*!
+ * @brief This API selects which sensors are written into the FIFO, then resets and
+ * starts it. Disabling both sensors stops the FIFO.
+ *
+ * @param[in] accel: Enable streaming accel samples into the FIFO
+ * @param[in] gyro: Enable streaming gyro samples into the FIFO
+ *
+ * @return Returns the status of configuring the FIFO
+ */
+icm20948_return_code_t icm20948_enableFifo(icm20948_mod_enable_t accel, icm20948_mod_enable_t gyro);
+
+/*!
+ * @brief This API drains whole frames from the FIFO into raw sample blocks. On entry each
+ * block's len is its capacity, on return it is the number of samples placed in it.
+ * Samples are raw counts; blocks for sensors not streamed into the FIFO may be NULL.
+ *
+ * @param[in,out] accel: Pointer to the raw accel block to fill
+ * @param[in,out] gyro: Pointer to the raw gyro block to fill
+ *
+ * @return Returns the status of draining the FIFO
+ */
+icm20948_return_code_t icm20948_readFifo(icm20948_block_t *accel, icm20948_block_t *gyro);
+
+/*!
+ * @brief This API drains whole FIFO frames straight into the caller's buffer in a single
+ * transfer, e.g. a DMA buffer, leaving the unpacking to icm20948_parseFifo. Each frame
+ * holds accel X/Y/Z then gyro X/Y/Z for the streamed sensors, big-endian.
+ *
+ * @param[out] buf: Pointer to the buffer receiving the frames
+ * @param[in,out] len: On entry the capacity of buf, on return the number of bytes read,
+ * always a whole number of frames
+ * @param[out] layout: Pointer to where the layout of the frames read should be placed,
+ * taken under the same lock as the read so a concurrent icm20948_enableFifo can't skew it
+ *
+ * @return Returns the status of draining the FIFO
+ */
+icm20948_return_code_t icm20948_readFifoBytes(uint8_t *buf, uint32_t *len, icm20948_fifo_layout_t *layout);
+
+/*!
+ * @brief This API unpacks frames read by icm20948_readFifoBytes into raw sample blocks.
+ * It only works on the caller's data and never touches the device, so it may run on any
+ * thread. On entry each block's len is its capacity, on return it is the number of
+ * samples placed in it.
+ *
+ * @param[in] buf: Pointer to the frames
+ * @param[in] len: Number of bytes, a whole number of frames
+ * @param[in] layout: Pointer to the layout icm20948_readFifoBytes reported for the frames
+ * @param[in,out] accel: Pointer to the raw accel block, may be NULL if accel isn't streamed
+ * @param[in,out] gyro: Pointer to the raw gyro block, may be NULL if gyro isn't streamed
+ *
+ * @return Returns the status of unpacking the frames, ICM20948_RET_INV_CONFIG for a layout
+ * with neither sensor
+ */
+icm20948_return_code_t icm20948_parseFifo(const uint8_t *buf, uint32_t len, const icm20948_fifo_layout_t *layout,
+                                          icm20948_block_t *accel, icm20948_block_t *gyro);
+#endif
+
+#if ICM20948_FEATURE_WOM
+/*!
+ * @brief This API arms or disarms the wake-on-motion interrupt. Once armed, INT1 fires
+ * whenever any accel axis moves by more than the threshold from the previous sample.
+ *
+ * @param[in] en: Arm or disarm wake-on-motion
+ * @param[in] threshold: Motion threshold, 4mg per LSB (0 to 1020mg)
+ *
+ * @return Returns the status of configuring wake-on-motion
+ */
+icm20948_return_code_t icm20948_enableWakeOnMotion(icm20948_mod_enable_t en, uint8_t threshold);
+
+/*!
+ * @brief This API reads and clears the wake-on-motion interrupt status
+ *
+ * @param[out] triggered: Pointer to where the status should be placed, true if
+ * motion was detected since the last read
+ *
+ * @return Returns the status of reading the interrupt status
+ */
+icm20948_return_code_t icm20948_getWakeOnMotionStatus(bool *triggered);
+
+/*!
+ * @brief This API switches the accel between continuous and duty-cycled sampling. In
+ * duty-cycled mode the accel wakes once per sample period set by the accel sample rate
+ * divider and averages a burst of samples, which cuts its current draw substantially
+ * at low output rates. Pair it with the FIFO so the host can sleep between drains.
+ *
+ * @param[in] en: Enable or disable duty-cycled sampling
+ * @param[in] averaging: Samples averaged per wake, 0 = 1 or 4, 1 = 8, 2 = 16, 3 = 32
+ *
+ * @return Returns the status of configuring the accel
+ */
+icm20948_return_code_t icm20948_enableAccelCycle(icm20948_mod_enable_t en, uint8_t averaging);
+#endif
+
+#if ICM20948_FEATURE_VERIFY
+/*!
+ * @brief This API enables verify-after-write. Each API call that writes configuration
+ * then reads the written registers back, one burst per bank, and compares them with
+ * the values written. Mismatching registers are rewritten and read back again, up to
+ * twice more before the call fails. Off after init.
+ *
+ * @param[in] en: Enable or disable verifying configuration writes
+ *
+ * @return Returns the status of setting the verify mode
+ */
+icm20948_return_code_t icm20948_setVerify(icm20948_mod_enable_t en);
+
+/*!
+ * @brief This API retrieves the verify-after-write counters, counted since init or the
+ * last reset
+ *
+ * @param[out] stats: Pointer to where the counters should be placed
+ * @param[in] reset: Clear the counters after reading them
+ *
+ * @return Returns the status of retrieving the counters
+ */
+icm20948_return_code_t icm20948_getVerifyStats(icm20948_verify_stats_t *stats, bool reset);
+#endif
+
+#if ICM20948_FEATURE_REGDUMP
+/*!
+ * @brief This API reads a run of registers from any user bank in one burst. Beware
+ * that some registers, such as INT_STATUS and FIFO_R_W, change state when read.
+ *
+ * @param[in] bank: User register bank, 0 to 3
+ * @param[in] addr: First register address
+ * @param[out] data: Pointer to where the register values should be placed
+ * @param[in] len: Number of registers to read, not past 0x7F
+ *
+ * @return Returns the status of reading the registers
+ */
+icm20948_return_code_t icm20948_readRegisters(uint8_t bank, uint8_t addr, uint8_t *data, uint32_t len);
+
+/*!
+ * @brief This API retrieves the value the driver last wrote to one of the configuration
+ * registers it shadows, i.e. what the chip is expected to read back
+ *
+ * @param[in] bank: User register bank, 0 to 3
+ * @param[in] addr: Register address
+ * @param[out] value: Pointer to where the expected value should be placed
+ *
+ * @return Returns ICM20948_RET_INV_PARAM if the register is not shadowed or has not
+ * been written since init
+ */
+icm20948_return_code_t icm20948_getShadowRegister(uint8_t bank, uint8_t addr, uint8_t *value);
+#endif
+
+#if ICM20948_FEATURE_INSTRUMENTATION
+/*!
+ * @brief This API retrieves the bus activity counters, counted since init or the last reset
+ *
+ * @param[out] stats: Pointer to where the counters should be placed
+ * @param[in] reset: Clear the counters after reading them
+ *
+ * @return Returns the status of retrieving the counters
+ */
+icm20948_return_code_t icm20948_getBusStats(icm20948_bus_stats_t *stats, bool reset);
+#endif
+
+/*!
+ * @brief This API retrieves the gyro sensitivity for a full scale setting
+ *
+ * @param[in] fs: Gyro full scale select
+ *
+ * @return Returns the sensitivity in LSB per dps, or 0 for an invalid setting
+ */
+float icm20948_gyroSensitivity(icm20948_gyro_full_scale_select_t fs);
+
+/*!
+ * @brief This API retrieves the accel sensitivity for a full scale setting
+ *
+ * @param[in] fs: Accel full scale select
+ *
+ * @return Returns the sensitivity in LSB per g, or 0 for an invalid setting
+ */
+float icm20948_accelSensitivity(icm20948_accel_full_scale_select_t fs);
+
+/*!
+ * @brief This API converts a block of raw samples to scaled board frame samples in a
+ * single pass, applying the sensitivity of the current full scale setting and the
+ * mounting transform. Accel is output in g, gyro in dps and mag in uT. Raw mag samples
+ * are taken in the AK09916's own axes and are aligned to the chip axes on the way.
+ * Mag conversion fails with INV_PARAM when built without ICM20948_FEATURE_MAG.
+ *
+ * @param[in] sensor: Sensor the raw samples came from
+ * @param[in] raw: Pointer to the raw sample block
+ * @param[out] out: Pointer to the scaled block, with room for raw->len samples
+ *
+ * @return Returns the status of the conversion
+ */
+icm20948_return_code_t icm20948_convertBlock(icm20948_sensor_t sensor, const icm20948_block_t *raw, icm20948_fblock_t *out);
+
 #endif // _ICM20948_API_H_
 
 #ifdef __cplusplus
@@ -0,0 +1,674 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+
+/*! @file icm20948_async.hpp
+ * @brief Header only C++20 coroutine front end for the ICM20948 driver.
+ *
+ * The C driver blocks in the developers read/write functions and drives a single
+ * device. This header instead runs each driver operation as a coroutine over an
+ * asynchronous transport: every bus transfer is started through
+ * icm20948::AsyncTransport and the coroutine suspends until the transport reports
+ * completion. Acquisition code is written sequentially with co_await while the
+ * developers executor overlaps the bus waits of any number of devices.
+ *
+ * Each icm20948::Device carries its own cached bank and register shadows, so devices
+ * are independent of each other and of the C singleton. A device runs one operation at
+ * a time; callers sharing a device between coroutines must serialize them.
+ *
+ * Operations return icm20948::Task, a lazily started coroutine that yields an
+ * icm20948_return_code_t. Tasks are co_awaited from other tasks, or started from plain
+ * code with start() and polled with done(). Coroutine frames come from operator new.
+ *
+ * Samples are returned as raw counts in the sensor frame, as icm20948_readFifo()
+ * does. Scale them with icm20948_accelSensitivity() and icm20948_gyroSensitivity()
+ * using the full scale held in settings().
+ */
+
+#ifndef _ICM20948_ASYNC_HPP_
+#define _ICM20948_ASYNC_HPP_
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include "icm20948_api.h"
+#include "icm20948_regs.h"
+
+namespace icm20948 {
+
+/*! @brief Completion handed to the transport with each transfer. The transport calls
+ * fn(ctx, status) exactly once, from any thread or from inside the start call, with the
+ * same status the blocking read/write functions would return */
+struct Completion {
+    void (*fn)(void *ctx, int8_t status);
+    void *ctx;
+
+    void operator()(int8_t status) const { fn(ctx, status); }
+};
+
+/*! @brief Asynchronous bus interface. Each call starts one operation and returns
+ * immediately; the buffer stays valid until the completion runs */
+class AsyncTransport {
+public:
+    virtual ~AsyncTransport() = default;
+
+    /*! @brief Start reading len bytes from addr. The read bit is already set on addr */
+    virtual void read(uint8_t addr, uint8_t *data, uint32_t len, Completion done) = 0;
+
+    /*! @brief Start writing len bytes to addr */
+    virtual void write(uint8_t addr, const uint8_t *data, uint32_t len, Completion done) = 0;
+
+    /*! @brief Complete after at least period microseconds */
+    virtual void delayUs(uint32_t period, Completion done) = 0;
+};
+
+/*! @brief Lazily started coroutine producing a driver return code */
+class Task {
+public:
+    struct promise_type;
+    using handle_t = std::coroutine_handle<promise_type>;
+
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        std::coroutine_handle<> await_suspend(handle_t h) noexcept {
+            // Hand control straight back to whoever awaited us
+            std::coroutine_handle<> next = h.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    struct promise_type {
+        icm20948_return_code_t ret = ICM20948_RET_GEN_FAIL;
+        std::coroutine_handle<> continuation;
+
+        Task get_return_object() noexcept { return Task(handle_t::from_promise(*this)); }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+        void return_value(icm20948_return_code_t r) noexcept { ret = r; }
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+
+    Task(Task &&other) noexcept : h(other.h) { other.h = nullptr; }
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+    Task &operator=(Task &&) = delete;
+    ~Task() {
+        if( h ) {
+            h.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+        h.promise().continuation = caller;
+        return h;
+    }
+    icm20948_return_code_t await_resume() const noexcept { return h.promise().ret; }
+
+    /*! @brief Run a top level task until its first suspension */
+    void start() { h.resume(); }
+
+    /*! @brief True once the task has run to completion */
+    bool done() const { return h.done(); }
+
+    /*! @brief Return code of a completed task */
+    icm20948_return_code_t result() const { return h.promise().ret; }
+
+private:
+    explicit Task(handle_t handle) noexcept : h(handle) {}
+
+    handle_t h;
+};
+
+namespace detail {
+
+// Banks used by the coroutine front end. Register addresses and fields come from
+// icm20948_regs.h, shared with the C driver.
+constexpr uint8_t BANK_0 = 0;
+constexpr uint8_t BANK_2 = 2;
+constexpr uint8_t BANK_3 = 3;
+constexpr uint8_t BANK_UNKNOWN = 0xFF;
+
+// FCHOICE and the DLPF config, full scale is ORed in
+constexpr uint8_t CONFIG_DLPF_FCHOICE = (ICM20948_CONFIG_DLPFCFG << ICM20948_CONFIG_DLPFCFG_SHIFT) | ICM20948_CONFIG_FCHOICE;
+
+constexpr uint32_t FIFO_CHUNK_FRAMES = 10;
+constexpr uint32_t AUX_POLL_US = 100;
+constexpr uint32_t AUX_POLL_LIMIT = 50;
+
+/*! @brief Awaitable for a single transport operation. Completion may arrive inline
+ * from the start call or later from another context; whichever side comes second
+ * resumes the coroutine */
+class TransferAwaiter {
+public:
+    enum class Op { READ, WRITE, DELAY };
+
+    TransferAwaiter(AsyncTransport &bus, Op op, uint8_t addr, uint8_t *data, uint32_t len) noexcept
+        : bus(bus), op(op), addr(addr), data(data), len(len) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> caller) noexcept {
+        const Completion done = { &TransferAwaiter::_complete, this };
+
+        h = caller;
+        switch( op ) {
+            case Op::READ:
+                bus.read(addr, data, len, done);
+                break;
+            case Op::WRITE:
+                bus.write(addr, data, len, done);
+                break;
+            default:
+                bus.delayUs(len, done);
+                break;
+        }
+
+        // Stay suspended unless the transfer already completed inline
+        return !arrived.exchange(true, std::memory_order_acq_rel);
+    }
+
+    icm20948_return_code_t await_resume() const noexcept { return (icm20948_return_code_t)status; }
+
+private:
+    static void _complete(void *ctx, int8_t status) {
+        TransferAwaiter *self = static_cast<TransferAwaiter *>(ctx);
+
+        self->status = status;
+        if( self->arrived.exchange(true, std::memory_order_acq_rel) ) {
+            self->h.resume();
+        }
+    }
+
+    AsyncTransport &bus;
+    Op op;
+    uint8_t addr;
+    uint8_t *data;
+    uint32_t len;
+    std::coroutine_handle<> h;
+    int8_t status = 0;
+    std::atomic<bool> arrived { false };
+};
+
+} // namespace detail
+
+/*! @brief One ICM20948 behind an asynchronous transport */
+class Device {
+public:
+    explicit Device(AsyncTransport &bus) noexcept : bus(bus) {}
+
+    Device(const Device &) = delete;
+    Device &operator=(const Device &) = delete;
+
+    /*! @brief Settings last applied with applySettings() */
+    const icm20948_settings_t &settings() const noexcept { return cfg; }
+
+    /*!
+     * @brief Verify comms with WHO_AM_I and wake the device on the best clock
+     *
+     * @return Returns OK, GEN_FAIL on a WHO_AM_I mismatch or the transport error
+     */
+    Task init() {
+        icm20948_return_code_t ret = ICM20948_RET_OK;
+        uint8_t who = 0x00;
+
+        // Force a write of the bank select on first use
+        bank = detail::BANK_UNKNOWN;
+
+        ret = co_await _select_bank(detail::BANK_0);
+
+        if( ret == ICM20948_RET_OK ) {
+            ret = co_await _read(ICM20948_ADDR_WHO_AM_I, &who, 0x01);
+        }
+
+        if( (ret == ICM20948_RET_OK) && (who != ICM20948_WHO_AM_I_DEFAULT) ) {
+            ret = ICM20948_RET_GEN_FAIL;
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            pwr_mgmt_1 = ICM20948_PWR_MGMT_1_CLKSEL_AUTO;
+            ret = co_await _write(ICM20948_ADDR_PWR_MGMT_1, &pwr_mgmt_1, 0x01);
+        }
+
+        co_return ret;
+    }
+
+    /*!
+     * @brief Configure the accel and gyro the same way icm20948_applySettings() does,
+     * including the sample rate dividers of each enabled sensor. Only the mounting
+     * transform is host-side, it is stored but not sent
+     *
+     * @param[in] newSettings: Settings to apply, copied once the task starts
+     *
+     * @return Returns OK, NULL_PTR or the transport error
+     */
+    Task applySettings(const icm20948_settings_t *newSettings) {
+        icm20948_return_code_t ret = ICM20948_RET_OK;
+
+        if( newSettings == nullptr ) {
+            ret = ICM20948_RET_NULL_PTR;
+        }
+        else {
+            cfg = *newSettings;
+        }
+
+        if( (ret == ICM20948_RET_OK) && (cfg.gyro.en == ICM20948_MOD_ENABLED) ) {
+            ret = co_await _select_bank(detail::BANK_2);
+
+            if( ret == ICM20948_RET_OK ) {
+                gyro_config_1 = (uint8_t)(detail::CONFIG_DLPF_FCHOICE | ((cfg.gyro.fs & ICM20948_CONFIG_FS_SEL_MASK) << ICM20948_CONFIG_FS_SEL_SHIFT));
+                ret = co_await _write(ICM20948_ADDR_GYRO_CONFIG_1, &gyro_config_1, 0x01);
+            }
+
+            if( ret == ICM20948_RET_OK ) {
+                ret = co_await _write(ICM20948_ADDR_GYRO_SMPLRT_DIV, &gyro_div, 0x01);
+            }
+        }
+
+        if( (ret == ICM20948_RET_OK) && (cfg.accel.en == ICM20948_MOD_ENABLED) ) {
+            ret = co_await _select_bank(detail::BANK_2);
+
+            if( ret == ICM20948_RET_OK ) {
+                accel_config = (uint8_t)(detail::CONFIG_DLPF_FCHOICE | ((cfg.accel.fs & ICM20948_CONFIG_FS_SEL_MASK) << ICM20948_CONFIG_FS_SEL_SHIFT));
+                ret = co_await _write(ICM20948_ADDR_ACCEL_CONFIG, &accel_config, 0x01);
+            }
+
+            if( ret == ICM20948_RET_OK ) {
+                // DIV_1 and DIV_2 are adjacent, write them together
+                ret = co_await _write(ICM20948_ADDR_ACCEL_SMPLRT_DIV_1, accel_div, 0x02);
+            }
+        }
+
+        if( (ret == ICM20948_RET_OK) &&
+            ((cfg.gyro.en != ICM20948_MOD_ENABLED) || (cfg.accel.en != ICM20948_MOD_ENABLED)) ) {
+            ret = co_await _select_bank(detail::BANK_0);
+
+            if( ret == ICM20948_RET_OK ) {
+                ret = co_await _read(ICM20948_ADDR_PWR_MGMT_2, &pwr_mgmt_2, 0x01);
+            }
+
+            if( ret == ICM20948_RET_OK ) {
+                if( cfg.gyro.en != ICM20948_MOD_ENABLED ) {
+                    pwr_mgmt_2 |= ICM20948_PWR_MGMT_2_DISABLE_GYRO;
+                }
+                if( cfg.accel.en != ICM20948_MOD_ENABLED ) {
+                    pwr_mgmt_2 |= ICM20948_PWR_MGMT_2_DISABLE_ACCEL;
+                }
+                ret = co_await _write(ICM20948_ADDR_PWR_MGMT_2, &pwr_mgmt_2, 0x01);
+            }
+        }
+
+        co_return ret;
+    }
+
+    /*!
+     * @brief Read one accel and gyro sample in a single 12 byte burst
+     *
+     * @param[out] accel: Raw accel counts in the sensor frame
+     * @param[out] gyro: Raw gyro counts in the sensor frame
+     *
+     * @return Returns OK, NULL_PTR or the transport error
+     */
+    Task readSample(icm20948_accel_t *accel, icm20948_gyro_t *gyro) {
+        icm20948_return_code_t ret = ICM20948_RET_OK;
+        uint8_t data[12];
+
+        if( (accel == nullptr) || (gyro == nullptr) ) {
+            ret = ICM20948_RET_NULL_PTR;
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            ret = co_await _select_bank(detail::BANK_0);
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            ret = co_await _read(ICM20948_ADDR_ACCEL_XOUT_H, data, sizeof(data));
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            accel->x = _be16(&data[0]);
+            accel->y = _be16(&data[2]);
+            accel->z = _be16(&data[4]);
+            gyro->x = _be16(&data[6]);
+            gyro->y = _be16(&data[8]);
+            gyro->z = _be16(&data[10]);
+        }
+
+        co_return ret;
+    }
+
+#if ICM20948_FEATURE_FIFO
+    /*!
+     * @brief Stop, reconfigure, reset and restart the FIFO as icm20948_enableFifo() does
+     *
+     * @param[in] accel: Write accel samples into the FIFO
+     * @param[in] gyro: Write gyro samples into the FIFO
+     *
+     * @return Returns OK or the transport error
+     */
+    Task enableFifo(icm20948_mod_enable_t accel, icm20948_mod_enable_t gyro) {
+        icm20948_return_code_t ret = ICM20948_RET_OK;
+        uint8_t fifo_rst = ICM20948_FIFO_RST_ALL;
+        uint8_t zero = 0x00;
+
+        ret = co_await _select_bank(detail::BANK_0);
+
+        if( ret == ICM20948_RET_OK ) {
+            user_ctrl &= (uint8_t)~ICM20948_USER_CTRL_FIFO_EN;
+            ret = co_await _write(ICM20948_ADDR_USER_CTRL, &user_ctrl, 0x01);
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            fifo_en_2 = (uint8_t)(((accel == ICM20948_MOD_ENABLED) ? ICM20948_FIFO_EN_2_ACCEL : 0) |
+                                  ((gyro == ICM20948_MOD_ENABLED) ? ICM20948_FIFO_EN_2_GYRO : 0));
+            ret = co_await _write(ICM20948_ADDR_FIFO_EN_2, &fifo_en_2, 0x01);
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            ret = co_await _write(ICM20948_ADDR_FIFO_MODE, &zero, 0x01);
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            ret = co_await _write(ICM20948_ADDR_FIFO_RST, &fifo_rst, 0x01);
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            ret = co_await _write(ICM20948_ADDR_FIFO_RST, &zero, 0x01);
+        }
+
+        if( (ret == ICM20948_RET_OK) && (fifo_en_2 != 0x00) ) {
+            user_ctrl |= ICM20948_USER_CTRL_FIFO_EN;
+            ret = co_await _write(ICM20948_ADDR_USER_CTRL, &user_ctrl, 0x01);
+        }
+
+        co_return ret;
+    }
+
+    /*!
+     * @brief Drain whole frames from the FIFO into raw sample blocks, with the same
+     * block conventions as icm20948_readFifo()
+     *
+     * @param[in,out] accel: Accel block, len is the capacity on entry and the count on return
+     * @param[in,out] gyro: Gyro block, len is the capacity on entry and the count on return
+     *
+     * @return Returns OK, INV_CONFIG if the FIFO is off, NULL_PTR or the transport error
+     */
+    Task readFifo(icm20948_block_t *accel, icm20948_block_t *gyro) {
+        icm20948_return_code_t ret = ICM20948_RET_OK;
+        const bool accel_en = (fifo_en_2 & ICM20948_FIFO_EN_2_ACCEL) != 0;
+        const bool gyro_en = (fifo_en_2 & ICM20948_FIFO_EN_2_GYRO) != 0;
+        const uint32_t frame_size = (accel_en ? ICM20948_FIFO_ACCEL_FRAME_SIZE : 0) + (gyro_en ? ICM20948_FIFO_GYRO_FRAME_SIZE : 0);
+        uint8_t buf[detail::FIFO_CHUNK_FRAMES * (ICM20948_FIFO_ACCEL_FRAME_SIZE + ICM20948_FIFO_GYRO_FRAME_SIZE)];
+        uint8_t count[2];
+        uint32_t frames = UINT32_MAX;
+        uint32_t done = 0;
+
+        if( frame_size == 0 ) {
+            ret = ICM20948_RET_INV_CONFIG;
+        }
+        else if( (accel_en && (accel == nullptr)) || (gyro_en && (gyro == nullptr)) ) {
+            ret = ICM20948_RET_NULL_PTR;
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            if( accel_en ) {
+                frames = accel->len;
+            }
+            if( gyro_en && (gyro->len < frames) ) {
+                frames = gyro->len;
+            }
+
+            ret = co_await _select_bank(detail::BANK_0);
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            ret = co_await _read(ICM20948_ADDR_FIFO_COUNTH, count, 0x02);
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            // Only pull whole frames so the FIFO stays aligned for the next drain
+            const uint32_t avail = (((uint32_t)(count[0] & ICM20948_FIFO_COUNTH_MASK) << 8) | count[1]) / frame_size;
+            if( avail < frames ) {
+                frames = avail;
+            }
+        }
+
+        while( (ret == ICM20948_RET_OK) && (done < frames) ) {
+            uint32_t chunk = frames - done;
+            if( chunk > detail::FIFO_CHUNK_FRAMES ) {
+                chunk = detail::FIFO_CHUNK_FRAMES;
+            }
+
+            ret = co_await _read(ICM20948_ADDR_FIFO_R_W, buf, chunk * frame_size);
+
+            // Frames are written in register order, accel first and then gyro
+            for( uint32_t i = 0; (ret == ICM20948_RET_OK) && (i < chunk); i++ ) {
+                const uint8_t *frame = &buf[i * frame_size];
+
+                if( accel_en ) {
+                    accel->x[done + i] = _be16(&frame[0]);
+                    accel->y[done + i] = _be16(&frame[2]);
+                    accel->z[done + i] = _be16(&frame[4]);
+                    frame += ICM20948_FIFO_ACCEL_FRAME_SIZE;
+                }
+
+                if( gyro_en ) {
+                    gyro->x[done + i] = _be16(&frame[0]);
+                    gyro->y[done + i] = _be16(&frame[2]);
+                    gyro->z[done + i] = _be16(&frame[4]);
+                }
+            }
+
+            if( ret == ICM20948_RET_OK ) {
+                done += chunk;
+            }
+        }
+
+        if( accel_en && (accel != nullptr) ) {
+            accel->len = done;
+        }
+        if( gyro_en && (gyro != nullptr) ) {
+            gyro->len = done;
+        }
+
+        co_return ret;
+    }
+
+#endif
+
+#if ICM20948_FEATURE_AUX
+    /*!
+     * @brief Read one register of a device on the auxiliary I2C bus through the
+     * I2C master's slave 4 channel
+     *
+     * @param[in] i2c_addr: 7 bit address of the auxiliary device
+     * @param[in] reg: Register to read
+     * @param[out] value: Register contents
+     *
+     * @return Returns OK, NULL_PTR, GEN_FAIL on a NACK, TIMEOUT or the transport error
+     */
+    Task auxRead(uint8_t i2c_addr, uint8_t reg, uint8_t *value) {
+        icm20948_return_code_t ret = ICM20948_RET_OK;
+
+        if( value == nullptr ) {
+            ret = ICM20948_RET_NULL_PTR;
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            ret = co_await _aux_transaction((uint8_t)(i2c_addr | ICM20948_I2C_SLV_RNW), reg, 0x00);
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            ret = co_await _select_bank(detail::BANK_3);
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            ret = co_await _read(ICM20948_ADDR_I2C_SLV4_DI, value, 0x01);
+        }
+
+        co_return ret;
+    }
+
+    /*!
+     * @brief Write one register of a device on the auxiliary I2C bus through the
+     * I2C master's slave 4 channel
+     *
+     * @param[in] i2c_addr: 7 bit address of the auxiliary device
+     * @param[in] reg: Register to write
+     * @param[in] value: Value to write
+     *
+     * @return Returns OK, GEN_FAIL on a NACK, TIMEOUT or the transport error
+     */
+    Task auxWrite(uint8_t i2c_addr, uint8_t reg, uint8_t value) {
+        co_return co_await _aux_transaction((uint8_t)(i2c_addr & 0x7F), reg, value);
+    }
+#endif
+
+private:
+    detail::TransferAwaiter _read(uint8_t addr, uint8_t *data, uint32_t len) noexcept {
+        return detail::TransferAwaiter(bus, detail::TransferAwaiter::Op::READ, (uint8_t)(addr | ICM20948_SPI_READ), data, len);
+    }
+
+    detail::TransferAwaiter _write(uint8_t addr, uint8_t *data, uint32_t len) noexcept {
+        return detail::TransferAwaiter(bus, detail::TransferAwaiter::Op::WRITE, addr, data, len);
+    }
+
+    detail::TransferAwaiter _delay(uint32_t period) noexcept {
+        return detail::TransferAwaiter(bus, detail::TransferAwaiter::Op::DELAY, 0x00, nullptr, period);
+    }
+
+    static int16_t _be16(const uint8_t *p) noexcept {
+        return (int16_t)(((uint16_t)p[0] << 8) | p[1]);
+    }
+
+    // Awaitable bank select that completes without touching the bus if the bank is
+    // already selected
+    class BankAwaiter {
+    public:
+        BankAwaiter(Device &d, uint8_t target) noexcept
+            : d(d), target(target), xfer(d._write(ICM20948_ADDR_REG_BANK_SEL, &d.bank_sel, 0x01)) {}
+
+        bool await_ready() const noexcept { return d.bank == target; }
+        bool await_suspend(std::coroutine_handle<> caller) noexcept { return xfer.await_suspend(caller); }
+        icm20948_return_code_t await_resume() noexcept {
+            icm20948_return_code_t ret = ICM20948_RET_OK;
+
+            if( d.bank != target ) {
+                ret = xfer.await_resume();
+                if( ret == ICM20948_RET_OK ) {
+                    d.bank = target;
+                }
+            }
+
+            return ret;
+        }
+
+    private:
+        Device &d;
+        uint8_t target;
+        detail::TransferAwaiter xfer;
+    };
+
+    BankAwaiter _select_bank(uint8_t target) noexcept {
+        // The bank lives in bits [5:4] of REG_BANK_SEL
+        bank_sel = (uint8_t)(target << ICM20948_REG_BANK_SEL_SHIFT);
+        return BankAwaiter(*this, target);
+    }
+
+#if ICM20948_FEATURE_AUX
+    // Run one slave 4 transfer and wait for the master to report it done
+    Task _aux_transaction(uint8_t slv_addr, uint8_t reg, uint8_t value) {
+        icm20948_return_code_t ret = ICM20948_RET_OK;
+        uint8_t slv4[3] = { slv_addr, reg, ICM20948_I2C_SLV_EN };
+        uint8_t status = 0x00;
+        uint32_t polls = 0;
+
+        ret = co_await _select_bank(detail::BANK_0);
+
+        if( (ret == ICM20948_RET_OK) && ((user_ctrl & ICM20948_USER_CTRL_I2C_MST_EN) == 0) ) {
+            user_ctrl |= ICM20948_USER_CTRL_I2C_MST_EN;
+            ret = co_await _write(ICM20948_ADDR_USER_CTRL, &user_ctrl, 0x01);
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            ret = co_await _select_bank(detail::BANK_3);
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            // DO has to be in place before CTRL starts the transfer
+            ret = co_await _write(ICM20948_ADDR_I2C_SLV4_DO, &value, 0x01);
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            // ADDR, REG and CTRL are adjacent, CTRL goes last and kicks off the transfer
+            ret = co_await _write(ICM20948_ADDR_I2C_SLV4_ADDR, slv4, sizeof(slv4));
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            ret = co_await _select_bank(detail::BANK_0);
+        }
+
+        // I2C_MST_STATUS clears on read, so keep the NACK bit from the same read as DONE
+        while( (ret == ICM20948_RET_OK) && ((status & ICM20948_I2C_MST_STATUS_SLV4_DONE) == 0) ) {
+            if( polls++ >= detail::AUX_POLL_LIMIT ) {
+                ret = ICM20948_RET_TIMEOUT;
+            }
+            else {
+                ret = co_await _delay(detail::AUX_POLL_US);
+            }
+
+            if( ret == ICM20948_RET_OK ) {
+                ret = co_await _read(ICM20948_ADDR_I2C_MST_STATUS, &status, 0x01);
+            }
+        }
+
+        if( (ret == ICM20948_RET_OK) && ((status & ICM20948_I2C_MST_STATUS_SLV4_NACK) != 0) ) {
+            ret = ICM20948_RET_GEN_FAIL;
+        }
+
+        co_return ret;
+    }
+#endif
+
+    AsyncTransport &bus;
+    icm20948_settings_t cfg = {};
+    uint8_t bank = detail::BANK_UNKNOWN;
+    uint8_t bank_sel = 0x00;
+    uint8_t user_ctrl = 0x00;
+    uint8_t pwr_mgmt_1 = 0x00;
+    uint8_t pwr_mgmt_2 = 0x00;
+    uint8_t fifo_en_2 = 0x00;
+    uint8_t gyro_config_1 = 0x00;
+    uint8_t accel_config = 0x00;
+    // Same ~102Hz defaults as icm20948_init()
+    uint8_t gyro_div = 0x0A;
+    uint8_t accel_div[2] = { 0x00, 0x0A };
+};
+
+} // namespace icm20948
+
+#endif // _ICM20948_ASYNC_HPP_
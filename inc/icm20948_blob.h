@@ -0,0 +1,184 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+
+/*! @file icm20948_blob.h
+ * @brief Public header file for the ICM20948 persisted configuration and calibration blob.
+ *
+ * A blob is a 12 byte header followed by a payload of records. All fields are little
+ * endian and floats are IEEE-754 single precision.
+ *
+ *   Offset  Size  Field
+ *   0       4     Magic, "ICMB"
+ *   4       1     Format version
+ *   5       1     Reserved, 0
+ *   6       2     Payload length in bytes
+ *   8       4     CRC-32 (IEEE 802.3) over header bytes 0-7 followed by the payload
+ *
+ * Each record is a tag byte, a length byte and then length bytes of data, see
+ * icm20948_blob_tag_t. Only the records a device needs are stored, and records with
+ * an unknown tag are skipped so newer writers stay readable.
+ *
+ *   Tag         Size  Data
+ *   SETTINGS    52    Gyro en, gyro fs, accel en, accel fs, mag en, gyro div (u8),
+ *                     accel div (u16), mount type, perm[3], sign[3], reserved,
+ *                     mount m[3][3] row major
+ *   ACCEL_OFFS  6     Accel offset registers X/Y/Z (i16)
+ *   GYRO_OFFS   6     Gyro user offset registers X/Y/Z (i16)
+ *   *_CAL       48    Correction matrix m[3][3] row major, then bias[3]
+ *   *_TEMP      40    Reference temperature t0, then c[3][3], per axis c0/c1/c2
+ *
+ * Boot-time reconfiguration is one pass: icm20948_blobParse() checks the CRC while it
+ * decodes, and icm20948_blobApply() then writes only what differs from the chip's
+ * reset state: settings registers and gyro offsets are compared against their reset
+ * values, and accel offsets, which reset to a per-part factory trim, against what the
+ * chip holds. Calibration and temperature models are host-side and never touch the
+ * bus; apply them to scaled samples with icm20948_blobCorrect().
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_BLOB_H_
+#define _ICM20948_BLOB_H_
+
+#include <stdint.h>
+#include "icm20948_api.h"
+
+#define ICM20948_BLOB_MAGIC                 (0x424D4349)
+#define ICM20948_BLOB_VERSION               (1)
+#define ICM20948_BLOB_HEADER_SIZE           (12)
+#define ICM20948_BLOB_MAX_SIZE              (ICM20948_BLOB_HEADER_SIZE + 2 + 52 + 2 * (2 + 6) + 3 * (2 + 48) + 2 * (2 + 40))
+
+typedef enum {
+    ICM20948_BLOB_SETTINGS = 0x01,
+    ICM20948_BLOB_ACCEL_OFFS = 0x02,
+    ICM20948_BLOB_GYRO_OFFS = 0x03,
+    ICM20948_BLOB_ACCEL_CAL = 0x04,
+    ICM20948_BLOB_GYRO_CAL = 0x05,
+    ICM20948_BLOB_MAG_CAL = 0x06,
+    ICM20948_BLOB_ACCEL_TEMP = 0x07,
+    ICM20948_BLOB_GYRO_TEMP = 0x08
+} icm20948_blob_tag_t;
+
+/*! @brief Bit for a record in icm20948_blob_t.present */
+#define ICM20948_BLOB_HAS(tag)              (0x01UL << (tag))
+
+/*! @brief Calibration correction, out = m * (in - bias) */
+typedef struct {
+    float m[3][3];
+    float bias[3];
+} icm20948_cal_t;
+
+/*! @brief Temperature model of the bias left after calibration. For each axis the
+ * bias at temperature T is c[i][0] + c[i][1] * (T - t0) + c[i][2] * (T - t0)^2 */
+typedef struct {
+    float t0;
+    float c[3][3];
+} icm20948_temp_model_t;
+
+typedef struct {
+    uint32_t present;           // ICM20948_BLOB_HAS() bits of the records held
+    icm20948_settings_t settings;
+    uint8_t gyro_div;
+    uint16_t accel_div;
+    int16_t accel_offs[3];
+    int16_t gyro_offs[3];
+    icm20948_cal_t accel_cal;
+    icm20948_cal_t gyro_cal;
+    icm20948_cal_t mag_cal;
+    icm20948_temp_model_t accel_temp;
+    icm20948_temp_model_t gyro_temp;
+} icm20948_blob_t;
+
+/*!
+ * @brief This API serializes the records present in a blob. On entry len is the
+ * capacity of buf, on return it is the size of the blob.
+ *
+ * @param[in] blob: Pointer to the blob contents
+ * @param[out] buf: Pointer to where the blob should be written
+ * @param[in,out] len: Capacity of buf on entry, blob size on return
+ *
+ * @return Returns the status of serializing the blob
+ */
+icm20948_return_code_t icm20948_blobWrite(const icm20948_blob_t *blob, uint8_t *buf, uint32_t *len);
+
+/*!
+ * @brief This API validates a blob's header and CRC without decoding it
+ *
+ * @param[in] buf: Pointer to the blob
+ * @param[in] len: Number of bytes available in buf
+ *
+ * @return Returns ICM20948_RET_OK for a valid blob, ICM20948_RET_INV_PARAM for a bad
+ * header or length and ICM20948_RET_GEN_FAIL for a CRC mismatch
+ */
+icm20948_return_code_t icm20948_blobValidate(const uint8_t *buf, uint32_t len);
+
+/*!
+ * @brief This API validates and decodes a blob in a single pass. Nothing is placed in
+ * blob unless the whole blob is valid.
+ *
+ * @param[in] buf: Pointer to the blob
+ * @param[in] len: Number of bytes available in buf
+ * @param[out] blob: Pointer to where the decoded contents should be placed
+ *
+ * @return Returns the status of parsing the blob, as for icm20948_blobValidate or
+ * ICM20948_RET_INV_CONFIG for a malformed record
+ */
+icm20948_return_code_t icm20948_blobParse(const uint8_t *buf, uint32_t len, icm20948_blob_t *blob);
+
+/*!
+ * @brief This API parses a blob and configures the device from it, expecting a chip fresh
+ * out of reset. Registers are only written when they differ from the reset state, and
+ * the device is left untouched if the blob is invalid.
+ *
+ * @param[in] buf: Pointer to the blob
+ * @param[in] len: Number of bytes available in buf
+ * @param[out] blob: Pointer to where the decoded contents should be placed, so the
+ * host-side calibration can be used afterwards, or NULL
+ *
+ * @return Returns the status of applying the blob
+ */
+icm20948_return_code_t icm20948_blobApply(const uint8_t *buf, uint32_t len, icm20948_blob_t *blob);
+
+/*!
+ * @brief This API corrects a block of scaled samples in place, first removing the
+ * temperature dependent bias and then applying the calibration
+ *
+ * @param[in] cal: Pointer to the calibration, or NULL to skip it
+ * @param[in] temp: Pointer to the temperature model, or NULL to skip it
+ * @param[in] temp_c: Die temperature in degrees C
+ * @param[in,out] block: Pointer to the block of samples to correct
+ *
+ * @return Returns the status of correcting the block
+ */
+icm20948_return_code_t icm20948_blobCorrect(const icm20948_cal_t *cal, const icm20948_temp_model_t *temp, float temp_c, icm20948_fblock_t *block);
+
+#endif // _ICM20948_BLOB_H_
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,92 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+
+/*! @file icm20948_config.h
+ * @brief Compile time feature selection for the ICM20948 driver.
+ *
+ * Each switch is 1 to build the feature in and 0 to leave its code, register
+ * shadows and API out entirely. Override them with -D on the compiler command line,
+ * or through the matching CMake options which pass them to everything linking the
+ * library. The defaults build the full driver, except for instrumentation.
+ *
+ * The smallest useful configuration, accel and gyro burst reads only, is every switch
+ * set to 0. Build the icm20948_size target to see the flash and RAM of the library in
+ * the current configuration.
+ */
+
+#ifndef _ICM20948_CONFIG_H_
+#define _ICM20948_CONFIG_H_
+
+/*! @brief FIFO streaming, icm20948_enableFifo() and icm20948_readFifo() */
+#ifndef ICM20948_FEATURE_FIFO
+#define ICM20948_FEATURE_FIFO               (1)
+#endif
+
+/*! @brief Magnetometer sample conversion in icm20948_convertBlock() */
+#ifndef ICM20948_FEATURE_MAG
+#define ICM20948_FEATURE_MAG                (1)
+#endif
+
+/*! @brief Auxiliary I2C master transfers */
+#ifndef ICM20948_FEATURE_AUX
+#define ICM20948_FEATURE_AUX                (1)
+#endif
+
+/*! @brief Wake-on-motion interrupt and duty-cycled accel sampling */
+#ifndef ICM20948_FEATURE_WOM
+#define ICM20948_FEATURE_WOM                (1)
+#endif
+
+/*! @brief Lock hooks for sharing the driver between threads, icm20948_setLockHooks() */
+#ifndef ICM20948_FEATURE_LOCK
+#define ICM20948_FEATURE_LOCK               (1)
+#endif
+
+/*! @brief Shadow every register of all four banks. With 0 only the configuration
+ * registers the driver writes are shadowed, packed by bank, which cuts the register
+ * shadow from 132 to 17 bytes while keeping the bank select cache */
+#ifndef ICM20948_FEATURE_FULL_SHADOW
+#define ICM20948_FEATURE_FULL_SHADOW        (1)
+#endif
+
+/*! @brief Optional verify-after-write of configuration registers, icm20948_setVerify().
+ * Off by default, its pending write list and counters add 120 bytes per device on a
+ * 32-bit target on top of the register shadow */
+#ifndef ICM20948_FEATURE_VERIFY
+#define ICM20948_FEATURE_VERIFY             (0)
+#endif
+
+/*! @brief Register dump and diff against the shadow, icm20948_regDump() */
+#ifndef ICM20948_FEATURE_REGDUMP
+#define ICM20948_FEATURE_REGDUMP            (1)
+#endif
+
+/*! @brief Bus transaction, byte, bank switch and error counters, icm20948_getBusStats() */
+#ifndef ICM20948_FEATURE_INSTRUMENTATION
+#define ICM20948_FEATURE_INSTRUMENTATION    (0)
+#endif
+
+#endif // _ICM20948_CONFIG_H_
@@ -0,0 +1,120 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_deadband.h
+ * @brief Public header file for the ICM20948 change-threshold (deadband) reporting.
+ *
+ * A sample is passed on only when it has moved further than the threshold from the
+ * last sample passed on, or when max_interval samples have gone by without one, so a
+ * consumer still hears from an idle sensor. Vectors (accel, gyro, mag or any scaled
+ * block) are compared by Euclidean distance. Orientations are compared by the angle of
+ * the rotation between them, so q and -q count as the same orientation.
+ *
+ * Each reported sample carries the number of samples suppressed before it, which is
+ * enough to put it back on the time axis. Output may overwrite the input in place.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_DEADBAND_H_
+#define _ICM20948_DEADBAND_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "icm20948_api.h"
+
+typedef struct {
+    float threshold;            // Distance in sample units, or angle in rad for orientations
+    uint32_t max_interval;      // Most samples between reports, 0 for no limit
+} icm20948_deadband_cfg_t;
+
+typedef struct {
+    icm20948_deadband_cfg_t cfg;
+    float dist_sq;              // Squared threshold, compared against vectors
+    float half_cos;             // Cosine of half the threshold, compared against orientations
+    float last[4];              // Last reported sample
+    bool primed;
+    uint32_t since;             // Samples suppressed since the last report
+    uint64_t reported;
+    uint64_t suppressed;
+} icm20948_deadband_t;
+
+/*!
+ * @brief This API initializes a deadband filter
+ *
+ * @param[in] db: Pointer to the filter to be initialized
+ * @param[in] cfg: Pointer to the filter configuration
+ *
+ * @return Returns the status of initialization
+ */
+icm20948_return_code_t icm20948_deadbandInit(icm20948_deadband_t *db, const icm20948_deadband_cfg_t *cfg);
+
+/*!
+ * @brief This API filters a block of 3-axis samples, keeping only those that changed
+ * significantly. The first sample ever seen is always reported.
+ *
+ * @param[in] db: Pointer to the filter
+ * @param[in] in: Pointer to the input block
+ * @param[out] out: Pointer to the output block, len is the capacity on entry (at least
+ * in->len) and the number of reported samples on return. May be the same block as in.
+ * @param[out] gap: Samples suppressed before each reported sample, may be NULL
+ *
+ * @return Returns the status of filtering the block
+ */
+icm20948_return_code_t icm20948_deadbandProcess(icm20948_deadband_t *db, const icm20948_fblock_t *in, icm20948_fblock_t *out, uint32_t *gap);
+
+/*!
+ * @brief This API filters a block of orientations, keeping only those that rotated
+ * significantly. The first orientation ever seen is always reported.
+ *
+ * @param[in] db: Pointer to the filter
+ * @param[in] in: Pointer to the input orientations
+ * @param[in] len: Number of input orientations
+ * @param[out] out: Pointer to the output orientations, room for len. May be the same as in.
+ * @param[out] gap: Samples suppressed before each reported orientation, may be NULL
+ * @param[out] count: Number of reported orientations
+ *
+ * @return Returns the status of filtering the block
+ */
+icm20948_return_code_t icm20948_deadbandProcessQuat(icm20948_deadband_t *db, const icm20948_quat_t *in, uint32_t len, icm20948_quat_t *out, uint32_t *gap, uint32_t *count);
+
+/*!
+ * @brief This API retrieves the number of samples reported and suppressed so far
+ *
+ * @param[in] db: Pointer to the filter
+ * @param[out] reported: Pointer to where the reported count should be placed
+ * @param[out] suppressed: Pointer to where the suppressed count should be placed
+ *
+ * @return Returns the status of retrieving the counts
+ */
+icm20948_return_code_t icm20948_deadbandGetCounts(const icm20948_deadband_t *db, uint64_t *reported, uint64_t *suppressed);
+
+#endif // _ICM20948_DEADBAND_H_
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,114 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_decim.h
+ * @brief Public header file for the ICM20948 oversample-and-decimate stage.
+ *
+ * Raw samples taken at a high output data rate (typically drained from the FIFO
+ * with both sample rate dividers at 0, 1125Hz) are passed through an N stage CIC
+ * decimator with a rate change of R = 2^rate_log2. Output samples are produced at
+ * ODR / R and are 32 bit Q16.16 values in LSB, i.e. raw counts scaled by 65536.
+ *
+ * For white sensor noise the output standard deviation is reduced by the factor
+ * returned by icm20948_decimNoiseGain(). That is 1/sqrt(R) for a single stage and
+ * a little lower for more stages (~0.82/sqrt(R) for N = 2, ~0.74/sqrt(R) for N = 3).
+ * Each halving of the noise is one extra effective bit, e.g. R = 64 with N = 2
+ * gives ~3.3 extra bits. Higher orders also reject aliases around multiples of the
+ * output rate much more strongly, at the cost of more passband droop, which goes
+ * like sinc^N. Pick an output rate well above the signal bandwidth.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_DECIM_H_
+#define _ICM20948_DECIM_H_
+
+#include <stdint.h>
+#include "icm20948_api.h"
+
+#define ICM20948_DECIM_AXIS_COUNT           (3)
+#define ICM20948_DECIM_MAX_ORDER            (4)
+#define ICM20948_DECIM_OUT_FRAC_BITS        (16)
+
+/*! @brief Block of 3-axis Q16.16 samples stored as a structure of arrays */
+typedef struct {
+    int32_t *x;
+    int32_t *y;
+    int32_t *z;
+    uint32_t len;
+} icm20948_block32_t;
+
+typedef struct {
+    uint8_t order;              // Number of CIC stages, 1 to ICM20948_DECIM_MAX_ORDER
+    uint8_t rate_log2;          // log2 of the decimation ratio, order * rate_log2 must not exceed 16
+} icm20948_decim_cfg_t;
+
+typedef struct {
+    icm20948_decim_cfg_t cfg;
+    uint32_t integ[ICM20948_DECIM_AXIS_COUNT][ICM20948_DECIM_MAX_ORDER];
+    uint32_t comb[ICM20948_DECIM_AXIS_COUNT][ICM20948_DECIM_MAX_ORDER];
+    uint32_t phase;
+} icm20948_decim_t;
+
+/*!
+ * @brief This API initializes a decimator with the given configuration
+ *
+ * @param[in] dec: Pointer to the decimator to be initialized
+ * @param[in] cfg: Pointer to the decimator configuration
+ *
+ * @return Returns the status of initialization
+ */
+icm20948_return_code_t icm20948_decimInit(icm20948_decim_t *dec, const icm20948_decim_cfg_t *cfg);
+
+/*!
+ * @brief This API passes a block of raw samples through the decimator. On entry out->len
+ * is the capacity of the output block, on return it is the number of samples produced.
+ * The call fails without consuming any input if the output block is too small.
+ *
+ * @param[in] dec: Pointer to the decimator
+ * @param[in] in: Pointer to the block of raw input samples
+ * @param[in,out] out: Pointer to the block receiving the Q16.16 output samples
+ *
+ * @return Returns the status of processing the block
+ */
+icm20948_return_code_t icm20948_decimProcess(icm20948_decim_t *dec, const icm20948_block_t *in, icm20948_block32_t *out);
+
+/*!
+ * @brief This API computes the white noise gain of a decimator configuration, the ratio
+ * of output to input noise standard deviation
+ *
+ * @param[in] cfg: Pointer to the decimator configuration
+ *
+ * @return Returns the noise gain, or 0 for an invalid configuration
+ */
+float icm20948_decimNoiseGain(const icm20948_decim_cfg_t *cfg);
+
+#endif // _ICM20948_DECIM_H_
+
+#ifdef __cplusplus
+}
+#endif
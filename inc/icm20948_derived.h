@@ -0,0 +1,80 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_derived.h
+ * @brief Public header file for the ICM20948 orientation derived outputs.
+ *
+ * Given an orientation estimate and the matching body frame accel (and optionally
+ * mag) samples, a whole batch of derived outputs is computed in one sweep:
+ *  - tilt-compensated magnetic heading, corrected by the local declination
+ *  - the gravity vector in the body frame, i.e. what the accel reads at rest
+ *  - linear (gravity-removed) acceleration in both the body and world frames
+ *
+ * The world frame is Z up, matching the strapdown integrator. Heading is clockwise
+ * from north in [0, 360) deg; mag samples must already be aligned to the accel/gyro
+ * axes, and their units do not matter.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_DERIVED_H_
+#define _ICM20948_DERIVED_H_
+
+#include <stdint.h>
+#include "icm20948_api.h"
+
+typedef struct {
+    float declination;          // Magnetic declination added to the heading, deg, east positive
+    float gravity;              // Local gravity removed from the accel, same units as the accel samples
+} icm20948_derived_cfg_t;
+
+typedef struct {
+    float *heading;             // Heading, deg, may be NULL
+    icm20948_fblock_t gravity;  // Gravity vector in the body frame, skipped if x is NULL
+    icm20948_fblock_t lin_body; // Linear acceleration in the body frame, skipped if x is NULL
+    icm20948_fblock_t lin_world;// Linear acceleration in the world frame, skipped if x is NULL
+} icm20948_derived_out_t;
+
+/*!
+ * @brief This API computes the derived outputs for a batch of samples. Every output
+ * that is requested must have room for accel->len samples.
+ *
+ * @param[in] cfg: Pointer to the derived output configuration
+ * @param[in] q: Pointer to accel->len orientation estimates
+ * @param[in] accel: Pointer to the body frame accel samples
+ * @param[in] mag: Pointer to the body frame mag samples, may be NULL if no heading is requested
+ * @param[out] out: Pointer to the output buffers
+ *
+ * @return Returns the status of computing the outputs
+ */
+icm20948_return_code_t icm20948_derivedProcess(const icm20948_derived_cfg_t *cfg, const icm20948_quat_t *q, const icm20948_fblock_t *accel, const icm20948_fblock_t *mag, icm20948_derived_out_t *out);
+
+#endif // _ICM20948_DERIVED_H_
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,168 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_events.h
+ * @brief Public header file for the ICM20948 motion event detectors.
+ *
+ * Tap, double tap, free-fall and shock are detected on blocks of scaled accel
+ * samples (g, as produced by icm20948_convertBlock) with constant work per sample:
+ *  - Free-fall: |a| stays below ff_threshold for ff_min_samples
+ *  - Shock: |a| rises above shock_threshold, reported with its peak once it falls
+ *    back below shock_threshold - hysteresis
+ *  - Tap: the sample-to-sample change on any axis spikes above tap_threshold and
+ *    falls back below tap_threshold - hysteresis within tap_max_samples. A second
+ *    tap within double_tap_window samples is also reported as a double tap.
+ *
+ * When idle_samples is set, the detector calls the arm hook after that many still
+ * samples (typically wrapping icm20948_enableWakeOnMotion) and then ignores samples
+ * until icm20948_eventsWake() is called from the wake-on-motion interrupt. The wake only
+ * raises a flag; the next icm20948_eventsProcess() call takes it and leaves the gated
+ * state, so the interrupt never races the detector state.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_EVENTS_H_
+#define _ICM20948_EVENTS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "icm20948_api.h"
+
+typedef enum {
+    ICM20948_EVENT_TAP = 0x00,
+    ICM20948_EVENT_DOUBLE_TAP = 0x01,
+    ICM20948_EVENT_FREEFALL = 0x02,
+    ICM20948_EVENT_SHOCK = 0x03
+} icm20948_event_type_t;
+
+typedef struct {
+    icm20948_event_type_t type;
+    uint64_t timestamp_us;      // Time of the sample that completed the event
+    uint8_t axis;               // Dominant axis for taps and shocks (0 = X, 1 = Y, 2 = Z)
+    int8_t sign;                // Direction along the dominant axis
+    float peak;                 // Peak jerk (tap), magnitude (shock) or duration in s (free-fall)
+} icm20948_event_t;
+
+typedef void(*icm20948_events_cb_t)(const icm20948_event_t *event, void *ctx);
+typedef icm20948_return_code_t(*icm20948_events_arm_fptr_t)(void *ctx);
+
+typedef struct {
+    uint32_t sample_period_us;
+    float hysteresis;           // Release margin below each threshold, g
+    // Free-fall
+    float ff_threshold;         // g, 0 disables
+    uint32_t ff_min_samples;
+    // Shock
+    float shock_threshold;      // g, 0 disables
+    uint32_t shock_holdoff;     // Samples ignored after a shock
+    // Tap
+    float tap_threshold;        // Sample-to-sample change, g, 0 disables
+    uint32_t tap_max_samples;   // Longest pulse still counted as a tap
+    uint32_t tap_quiet_samples; // Samples ignored after a tap
+    uint32_t double_tap_window; // Samples after a tap in which a second one is a double tap
+    // Wake-on-motion gating
+    uint32_t idle_samples;      // Still samples before arming, 0 disables gating
+    float idle_tolerance;       // Largest | |a| - 1g | still counted as still
+    icm20948_events_arm_fptr_t arm;
+    icm20948_events_cb_t cb;
+    void *ctx;
+} icm20948_events_cfg_t;
+
+typedef struct {
+    icm20948_events_cfg_t cfg;
+    uint64_t n;                 // Samples seen, for timestamps
+    bool primed;
+    float prev[3];
+    // Free-fall
+    uint32_t ff_count;
+    bool ff_active;
+    // Shock
+    bool shock_active;
+    float shock_peak;
+    uint8_t shock_axis;
+    int8_t shock_sign;
+    uint32_t shock_holdoff;
+    // Tap
+    bool tap_active;
+    uint32_t tap_len;
+    float tap_peak;
+    uint8_t tap_axis;
+    int8_t tap_sign;
+    uint32_t tap_quiet;
+    uint64_t last_tap;
+    bool tap_pending;
+    // Gating
+    uint32_t still;
+    bool gated;
+    uint32_t wake;              // Set by icm20948_eventsWake, taken by icm20948_eventsProcess
+} icm20948_events_t;
+
+/*!
+ * @brief This API initializes the event detectors
+ *
+ * @param[in] det: Pointer to the detector to be initialized
+ * @param[in] cfg: Pointer to the detector configuration
+ *
+ * @return Returns the status of initialization
+ */
+icm20948_return_code_t icm20948_eventsInit(icm20948_events_t *det, const icm20948_events_cfg_t *cfg);
+
+/*!
+ * @brief This API runs a block of accel samples through the detectors, reporting events
+ * through the configured callback. Samples are skipped while gated.
+ *
+ * @param[in] det: Pointer to the detector
+ * @param[in] accel: Pointer to the block of accel samples, g
+ * @param[in] t0_us: Timestamp of the first sample in the block
+ *
+ * @return Returns the status of processing the block
+ */
+icm20948_return_code_t icm20948_eventsProcess(icm20948_events_t *det, const icm20948_fblock_t *accel, uint64_t t0_us);
+
+/*!
+ * @brief This API releases the detector from wake-on-motion gating. Safe to call from an
+ * interrupt; the release takes effect at the start of the next icm20948_eventsProcess().
+ *
+ * @param[in] det: Pointer to the detector
+ */
+void icm20948_eventsWake(icm20948_events_t *det);
+
+/*!
+ * @brief This API checks whether the detector is gated waiting for wake-on-motion
+ *
+ * @param[in] det: Pointer to the detector
+ *
+ * @return Returns true while samples are being skipped, false once a wake is pending
+ */
+bool icm20948_eventsGated(const icm20948_events_t *det);
+
+#endif // _ICM20948_EVENTS_H_
+
+#ifdef __cplusplus
+}
+#endif
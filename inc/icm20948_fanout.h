@@ -0,0 +1,206 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_fanout.h
+ * @brief Public header file for the ICM20948 single producer, multi subscriber fan out ring.
+ *
+ * The acquisition path publishes fixed size elements (any sample struct) into one
+ * shared ring, and every subscriber reads them in place through its own cursor, so an
+ * element is written once however many subscribers there are. Each subscriber picks
+ * what happens when it falls a full ring behind:
+ *  - DROP_OLDEST: the producer carries on and the subscriber skips ahead, counting the
+ *    samples it lost
+ *  - BLOCK: the producer may not overwrite what the subscriber hasn't released, so
+ *    reserve/publish accept fewer elements and the producer has to retry
+ *  - DECIMATE: as DROP_OLDEST, but the subscriber only sees every decimate'th element,
+ *    handed out as a strided span over the ring
+ *
+ * One producer and each subscriber may run in different threads (or the producer in an
+ * ISR) without locks. A DROP_OLDEST or DECIMATE subscriber can be lapped while reading,
+ * which icm20948_fanoutRelease detects and reports. Subscribing and unsubscribing are
+ * setup time operations, and metrics read from another thread are approximate.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_FANOUT_H_
+#define _ICM20948_FANOUT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "icm20948_api.h"
+
+#define ICM20948_FANOUT_MAX_SUBS            (8)
+
+typedef enum {
+    ICM20948_FANOUT_DROP_OLDEST = 0x00,
+    ICM20948_FANOUT_BLOCK = 0x01,
+    ICM20948_FANOUT_DECIMATE = 0x02
+} icm20948_fanout_policy_t;
+
+typedef struct {
+    uint32_t lag;               // Elements published but not yet consumed, at the last peek
+    uint32_t max_lag;
+    uint64_t delivered;
+    uint64_t dropped;           // Published elements lost to overruns, before decimation
+} icm20948_fanout_metrics_t;
+
+typedef struct {
+    bool active;
+    icm20948_fanout_policy_t policy;
+    uint32_t decimate;
+    uint32_t tail;              // Written by the subscriber only
+    uint32_t peeked;            // Cursor the last span started at
+    uint32_t peeked_count;      // Length of the last span
+    icm20948_fanout_metrics_t metrics;
+} icm20948_fanout_sub_t;
+
+typedef struct {
+    uint8_t *buf;
+    uint32_t elem_size;
+    uint32_t mask;
+    uint32_t head;              // Written by the producer only
+    uint32_t claim;             // End of the producer's reservation, head until it commits
+    icm20948_fanout_sub_t subs[ICM20948_FANOUT_MAX_SUBS];
+} icm20948_fanout_t;
+
+/*! @brief Run of elements handed to a subscriber, element i is at data + i * stride */
+typedef struct {
+    const uint8_t *data;
+    uint32_t count;
+    uint32_t stride;
+} icm20948_fanout_span_t;
+
+/*!
+ * @brief This API initializes a fan out ring over caller storage
+ *
+ * @param[in] f: Pointer to the ring to be initialized
+ * @param[in] buf: Pointer to the storage, capacity * elem_size bytes
+ * @param[in] elem_size: Size of one element
+ * @param[in] capacity: Number of elements, a power of 2 no larger than 2^30
+ *
+ * @return Returns the status of initialization
+ */
+icm20948_return_code_t icm20948_fanoutInit(icm20948_fanout_t *f, void *buf, uint32_t elem_size, uint32_t capacity);
+
+/*!
+ * @brief This API adds a subscriber. It only sees elements published from now on.
+ *
+ * @param[in] f: Pointer to the ring
+ * @param[in] policy: What to do when the subscriber falls a full ring behind
+ * @param[in] decimate: Keep one element in decimate, only used by DECIMATE
+ * @param[out] id: Pointer to where the subscriber id should be placed
+ *
+ * @return Returns the status of subscribing
+ */
+icm20948_return_code_t icm20948_fanoutSubscribe(icm20948_fanout_t *f, icm20948_fanout_policy_t policy, uint32_t decimate, uint8_t *id);
+
+/*!
+ * @brief This API removes a subscriber
+ *
+ * @param[in] f: Pointer to the ring
+ * @param[in] id: Subscriber id
+ *
+ * @return Returns the status of unsubscribing
+ */
+icm20948_return_code_t icm20948_fanoutUnsubscribe(icm20948_fanout_t *f, uint8_t id);
+
+/*!
+ * @brief This API reserves room for the producer to write elements in place. The run
+ * stops at the end of the ring and at the oldest element a BLOCK subscriber still holds.
+ *
+ * @param[in] f: Pointer to the ring
+ * @param[out] elems: Pointer to where the first free element should be placed
+ * @param[out] count: Pointer to where the number of contiguous free elements should be placed
+ *
+ * @return Returns the status of reserving
+ */
+icm20948_return_code_t icm20948_fanoutReserve(icm20948_fanout_t *f, void **elems, uint32_t *count);
+
+/*!
+ * @brief This API publishes elements written into a reservation
+ *
+ * @param[in] f: Pointer to the ring
+ * @param[in] count: Number of elements written, no more than were reserved
+ *
+ * @return Returns the status of publishing
+ */
+icm20948_return_code_t icm20948_fanoutCommit(icm20948_fanout_t *f, uint32_t count);
+
+/*!
+ * @brief This API copies elements into the ring and publishes them
+ *
+ * @param[in] f: Pointer to the ring
+ * @param[in] elems: Pointer to the elements
+ * @param[in] count: Number of elements
+ * @param[out] accepted: Pointer to where the number published should be placed, fewer
+ * than count only when a BLOCK subscriber is holding the ring
+ *
+ * @return Returns the status of publishing
+ */
+icm20948_return_code_t icm20948_fanoutPublish(icm20948_fanout_t *f, const void *elems, uint32_t count, uint32_t *accepted);
+
+/*!
+ * @brief This API hands a subscriber the next run of elements in place. The run stops at
+ * the end of the ring, so a second peek may follow a release.
+ *
+ * @param[in] f: Pointer to the ring
+ * @param[in] id: Subscriber id
+ * @param[out] span: Pointer to where the run should be placed, count is 0 if there is nothing new
+ *
+ * @return Returns the status of peeking
+ */
+icm20948_return_code_t icm20948_fanoutPeek(icm20948_fanout_t *f, uint8_t id, icm20948_fanout_span_t *span);
+
+/*!
+ * @brief This API releases elements a subscriber has finished with
+ *
+ * @param[in] f: Pointer to the ring
+ * @param[in] id: Subscriber id
+ * @param[in] count: Number of elements consumed from the last span
+ *
+ * @return Returns ICM20948_RET_GEN_FAIL if the producer overwrote part of the span while
+ * it was being read, in which case the data must be discarded
+ */
+icm20948_return_code_t icm20948_fanoutRelease(icm20948_fanout_t *f, uint8_t id, uint32_t count);
+
+/*!
+ * @brief This API retrieves a subscriber's lag and delivery counters
+ *
+ * @param[in] f: Pointer to the ring
+ * @param[in] id: Subscriber id
+ * @param[out] metrics: Pointer to where the metrics should be placed
+ *
+ * @return Returns the status of retrieving the metrics
+ */
+icm20948_return_code_t icm20948_fanoutGetMetrics(const icm20948_fanout_t *f, uint8_t id, icm20948_fanout_metrics_t *metrics);
+
+#endif // _ICM20948_FANOUT_H_
+
+#ifdef __cplusplus
+}
+#endif
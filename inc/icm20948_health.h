@@ -0,0 +1,117 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_health.h
+ * @brief Public header file for the ICM20948 sensor health monitor.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_HEALTH_H_
+#define _ICM20948_HEALTH_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "icm20948_api.h"
+#include "icm20948_stats.h"
+
+#define ICM20948_HEALTH_AXIS_COUNT          (3)
+
+typedef enum {
+    ICM20948_HEALTH_ALARM_STUCK = 0x00,
+    ICM20948_HEALTH_ALARM_NOISE_LOW = 0x01,
+    ICM20948_HEALTH_ALARM_NOISE_HIGH = 0x02,
+    ICM20948_HEALTH_ALARM_SPIKES = 0x03,
+    ICM20948_HEALTH_ALARM_COUNT
+} icm20948_health_alarm_t;
+
+typedef void(*icm20948_health_cb_t)(uint8_t axis, icm20948_health_alarm_t alarm, bool active, void *ctx);
+
+typedef struct {
+    uint32_t window;            // Samples per evaluation window
+    uint32_t stuck_run;         // Consecutive identical samples that count as stuck
+    float var_min;              // Noise floor, variance below this raises NOISE_LOW (LSB^2)
+    float var_max;              // Noise ceiling, variance above this raises NOISE_HIGH (LSB^2)
+    uint16_t spike_delta;       // Sample-to-sample step that counts as a spike (LSB)
+    uint32_t spike_max;         // Spikes tolerated per window before raising SPIKES
+    uint8_t raise_windows;      // Consecutive bad windows before an alarm is raised
+    uint8_t clear_windows;      // Consecutive good windows before an alarm is cleared
+    icm20948_health_cb_t cb;
+    void *ctx;
+} icm20948_health_cfg_t;
+
+typedef struct {
+    icm20948_health_cfg_t cfg;
+    icm20948_stats_t stats;
+    uint32_t spikes[ICM20948_HEALTH_AXIS_COUNT];
+    uint32_t run[ICM20948_HEALTH_AXIS_COUNT];
+    uint32_t max_run[ICM20948_HEALTH_AXIS_COUNT];
+    int16_t last[ICM20948_HEALTH_AXIS_COUNT];
+    bool primed;
+    uint8_t bad[ICM20948_HEALTH_AXIS_COUNT][ICM20948_HEALTH_ALARM_COUNT];
+    uint8_t good[ICM20948_HEALTH_AXIS_COUNT][ICM20948_HEALTH_ALARM_COUNT];
+    uint8_t active[ICM20948_HEALTH_AXIS_COUNT];
+    float variance[ICM20948_HEALTH_AXIS_COUNT];
+} icm20948_health_t;
+
+/*!
+ * @brief This API initializes a health monitor with the given configuration
+ *
+ * @param[in] mon: Pointer to the health monitor to be initialized
+ * @param[in] cfg: Pointer to the monitor configuration
+ *
+ * @return Returns the status of initialization
+ */
+icm20948_return_code_t icm20948_healthInit(icm20948_health_t *mon, const icm20948_health_cfg_t *cfg);
+
+/*!
+ * @brief This API feeds a block of raw samples through the health monitor. Alarms
+ * are evaluated at the end of every window, and state changes are reported through
+ * the configured callback. Cost is constant per sample.
+ *
+ * @param[in] mon: Pointer to the health monitor
+ * @param[in] block: Pointer to the block of raw samples
+ *
+ * @return Returns the status of processing the block
+ */
+icm20948_return_code_t icm20948_healthProcess(icm20948_health_t *mon, const icm20948_block_t *block);
+
+/*!
+ * @brief This API retrieves the currently active alarms for an axis
+ *
+ * @param[in] mon: Pointer to the health monitor
+ * @param[in] axis: Axis index (0 = X, 1 = Y, 2 = Z)
+ *
+ * @return Returns a bitmask of active alarms, bit N set for alarm N
+ */
+uint8_t icm20948_healthGetAlarms(const icm20948_health_t *mon, uint8_t axis);
+
+#endif // _ICM20948_HEALTH_H_
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,177 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_log.h
+ * @brief Public header file for the ICM20948 binary sample log format.
+ *
+ * A log is a 16 byte header followed by fixed size frames. All fields are little
+ * endian.
+ *
+ *   Offset  Size  Field
+ *   0       4     Magic, "ICML"
+ *   4       1     Format version
+ *   5       1     Channel mask, see icm20948_log_channel_t
+ *   6       1     Quaternion encoding, see icm20948_quat_enc_t (0 before version 2)
+ *   7       1     Reserved, 0
+ *   8       4     Sample period in us
+ *   12      1     Accel full scale select
+ *   13      1     Gyro full scale select
+ *   14      2     Reserved, 0
+ *
+ * Each frame holds the raw int16 X, Y, Z counts of every enabled channel, in
+ * channel bit order (accel then gyro), followed by the encoded orientation when the
+ * quaternion channel is enabled. Version 1 logs, which predate the quaternion
+ * channel, are still read.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_LOG_H_
+#define _ICM20948_LOG_H_
+
+#include <stdint.h>
+#include "icm20948_api.h"
+#include "icm20948_quatenc.h"
+
+#define ICM20948_LOG_MAGIC                  (0x4C4D4349)
+#define ICM20948_LOG_VERSION                (2)
+#define ICM20948_LOG_HEADER_SIZE            (16)
+#define ICM20948_LOG_CHUNK_FRAMES           (16)
+#define ICM20948_LOG_MAX_FRAME_SIZE         (28)
+
+typedef enum {
+    ICM20948_LOG_CH_ACCEL = 0x01,
+    ICM20948_LOG_CH_GYRO = 0x02,
+    ICM20948_LOG_CH_QUAT = 0x04
+} icm20948_log_channel_t;
+
+typedef int8_t(*icm20948_log_write_fptr_t)(void *ctx, const uint8_t *data, uint32_t len);
+
+typedef struct {
+    uint8_t channels;
+    uint32_t sample_period_us;
+    icm20948_accel_full_scale_select_t accel_fs;
+    icm20948_gyro_full_scale_select_t gyro_fs;
+    icm20948_quat_enc_t quat_enc;
+} icm20948_log_header_t;
+
+typedef struct {
+    icm20948_log_header_t hdr;
+    icm20948_log_write_fptr_t write;
+    void *ctx;
+    uint64_t frames;
+} icm20948_log_writer_t;
+
+/*!
+ * @brief This API computes the size of one frame for the given header
+ *
+ * @param[in] hdr: Pointer to the log header
+ *
+ * @return Returns the frame size in bytes
+ */
+uint32_t icm20948_logFrameSize(const icm20948_log_header_t *hdr);
+
+/*!
+ * @brief This API initializes a log writer and writes out the log header
+ *
+ * @param[in] w: Pointer to the writer to be initialized
+ * @param[in] hdr: Pointer to the header describing the log
+ * @param[in] write: Function pointer to the developers output function
+ * @param[in] ctx: Context handed back to the output function
+ *
+ * @return Returns the status of writing the header
+ */
+icm20948_return_code_t icm20948_logWriterInit(icm20948_log_writer_t *w, const icm20948_log_header_t *hdr, icm20948_log_write_fptr_t write, void *ctx);
+
+/*!
+ * @brief This API appends raw sample blocks to the log. Blocks for channels not in the
+ * header may be NULL, and all enabled blocks must be the same length.
+ *
+ * @param[in] w: Pointer to the log writer
+ * @param[in] accel: Pointer to the raw accel block
+ * @param[in] gyro: Pointer to the raw gyro block
+ *
+ * @return Returns the status of writing the frames
+ */
+icm20948_return_code_t icm20948_logWrite(icm20948_log_writer_t *w, const icm20948_block_t *accel, const icm20948_block_t *gyro);
+
+/*!
+ * @brief This API appends raw sample blocks and orientations to the log. Inputs for
+ * channels not in the header may be NULL, and all enabled inputs must be the same length.
+ *
+ * @param[in] w: Pointer to the log writer
+ * @param[in] accel: Pointer to the raw accel block
+ * @param[in] gyro: Pointer to the raw gyro block
+ * @param[in] quat: Pointer to the orientations, one per frame
+ * @param[in] count: Number of orientations, only used when the log holds no accel or gyro
+ *
+ * @return Returns the status of writing the frames
+ */
+icm20948_return_code_t icm20948_logWriteFrames(icm20948_log_writer_t *w, const icm20948_block_t *accel, const icm20948_block_t *gyro, const icm20948_quat_t *quat, uint32_t count);
+
+/*!
+ * @brief This API parses and validates a log header
+ *
+ * @param[in] buf: Pointer to the first bytes of the log
+ * @param[in] len: Number of bytes available in buf
+ * @param[out] hdr: Pointer to where the parsed header should be placed
+ *
+ * @return Returns the status of parsing the header
+ */
+icm20948_return_code_t icm20948_logParseHeader(const uint8_t *buf, uint32_t len, icm20948_log_header_t *hdr);
+
+/*!
+ * @brief This API unpacks frames into raw sample blocks. On entry each block's len is
+ * its capacity, on return it is the number of samples placed in it.
+ *
+ * @param[in] hdr: Pointer to the header of the log the frames belong to
+ * @param[in] frames: Pointer to the packed frames
+ * @param[in] count: Number of frames to unpack
+ * @param[in,out] accel: Pointer to the raw accel block to fill, may be NULL
+ * @param[in,out] gyro: Pointer to the raw gyro block to fill, may be NULL
+ *
+ * @return Returns the status of unpacking the frames
+ */
+icm20948_return_code_t icm20948_logUnpack(const icm20948_log_header_t *hdr, const uint8_t *frames, uint32_t count, icm20948_block_t *accel, icm20948_block_t *gyro);
+
+/*!
+ * @brief This API decodes the orientations out of frames
+ *
+ * @param[in] hdr: Pointer to the header of the log the frames belong to
+ * @param[in] frames: Pointer to the packed frames
+ * @param[in] count: Number of frames to unpack
+ * @param[out] quat: Pointer to the decoded orientations, room for count
+ *
+ * @return Returns the status of unpacking the orientations
+ */
+icm20948_return_code_t icm20948_logUnpackQuat(const icm20948_log_header_t *hdr, const uint8_t *frames, uint32_t count, icm20948_quat_t *quat);
+
+#endif // _ICM20948_LOG_H_
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,143 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_pedometer.h
+ * @brief Public header file for the ICM20948 step counter and activity level classifier.
+ *
+ * Steps are found on the accel magnitude, so the count doesn't depend on how the
+ * device is worn. Gravity is tracked with a slow mean and removed, the remainder is
+ * smoothed and a step is a downward crossing of a threshold that adapts to the
+ * midpoint of the signal's recent swing. A crossing only counts if the swing was at
+ * least min_peak_to_peak and the step interval lies within the allowed range, and
+ * steps are only credited once regulation_steps have followed one another without a
+ * gap, which rejects isolated jolts.
+ *
+ * The activity level is the RMS of the gravity-free magnitude over each epoch.
+ *
+ * All state is carried between calls so blocks may be any length, which lets the host
+ * sleep between FIFO drains with the accel duty-cycled (see icm20948_enableAccelCycle).
+ * Output rates of 25 to 100Hz are plenty.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_PEDOMETER_H_
+#define _ICM20948_PEDOMETER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "icm20948_api.h"
+
+typedef enum {
+    ICM20948_ACTIVITY_SEDENTARY = 0x00,
+    ICM20948_ACTIVITY_LIGHT = 0x01,
+    ICM20948_ACTIVITY_MODERATE = 0x02,
+    ICM20948_ACTIVITY_VIGOROUS = 0x03,
+    ICM20948_ACTIVITY_LEVELS = 0x04
+} icm20948_activity_level_t;
+
+typedef struct {
+    uint32_t sample_period_us;
+    float smoothing_hz;             // Low pass cutoff applied before step detection
+    uint32_t min_step_interval_ms;  // Fastest cadence accepted, e.g. 250ms
+    uint32_t max_step_interval_ms;  // Slowest cadence accepted, also the gravity tracking time constant
+    float min_peak_to_peak;         // Smallest swing in g that can make a step
+    uint32_t regulation_steps;      // Consecutive steps needed before counting starts
+    uint32_t epoch_ms;              // Activity level averaging period
+    float level_thresholds[ICM20948_ACTIVITY_LEVELS - 1];   // RMS g to reach LIGHT, MODERATE and VIGOROUS
+} icm20948_pedometer_cfg_t;
+
+typedef struct {
+    uint32_t steps;
+    float cadence;                  // Steps per minute, 0 when not walking
+    icm20948_activity_level_t level;    // Level of the last complete epoch
+    uint32_t level_epochs[ICM20948_ACTIVITY_LEVELS];    // Epochs spent at each level
+} icm20948_pedometer_status_t;
+
+typedef struct {
+    icm20948_pedometer_cfg_t cfg;
+    icm20948_pedometer_status_t status;
+    // Filters
+    float grav_alpha;
+    float smooth_alpha;
+    float grav;
+    float smooth;
+    bool primed;
+    // Adaptive threshold
+    uint32_t window_len;
+    uint32_t window_count;
+    float window_max;
+    float window_min;
+    float threshold;
+    float peak_to_peak;
+    // Step timing in samples
+    uint32_t min_interval;
+    uint32_t max_interval;
+    uint32_t since_step;
+    uint32_t pending;
+    bool regular;
+    // Activity epoch
+    uint32_t epoch_len;
+    uint32_t epoch_count;
+    double epoch_sumsq;
+} icm20948_pedometer_t;
+
+/*!
+ * @brief This API initializes the step counter
+ *
+ * @param[in] ped: Pointer to the step counter to be initialized
+ * @param[in] cfg: Pointer to the step counter configuration
+ *
+ * @return Returns the status of initialization
+ */
+icm20948_return_code_t icm20948_pedometerInit(icm20948_pedometer_t *ped, const icm20948_pedometer_cfg_t *cfg);
+
+/*!
+ * @brief This API runs a block of accel samples through the step counter
+ *
+ * @param[in] ped: Pointer to the step counter
+ * @param[in] accel: Pointer to the block of accel samples, g
+ *
+ * @return Returns the status of processing the block
+ */
+icm20948_return_code_t icm20948_pedometerProcess(icm20948_pedometer_t *ped, const icm20948_fblock_t *accel);
+
+/*!
+ * @brief This API retrieves the step count and activity level
+ *
+ * @param[in] ped: Pointer to the step counter
+ * @param[out] status: Pointer to where the status should be placed
+ *
+ * @return Returns the status of retrieving the status
+ */
+icm20948_return_code_t icm20948_pedometerGetStatus(const icm20948_pedometer_t *ped, icm20948_pedometer_status_t *status);
+
+#endif // _ICM20948_PEDOMETER_H_
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,151 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+
+/*! @file icm20948_pingpong.h
+ * @brief Public header file for the ICM20948 double buffered acquisition.
+ *
+ * Acquisition alternates between two caller buffers. The bus fills one of them while
+ * the other is processed. Each call to icm20948_pingpongPoll() runs one acquisition
+ * step straight into the filling buffer: either a FIFO drain (icm20948_readFifoBytes)
+ * or one accel+gyro burst (icm20948_readBurst). Call it from the FIFO watermark or data
+ * ready interrupt, or from a timer for periodic bursts.
+ *
+ * Once a buffer reaches its watermark, ownership passes to the consumer through the
+ * ready callback and filling moves on to the other buffer. The driver does not touch a
+ * buffer again until the consumer hands it back with icm20948_pingpongRelease(), which
+ * may be called from another thread or from inside the callback. The bytes are left
+ * exactly as read from the bus; unpack them with icm20948_parseFifo(), passing the
+ * layout handed off with the buffer, or icm20948_decodeBurst().
+ *
+ * A buffer only ever holds frames of one layout. When a drain comes back with a
+ * different layout, because the FIFO was reconfigured, the filling buffer is handed off
+ * early and the new frames start the other one. If the consumer still holds that one
+ * the new frames are dropped and counted as an overrun.
+ *
+ * If the consumer still holds the next buffer, the poll stalls and counts an overrun.
+ * In FIFO mode the samples stay in the chip's FIFO until a later poll; in burst mode
+ * the sample is skipped.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_PINGPONG_H_
+#define _ICM20948_PINGPONG_H_
+
+#include <stdint.h>
+#include "icm20948_api.h"
+
+typedef enum {
+    ICM20948_PINGPONG_FIFO = 0x00,      // Drain the FIFO on each poll
+    ICM20948_PINGPONG_BURST             // Read one ICM20948_BURST_SIZE burst on each poll
+} icm20948_pingpong_src_t;
+
+/*! @brief Ownership hand-off, called with a filled buffer, the number of bytes in it and
+ * the layout of its FIFO frames, NULL for ICM20948_PINGPONG_BURST */
+typedef void(*icm20948_pingpong_ready_fptr_t)(void *ctx, uint8_t *buf, uint32_t len, const icm20948_fifo_layout_t *layout);
+
+typedef struct {
+    icm20948_pingpong_src_t src;
+    uint8_t *buf[2];
+    uint32_t size;              // Capacity of each buffer
+    uint32_t watermark;         // Hand a buffer off once it holds this many bytes
+    icm20948_pingpong_ready_fptr_t ready;
+    void *ctx;
+    uint32_t owned[2];          // Set while the consumer holds the buffer
+    uint32_t active;            // Buffer being filled
+    uint32_t fill;
+    icm20948_fifo_layout_t layout[2];   // Layout of the frames in each buffer
+    uint32_t handoffs;
+    uint32_t overruns;
+} icm20948_pingpong_t;
+
+/*!
+ * @brief This API initializes double buffered acquisition. The FIFO must already be
+ * enabled for ICM20948_PINGPONG_FIFO.
+ *
+ * @param[in] pp: Pointer to the acquisition state to be initialized
+ * @param[in] src: Where each poll reads from
+ * @param[in] buf0: Pointer to the first buffer
+ * @param[in] buf1: Pointer to the second buffer
+ * @param[in] size: Capacity of each buffer, at least ICM20948_BURST_SIZE
+ * @param[in] watermark: Bytes that trigger a hand-off, 0 for a full buffer. A buffer is
+ * also handed off once less than ICM20948_BURST_SIZE bytes of room are left.
+ * @param[in] ready: Function pointer to the hand-off callback
+ * @param[in] ctx: Context handed back to the callback
+ *
+ * @return Returns the status of initialization
+ */
+icm20948_return_code_t icm20948_pingpongInit(icm20948_pingpong_t *pp, icm20948_pingpong_src_t src, uint8_t *buf0, uint8_t *buf1,
+                                             uint32_t size, uint32_t watermark, icm20948_pingpong_ready_fptr_t ready, void *ctx);
+
+/*!
+ * @brief This API runs one acquisition step into the filling buffer, and hands the
+ * buffer off if it reached its watermark
+ *
+ * @param[in] pp: Pointer to the acquisition state
+ *
+ * @return Returns the status of the bus read, OK on an overrun
+ */
+icm20948_return_code_t icm20948_pingpongPoll(icm20948_pingpong_t *pp);
+
+/*!
+ * @brief This API hands off the filling buffer early if it holds any data, e.g. before
+ * stopping acquisition
+ *
+ * @param[in] pp: Pointer to the acquisition state
+ *
+ * @return Returns the status of the flush
+ */
+icm20948_return_code_t icm20948_pingpongFlush(icm20948_pingpong_t *pp);
+
+/*!
+ * @brief This API hands a buffer back from the consumer
+ *
+ * @param[in] pp: Pointer to the acquisition state
+ * @param[in] buf: Pointer to the buffer given to the ready callback
+ *
+ * @return Returns INV_PARAM if the buffer isn't one of the pair or isn't held by the consumer
+ */
+icm20948_return_code_t icm20948_pingpongRelease(icm20948_pingpong_t *pp, const uint8_t *buf);
+
+/*!
+ * @brief This API retrieves the hand-off and overrun counts
+ *
+ * @param[in] pp: Pointer to the acquisition state
+ * @param[out] handoffs: Pointer to where the number of buffers handed off should be placed
+ * @param[out] overruns: Pointer to where the number of stalled polls should be placed
+ *
+ * @return Returns the status of retrieving the counts
+ */
+icm20948_return_code_t icm20948_pingpongGetStats(const icm20948_pingpong_t *pp, uint32_t *handoffs, uint32_t *overruns);
+
+#endif // _ICM20948_PINGPONG_H_
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,250 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_pipeline.h
+ * @brief Public header file for the ICM20948 processing pipeline.
+ *
+ * A pipeline is a list of stages wired together by buffers. Everything is declared
+ * once at startup: buffers are carved out of a caller supplied arena, each sized for
+ * one block of samples, and stages name the buffers they read and write by id. After
+ * that icm20948_pipelineRun() just calls the stages in declaration order, each working
+ * directly on the shared buffers, so nothing is allocated or copied on the way through.
+ *
+ * Declaration order is execution order, so a stage sees whatever the stages before it
+ * wrote. A stage may list a buffer as both input and output to work in place. Buffers
+ * no stage writes are sources, filled by the caller before each run.
+ *
+ * When a clock is supplied every stage is timed on every run. Ticks are in whatever
+ * unit the clock counts.
+ *
+ * Stages are handed the number of buffers they were declared with and must check it
+ * before touching a port; unused ports are NULL.
+ *
+ * Adapters for the FIFO drain, raw conversion, the binary log and the health monitor are
+ * provided, e.g. FIFO drain -> convert -> log can be declared without any glue code.
+ * Other modules are wrapped by a stage of the caller's own.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_PIPELINE_H_
+#define _ICM20948_PIPELINE_H_
+
+#include <stdint.h>
+#include "icm20948_api.h"
+
+#define ICM20948_PIPELINE_MAX_STAGES        (16)
+#define ICM20948_PIPELINE_MAX_BUFFERS       (16)
+#define ICM20948_PIPELINE_MAX_PORTS         (4)
+
+typedef enum {
+    ICM20948_PIPE_RAW3 = 0x00,      // icm20948_block_t
+    ICM20948_PIPE_FLOAT3 = 0x01,    // icm20948_fblock_t
+    ICM20948_PIPE_QUAT = 0x02,      // icm20948_quat_t array
+    ICM20948_PIPE_FLOAT = 0x03      // float array
+} icm20948_pipe_type_t;
+
+typedef struct {
+    icm20948_pipe_type_t type;
+    uint32_t capacity;
+    union {
+        icm20948_block_t raw;       // len is the valid sample count
+        icm20948_fblock_t f3;       // len is the valid sample count
+        struct {
+            icm20948_quat_t *data;
+            uint32_t len;
+        } quat;
+        struct {
+            float *data;
+            uint32_t len;
+        } scalar;
+    } u;
+} icm20948_pipe_buf_t;
+
+typedef icm20948_return_code_t(*icm20948_pipe_stage_fptr_t)(void *ctx, icm20948_pipe_buf_t *const *in, uint8_t n_in, icm20948_pipe_buf_t *const *out, uint8_t n_out);
+typedef uint64_t(*icm20948_pipe_clock_fptr_t)(void);
+
+typedef struct {
+    uint64_t calls;
+    uint64_t total;             // Ticks
+    uint64_t max;
+    uint64_t last;
+} icm20948_pipe_timing_t;
+
+typedef struct {
+    const char *name;
+    icm20948_pipe_stage_fptr_t run;
+    void *ctx;
+    uint8_t in[ICM20948_PIPELINE_MAX_PORTS];
+    uint8_t out[ICM20948_PIPELINE_MAX_PORTS];
+    uint8_t n_in;
+    uint8_t n_out;
+    icm20948_pipe_timing_t timing;
+} icm20948_pipe_stage_t;
+
+typedef struct {
+    uint8_t *base;
+    uint32_t size;
+    uint32_t used;
+} icm20948_arena_t;
+
+typedef struct {
+    icm20948_arena_t *arena;
+    uint32_t block_capacity;
+    icm20948_pipe_clock_fptr_t clock;
+    icm20948_pipe_stage_t stages[ICM20948_PIPELINE_MAX_STAGES];
+    icm20948_pipe_buf_t bufs[ICM20948_PIPELINE_MAX_BUFFERS];
+    uint8_t n_stages;
+    uint8_t n_bufs;
+} icm20948_pipeline_t;
+
+/*!
+ * @brief This API initializes an arena over caller storage
+ *
+ * @param[in] arena: Pointer to the arena to be initialized
+ * @param[in] mem: Pointer to the storage
+ * @param[in] size: Size of the storage in bytes
+ *
+ * @return Returns the status of initialization
+ */
+icm20948_return_code_t icm20948_arenaInit(icm20948_arena_t *arena, void *mem, uint32_t size);
+
+/*!
+ * @brief This API takes memory from an arena. There is no free, the arena is released as a whole.
+ *
+ * @param[in] arena: Pointer to the arena
+ * @param[in] size: Number of bytes wanted
+ * @param[in] align: Alignment wanted, a power of 2
+ *
+ * @return Returns the memory, NULL if the arena is exhausted
+ */
+void *icm20948_arenaAlloc(icm20948_arena_t *arena, uint32_t size, uint32_t align);
+
+/*!
+ * @brief This API initializes a pipeline
+ *
+ * @param[in] p: Pointer to the pipeline to be initialized
+ * @param[in] arena: Pointer to the arena buffers are taken from
+ * @param[in] block_capacity: Samples each buffer holds
+ * @param[in] clock: Function pointer to a tick counter used for stage timing, may be NULL
+ *
+ * @return Returns the status of initialization
+ */
+icm20948_return_code_t icm20948_pipelineInit(icm20948_pipeline_t *p, icm20948_arena_t *arena, uint32_t block_capacity, icm20948_pipe_clock_fptr_t clock);
+
+/*!
+ * @brief This API declares a buffer and allocates its storage
+ *
+ * @param[in] p: Pointer to the pipeline
+ * @param[in] type: Type of samples the buffer holds
+ * @param[out] id: Pointer to where the buffer id should be placed
+ *
+ * @return Returns the status of declaring the buffer, ICM20948_RET_INV_CONFIG when the
+ * arena or buffer table is exhausted
+ */
+icm20948_return_code_t icm20948_pipelineAddBuffer(icm20948_pipeline_t *p, icm20948_pipe_type_t type, uint8_t *id);
+
+/*!
+ * @brief This API declares a stage, to run after all stages declared before it
+ *
+ * @param[in] p: Pointer to the pipeline
+ * @param[in] name: Name of the stage, kept by reference
+ * @param[in] run: Function pointer to the stage
+ * @param[in] ctx: Context handed back to the stage
+ * @param[in] in: Pointer to the ids of the buffers read
+ * @param[in] n_in: Number of buffers read
+ * @param[in] out: Pointer to the ids of the buffers written
+ * @param[in] n_out: Number of buffers written
+ *
+ * @return Returns the status of declaring the stage
+ */
+icm20948_return_code_t icm20948_pipelineAddStage(icm20948_pipeline_t *p, const char *name, icm20948_pipe_stage_fptr_t run, void *ctx,
+                                                 const uint8_t *in, uint8_t n_in, const uint8_t *out, uint8_t n_out);
+
+/*!
+ * @brief This API retrieves a buffer, for filling sources and reading results
+ *
+ * @param[in] p: Pointer to the pipeline
+ * @param[in] id: Buffer id
+ *
+ * @return Returns the buffer, NULL for an unknown id
+ */
+icm20948_pipe_buf_t *icm20948_pipelineBuffer(icm20948_pipeline_t *p, uint8_t id);
+
+/*!
+ * @brief This API runs every stage once, in declaration order, stopping at the first failure
+ *
+ * @param[in] p: Pointer to the pipeline
+ *
+ * @return Returns the status of the first failing stage, or ICM20948_RET_OK
+ */
+icm20948_return_code_t icm20948_pipelineRun(icm20948_pipeline_t *p);
+
+/*!
+ * @brief This API retrieves a stage's timing
+ *
+ * @param[in] p: Pointer to the pipeline
+ * @param[in] stage: Index of the stage, in declaration order
+ * @param[out] timing: Pointer to where the timing should be placed
+ *
+ * @return Returns the status of retrieving the timing
+ */
+icm20948_return_code_t icm20948_pipelineGetTiming(const icm20948_pipeline_t *p, uint8_t stage, icm20948_pipe_timing_t *timing);
+
+#if ICM20948_FEATURE_FIFO
+/*!
+ * @brief Stage draining the FIFO. No inputs, outputs RAW3 accel and RAW3 gyro. ctx is unused.
+ * Returns ICM20948_RET_INV_CONFIG when declared with fewer than 2 outputs.
+ */
+icm20948_return_code_t icm20948_pipeStageReadFifo(void *ctx, icm20948_pipe_buf_t *const *in, uint8_t n_in, icm20948_pipe_buf_t *const *out, uint8_t n_out);
+#endif
+
+/*!
+ * @brief Stage scaling raw samples. Input RAW3, output FLOAT3. ctx points to an icm20948_sensor_t.
+ * Returns ICM20948_RET_INV_CONFIG when declared without an input or an output.
+ */
+icm20948_return_code_t icm20948_pipeStageConvert(void *ctx, icm20948_pipe_buf_t *const *in, uint8_t n_in, icm20948_pipe_buf_t *const *out, uint8_t n_out);
+
+/*!
+ * @brief Stage appending to a binary log. Inputs RAW3 accel, RAW3 gyro and QUAT orientations as the
+ * log header enables them, in that order, no outputs. ctx points to an icm20948_log_writer_t. Returns
+ * ICM20948_RET_INV_CONFIG when declared with fewer inputs than enabled channels, ICM20948_RET_INV_PARAM
+ * when the orientations do not match the raw blocks one for one.
+ */
+icm20948_return_code_t icm20948_pipeStageLog(void *ctx, icm20948_pipe_buf_t *const *in, uint8_t n_in, icm20948_pipe_buf_t *const *out, uint8_t n_out);
+
+/*!
+ * @brief Stage feeding the health monitor. Input RAW3, no outputs. ctx points to an icm20948_health_t.
+ * Returns ICM20948_RET_INV_CONFIG when declared without an input.
+ */
+icm20948_return_code_t icm20948_pipeStageHealth(void *ctx, icm20948_pipe_buf_t *const *in, uint8_t n_in, icm20948_pipe_buf_t *const *out, uint8_t n_out);
+
+#endif // _ICM20948_PIPELINE_H_
+
+#ifdef __cplusplus
+}
+#endif
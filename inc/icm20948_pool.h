@@ -0,0 +1,161 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_pool.h
+ * @brief Public header file for the ICM20948 fixed size block pool.
+ *
+ * A pool hands out fixed size blocks from caller storage without malloc or locks, so
+ * it can be used from an ISR as well as from threads. Free blocks sit on a lock-free
+ * stack whose head packs a 16 bit index with a 16 bit tag, which keeps the ABA window
+ * out of reach and needs nothing wider than a 32 bit compare-and-swap.
+ *
+ * Every block carries a reference count so it can be handed to several consumers
+ * (e.g. fan out subscribers): icm20948_poolRetain() for each extra owner, and the block
+ * returns to the pool when the last owner calls icm20948_poolRelease(). The pool keeps
+ * its in-use high-water mark and a count of failed allocations for sizing.
+ *
+ * icm20948_poolAllocRaw() and icm20948_poolAllocFloat() lay a 3-axis sample block out
+ * in one pool block, ready to pass to icm20948_readFifo() or icm20948_convertBlock().
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_POOL_H_
+#define _ICM20948_POOL_H_
+
+#include <stdint.h>
+#include "icm20948_api.h"
+
+#define ICM20948_POOL_MAX_BLOCKS            (0xFFFF)
+
+typedef struct {
+    uint32_t count;
+    uint32_t in_use;
+    uint32_t high_water;
+    uint32_t failures;
+} icm20948_pool_stats_t;
+
+typedef struct {
+    uint8_t *blocks;
+    uint32_t block_size;
+    uint32_t count;
+    uint16_t *next;             // Free stack links
+    uint32_t *refs;
+    uint32_t head;              // Tag in the top 16 bits, index in the bottom 16
+    uint32_t in_use;
+    uint32_t high_water;
+    uint32_t failures;
+} icm20948_pool_t;
+
+/*!
+ * @brief This API computes the storage a pool needs
+ *
+ * @param[in] block_size: Size of one block in bytes
+ * @param[in] count: Number of blocks
+ *
+ * @return Returns the size in bytes, blocks first and then the bookkeeping
+ */
+uint32_t icm20948_poolRequiredSize(uint32_t block_size, uint32_t count);
+
+/*!
+ * @brief This API initializes a pool over caller storage
+ *
+ * @param[in] pool: Pointer to the pool to be initialized
+ * @param[in] mem: Pointer to icm20948_poolRequiredSize() bytes, aligned for the block contents
+ * @param[in] block_size: Size of one block in bytes, rounded up to a multiple of 4
+ * @param[in] count: Number of blocks, up to ICM20948_POOL_MAX_BLOCKS - 1
+ *
+ * @return Returns the status of initialization
+ */
+icm20948_return_code_t icm20948_poolInit(icm20948_pool_t *pool, void *mem, uint32_t block_size, uint32_t count);
+
+/*!
+ * @brief This API takes a block from the pool with a reference count of 1
+ *
+ * @param[in] pool: Pointer to the pool
+ *
+ * @return Returns the block, NULL if the pool is empty
+ */
+void *icm20948_poolAlloc(icm20948_pool_t *pool);
+
+/*!
+ * @brief This API adds an owner to a block
+ *
+ * @param[in] pool: Pointer to the pool
+ * @param[in] block: Pointer to the block, or to anywhere inside it
+ *
+ * @return Returns the status of retaining the block
+ */
+icm20948_return_code_t icm20948_poolRetain(icm20948_pool_t *pool, const void *block);
+
+/*!
+ * @brief This API drops an owner from a block, returning it to the pool with the last
+ *
+ * @param[in] pool: Pointer to the pool
+ * @param[in] block: Pointer to the block, or to anywhere inside it
+ *
+ * @return Returns the status of releasing the block
+ */
+icm20948_return_code_t icm20948_poolRelease(icm20948_pool_t *pool, const void *block);
+
+/*!
+ * @brief This API takes a block and lays a raw 3-axis sample block out in it, with len
+ * set to the capacity. Release it through block->x.
+ *
+ * @param[in] pool: Pointer to the pool
+ * @param[out] block: Pointer to the sample block to set up
+ *
+ * @return Returns the status of allocating, ICM20948_RET_GEN_FAIL if the pool is empty
+ */
+icm20948_return_code_t icm20948_poolAllocRaw(icm20948_pool_t *pool, icm20948_block_t *block);
+
+/*!
+ * @brief This API takes a block and lays a scaled 3-axis sample block out in it, with len
+ * set to the capacity. Release it through block->x.
+ *
+ * @param[in] pool: Pointer to the pool
+ * @param[out] block: Pointer to the sample block to set up
+ *
+ * @return Returns the status of allocating, ICM20948_RET_GEN_FAIL if the pool is empty
+ */
+icm20948_return_code_t icm20948_poolAllocFloat(icm20948_pool_t *pool, icm20948_fblock_t *block);
+
+/*!
+ * @brief This API retrieves the pool usage counters
+ *
+ * @param[in] pool: Pointer to the pool
+ * @param[out] stats: Pointer to where the counters should be placed
+ *
+ * @return Returns the status of retrieving the counters
+ */
+icm20948_return_code_t icm20948_poolGetStats(const icm20948_pool_t *pool, icm20948_pool_stats_t *stats);
+
+#endif // _ICM20948_POOL_H_
+
+#ifdef __cplusplus
+}
+#endif
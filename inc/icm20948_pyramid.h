@@ -0,0 +1,185 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_pyramid.h
+ * @brief Public header file for the ICM20948 min/max/mean log pyramid.
+ *
+ * Alongside a binary log (see icm20948_log.h) a pyramid of summaries is built while
+ * recording, so a viewer can draw any span at any zoom by reading a bounded number of
+ * records. Level 0 is the log itself. Each bin of level l covers 2^(l * fanout_log2)
+ * frames and each level is written to its own stream: a 16 byte header followed by
+ * fixed size records, all little endian.
+ *
+ *   Offset  Size  Field
+ *   0       4     Magic, "ICMP"
+ *   4       1     Format version
+ *   5       1     Channel mask, accel and gyro only
+ *   6       1     Level, 1 or more
+ *   7       1     Fan out, log2
+ *   8       4     Sample period in us
+ *   12      1     Accel full scale select
+ *   13      1     Gyro full scale select
+ *   14      2     Reserved, 0
+ *
+ * Record k of level l summarizes frames [k * 2^(l * fanout_log2), (k + 1) * 2^(l * fanout_log2)).
+ * For each enabled channel in channel bit order it holds, per axis X, Y, Z, the int16
+ * min, max and mean of the raw counts. Means are rounded from exact sums, not averaged
+ * from the level below. Only the last record of each level may cover fewer frames, and
+ * it is written by icm20948_pyramidFlush.
+ *
+ * Work per frame is constant: frames update level 1 and each completed bin is folded
+ * into the level above.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_PYRAMID_H_
+#define _ICM20948_PYRAMID_H_
+
+#include <stdint.h>
+#include "icm20948_api.h"
+#include "icm20948_log.h"
+
+#define ICM20948_PYRAMID_MAGIC              (0x504D4349)
+#define ICM20948_PYRAMID_VERSION            (1)
+#define ICM20948_PYRAMID_HEADER_SIZE        (16)
+#define ICM20948_PYRAMID_MAX_LEVELS         (8)
+#define ICM20948_PYRAMID_LANES              (6)
+
+typedef int8_t(*icm20948_pyramid_write_fptr_t)(void *ctx, uint8_t level, const uint8_t *data, uint32_t len);
+
+typedef struct {
+    int16_t min[ICM20948_PYRAMID_LANES];
+    int16_t max[ICM20948_PYRAMID_LANES];
+    int64_t sum[ICM20948_PYRAMID_LANES];
+    uint64_t count;
+} icm20948_pyramid_bin_t;
+
+typedef struct {
+    icm20948_log_header_t hdr;
+    uint8_t fanout_log2;
+    uint8_t levels;
+    uint8_t lanes;
+    icm20948_pyramid_write_fptr_t write;
+    void *ctx;
+    icm20948_pyramid_bin_t bins[ICM20948_PYRAMID_MAX_LEVELS];
+    uint32_t children[ICM20948_PYRAMID_MAX_LEVELS];
+} icm20948_pyramid_t;
+
+typedef struct {
+    int16_t min[3];
+    int16_t max[3];
+    int16_t mean[3];
+} icm20948_pyramid_summary_t;
+
+/*!
+ * @brief This API computes the size of one record for the given log header
+ *
+ * @param[in] hdr: Pointer to the log header
+ *
+ * @return Returns the record size in bytes
+ */
+uint32_t icm20948_pyramidRecordSize(const icm20948_log_header_t *hdr);
+
+/*!
+ * @brief This API initializes a pyramid builder and writes out each level's header
+ *
+ * @param[in] pyr: Pointer to the builder to be initialized
+ * @param[in] hdr: Pointer to the header of the log being recorded
+ * @param[in] fanout_log2: Frames per bin growth between levels, log2 (1 to 8)
+ * @param[in] levels: Number of levels (1 to ICM20948_PYRAMID_MAX_LEVELS)
+ * @param[in] write: Function pointer to the developers output function, called with the level
+ * @param[in] ctx: Context handed back to the output function
+ *
+ * @return Returns the status of writing the headers
+ */
+icm20948_return_code_t icm20948_pyramidInit(icm20948_pyramid_t *pyr, const icm20948_log_header_t *hdr, uint8_t fanout_log2, uint8_t levels, icm20948_pyramid_write_fptr_t write, void *ctx);
+
+/*!
+ * @brief This API adds the raw sample blocks that were just logged. Blocks for channels
+ * not in the header may be NULL, and all enabled blocks must be the same length.
+ *
+ * @param[in] pyr: Pointer to the builder
+ * @param[in] accel: Pointer to the raw accel block
+ * @param[in] gyro: Pointer to the raw gyro block
+ *
+ * @return Returns the status of adding the frames
+ */
+icm20948_return_code_t icm20948_pyramidAdd(icm20948_pyramid_t *pyr, const icm20948_block_t *accel, const icm20948_block_t *gyro);
+
+/*!
+ * @brief This API writes out the partial bin of every level at the end of a recording
+ *
+ * @param[in] pyr: Pointer to the builder
+ *
+ * @return Returns the status of writing the bins
+ */
+icm20948_return_code_t icm20948_pyramidFlush(icm20948_pyramid_t *pyr);
+
+/*!
+ * @brief This API parses and validates a level header
+ *
+ * @param[in] buf: Pointer to the first bytes of the level stream
+ * @param[in] len: Number of bytes available in buf
+ * @param[out] hdr: Pointer to where the log description should be placed
+ * @param[out] level: Pointer to where the level should be placed
+ * @param[out] fanout_log2: Pointer to where the fan out should be placed
+ *
+ * @return Returns the status of parsing the header
+ */
+icm20948_return_code_t icm20948_pyramidParseHeader(const uint8_t *buf, uint32_t len, icm20948_log_header_t *hdr, uint8_t *level, uint8_t *fanout_log2);
+
+/*!
+ * @brief This API unpacks one record
+ *
+ * @param[in] hdr: Pointer to the log description from the level header
+ * @param[in] record: Pointer to the record
+ * @param[out] accel: Pointer to the accel summary, may be NULL
+ * @param[out] gyro: Pointer to the gyro summary, may be NULL
+ *
+ * @return Returns the status of unpacking the record
+ */
+icm20948_return_code_t icm20948_pyramidUnpack(const icm20948_log_header_t *hdr, const uint8_t *record, icm20948_pyramid_summary_t *accel, icm20948_pyramid_summary_t *gyro);
+
+/*!
+ * @brief This API picks the finest level that covers a span in no more than max_points
+ * records, which bounds the read needed to draw it
+ *
+ * @param[in] fanout_log2: Fan out of the pyramid, log2
+ * @param[in] levels: Number of levels in the pyramid
+ * @param[in] span: Number of frames to be shown
+ * @param[in] max_points: Most points wanted across the span
+ *
+ * @return Returns the level to read, 0 for the log itself, capped at the top level
+ */
+uint8_t icm20948_pyramidSelectLevel(uint8_t fanout_log2, uint8_t levels, uint64_t span, uint32_t max_points);
+
+#endif // _ICM20948_PYRAMID_H_
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,118 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_quatenc.h
+ * @brief Public header file for the ICM20948 compact quaternion encodings.
+ *
+ * Orientations can be stored or sent in fewer bytes than four floats. Every encoding
+ * is little endian and a fixed size per quaternion:
+ *
+ *   Encoding      Size  Worst case angle error
+ *   F32           16    none
+ *   HALF          8     ~0.05 deg, IEEE 754 binary16 per component
+ *   SMALLEST3_48  6     ~0.008 deg, 2 bit index + 3 x 15 bit
+ *   SMALLEST3_32  4     ~0.25 deg, 2 bit index + 3 x 10 bit
+ *
+ * The smallest-three encodings drop the component with the largest magnitude. The
+ * quaternion is negated first so that component is positive, which gives the same
+ * rotation, so the decoder can rebuild it from the unit norm. Each of the other three
+ * lies within +-1/sqrt(2) and is quantized uniformly over that range. Inputs are
+ * expected to be unit quaternions; decoded quaternions are unit length to within the
+ * encoding's precision.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_QUATENC_H_
+#define _ICM20948_QUATENC_H_
+
+#include <stdint.h>
+#include "icm20948_api.h"
+
+typedef enum {
+    ICM20948_QUAT_ENC_F32 = 0x00,
+    ICM20948_QUAT_ENC_HALF = 0x01,
+    ICM20948_QUAT_ENC_SMALLEST3_48 = 0x02,
+    ICM20948_QUAT_ENC_SMALLEST3_32 = 0x03
+} icm20948_quat_enc_t;
+
+/*!
+ * @brief This API retrieves the encoded size of one quaternion
+ *
+ * @param[in] enc: Encoding
+ *
+ * @return Returns the size in bytes, 0 for an unknown encoding
+ */
+uint32_t icm20948_quatEncodedSize(icm20948_quat_enc_t enc);
+
+/*!
+ * @brief This API encodes a run of quaternions
+ *
+ * @param[in] enc: Encoding to use
+ * @param[in] q: Pointer to the quaternions to encode
+ * @param[in] count: Number of quaternions
+ * @param[out] buf: Pointer to the output, room for count * icm20948_quatEncodedSize(enc) bytes
+ *
+ * @return Returns the status of encoding
+ */
+icm20948_return_code_t icm20948_quatEncode(icm20948_quat_enc_t enc, const icm20948_quat_t *q, uint32_t count, uint8_t *buf);
+
+/*!
+ * @brief This API decodes a run of quaternions
+ *
+ * @param[in] enc: Encoding the data was written with
+ * @param[in] buf: Pointer to the encoded data
+ * @param[in] count: Number of quaternions
+ * @param[out] q: Pointer to the decoded quaternions, room for count
+ *
+ * @return Returns the status of decoding
+ */
+icm20948_return_code_t icm20948_quatDecode(icm20948_quat_enc_t enc, const uint8_t *buf, uint32_t count, icm20948_quat_t *q);
+
+/*!
+ * @brief This API converts a float to IEEE 754 binary16, rounding to nearest even
+ *
+ * @param[in] f: Value to convert
+ *
+ * @return Returns the half precision bit pattern
+ */
+uint16_t icm20948_floatToHalf(float f);
+
+/*!
+ * @brief This API converts an IEEE 754 binary16 value to a float
+ *
+ * @param[in] h: Half precision bit pattern
+ *
+ * @return Returns the value as a float
+ */
+float icm20948_halfToFloat(uint16_t h);
+
+#endif // _ICM20948_QUATENC_H_
+
+#ifdef __cplusplus
+}
+#endif
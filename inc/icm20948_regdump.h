@@ -0,0 +1,97 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+
+/*! @file icm20948_regdump.h
+ * @brief Public header file for the ICM20948 register dump and diff diagnostic.
+ *
+ * icm20948_regDump() reads every documented register of the four user banks, decodes
+ * each into its named bitfields and compares the configuration registers against the
+ * values the driver last wrote to them. One line of text per register is handed to a
+ * print callback, e.g.
+ *
+ *   B0 0x03 USER_CTRL               0x40 I2C_MST_RST=0 SRAM_RST=0 ... FIFO_EN=1 DMP_EN=0
+ *   B2 0x14 ACCEL_CONFIG            0x01 ACCEL_FCHOICE=1 ACCEL_FS_SEL=0(1) ACCEL_DLPFCFG=0(5) != 0x2B
+ *
+ * where a field shown as value(expected) differs from the shadow and "!= 0x2B" gives the
+ * whole expected register. Reserved fields are not listed.
+ *
+ * The registers are read with one burst per bank, split only around the registers
+ * whose reads have side effects: I2C_MST_STATUS, INT_STATUS to INT_STATUS_3, FIFO_R_W
+ * and the DMP memory port. Those are reported as not read, so a dump never clears a
+ * pending interrupt or consumes FIFO data. A full dump is seven bursts.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_REGDUMP_H_
+#define _ICM20948_REGDUMP_H_
+
+#include <stdint.h>
+#include "icm20948_api.h"
+
+#if ICM20948_FEATURE_REGDUMP
+
+#define ICM20948_REGDUMP_LINE_MAX           (192)
+
+typedef enum {
+    ICM20948_REGDUMP_ALL = 0x00,        // Print every register
+    ICM20948_REGDUMP_DIFF               // Print only registers that differ from the shadow
+} icm20948_regdump_mode_t;
+
+/*! @brief Output for one line of the dump, without a trailing newline */
+typedef void(*icm20948_regdump_print_fptr_t)(void *ctx, const char *line);
+
+typedef struct {
+    uint16_t regs;              // Registers read
+    uint16_t unread;            // Registers skipped because reading them has side effects
+    uint16_t bursts;            // Read transactions issued
+    uint16_t checked;           // Registers compared against the shadow
+    uint16_t mismatches;        // Registers that differ from the shadow
+} icm20948_regdump_summary_t;
+
+/*!
+ * @brief This API reads all four register banks, decodes them and diffs the
+ * configuration registers against the driver's shadow
+ *
+ * @param[in] mode: Print every register or only the mismatching ones
+ * @param[in] print: Function pointer to the developers line output, or NULL
+ * @param[in] ctx: Context handed back to the output function
+ * @param[out] summary: Pointer to where the counts should be placed, or NULL
+ *
+ * @return Returns the status of reading the registers. Mismatches are reported in
+ * the summary, not as an error.
+ */
+icm20948_return_code_t icm20948_regDump(icm20948_regdump_mode_t mode, icm20948_regdump_print_fptr_t print, void *ctx, icm20948_regdump_summary_t *summary);
+
+#endif
+
+#endif // _ICM20948_REGDUMP_H_
+
+#ifdef __cplusplus
+}
+#endif
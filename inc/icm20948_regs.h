@@ -0,0 +1,138 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_regs.h
+ * @brief Register addresses and field constants of the ICM20948.
+ *
+ * Shared by the C driver and the C++ coroutine front end so the two can't drift
+ * apart. Everything is a plain #define usable from both languages. The driver's
+ * private register shadows in src/icm20948.h lay out the same fields as bitfields.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_REGS_H_
+#define _ICM20948_REGS_H_
+
+// Bank select, present in every bank. The bank lives in bits [5:4].
+#define ICM20948_ADDR_REG_BANK_SEL          (0x7F)
+#define ICM20948_REG_BANK_SEL_SHIFT         (4)
+
+// Bank 0
+#define ICM20948_ADDR_WHO_AM_I              (0x00)
+#define ICM20948_ADDR_USER_CTRL             (0x03)
+#define ICM20948_ADDR_LP_CONFIG             (0x05)
+#define ICM20948_ADDR_PWR_MGMT_1            (0x06)
+#define ICM20948_ADDR_PWR_MGMT_2            (0x07)
+#define ICM20948_ADDR_INT_ENABLE            (0x10)
+#define ICM20948_ADDR_I2C_MST_STATUS        (0x17)
+#define ICM20948_ADDR_INT_STATUS            (0x19)
+#define ICM20948_ADDR_INT_STATUS_1          (0x1A)
+#define ICM20948_ADDR_INT_STATUS_2          (0x1B)
+#define ICM20948_ADDR_INT_STATUS_3          (0x1C)
+#define ICM20948_ADDR_ACCEL_XOUT_H          (0x2D)
+#define ICM20948_ADDR_ACCEL_XOUT_L          (0x2E)
+#define ICM20948_ADDR_ACCEL_YOUT_H          (0x2F)
+#define ICM20948_ADDR_ACCEL_YOUT_L          (0x30)
+#define ICM20948_ADDR_ACCEL_ZOUT_H          (0x31)
+#define ICM20948_ADDR_ACCEL_ZOUT_L          (0x32)
+#define ICM20948_ADDR_GYRO_XOUT_H           (0x33)
+#define ICM20948_ADDR_GYRO_XOUT_L           (0x34)
+#define ICM20948_ADDR_GYRO_YOUT_H           (0x35)
+#define ICM20948_ADDR_GYRO_YOUT_L           (0x36)
+#define ICM20948_ADDR_GYRO_ZOUT_H           (0x37)
+#define ICM20948_ADDR_GYRO_ZOUT_L           (0x38)
+#define ICM20948_ADDR_FIFO_EN_1             (0x66)
+#define ICM20948_ADDR_FIFO_EN_2             (0x67)
+#define ICM20948_ADDR_FIFO_RST              (0x68)
+#define ICM20948_ADDR_FIFO_MODE             (0x69)
+#define ICM20948_ADDR_FIFO_COUNTH           (0x70)
+#define ICM20948_ADDR_FIFO_COUNTL           (0x71)
+#define ICM20948_ADDR_FIFO_R_W              (0x72)
+#define ICM20948_ADDR_MEM_R_W               (0x7D)
+
+// Bank 1
+#define ICM20948_ADDR_XA_OFFS_H             (0x14)
+#define ICM20948_ADDR_YA_OFFS_H             (0x17)
+#define ICM20948_ADDR_ZA_OFFS_H             (0x1A)
+
+// Bank 2
+#define ICM20948_ADDR_GYRO_SMPLRT_DIV       (0x00)
+#define ICM20948_ADDR_GYRO_CONFIG_1         (0x01)
+#define ICM20948_ADDR_XG_OFFS_USRH          (0x03)
+#define ICM20948_ADDR_ACCEL_SMPLRT_DIV_1    (0x10)
+#define ICM20948_ADDR_ACCEL_SMPLRT_DIV_2    (0x11)
+#define ICM20948_ADDR_ACCEL_INTEL_CTRL      (0x12)
+#define ICM20948_ADDR_ACCEL_WOM_THR         (0x13)
+#define ICM20948_ADDR_ACCEL_CONFIG          (0x14)
+#define ICM20948_ADDR_ACCEL_CONFIG_2        (0x15)
+
+// Bank 3
+#define ICM20948_ADDR_I2C_MST_CTRL          (0x01)
+#define ICM20948_ADDR_I2C_SLV4_ADDR         (0x13)
+#define ICM20948_ADDR_I2C_SLV4_REG          (0x14)
+#define ICM20948_ADDR_I2C_SLV4_CTRL         (0x15)
+#define ICM20948_ADDR_I2C_SLV4_DO           (0x16)
+#define ICM20948_ADDR_I2C_SLV4_DI           (0x17)
+
+// Register fields
+#define ICM20948_WHO_AM_I_DEFAULT           (0xEA)
+#define ICM20948_USER_CTRL_I2C_MST_EN       (0x20)
+#define ICM20948_USER_CTRL_FIFO_EN          (0x40)
+#define ICM20948_PWR_MGMT_1_CLKSEL_AUTO     (0x01)
+#define ICM20948_PWR_MGMT_2_DISABLE_GYRO    (0x07)
+#define ICM20948_PWR_MGMT_2_DISABLE_ACCEL   (0x38)
+#define ICM20948_I2C_MST_STATUS_SLV4_NACK   (0x10)
+#define ICM20948_I2C_MST_STATUS_SLV4_DONE   (0x40)
+#define ICM20948_INT_STATUS_WOM_INT         (0x08)
+#define ICM20948_FIFO_EN_2_GYRO             (0x0E)
+#define ICM20948_FIFO_EN_2_ACCEL            (0x10)
+#define ICM20948_FIFO_RST_ALL               (0x1F)
+#define ICM20948_FIFO_COUNTH_MASK           (0x1F)
+#define ICM20948_I2C_SLV_RNW                (0x80)
+#define ICM20948_I2C_SLV_EN                 (0x80)
+
+// GYRO_CONFIG_1 and ACCEL_CONFIG share a layout: FCHOICE in bit 0, full scale in
+// bits [2:1] and the DLPF config in bits [5:3]. The driver always runs the DLPF at 5.
+#define ICM20948_CONFIG_FCHOICE             (0x01)
+#define ICM20948_CONFIG_FS_SEL_SHIFT        (1)
+#define ICM20948_CONFIG_FS_SEL_MASK         (0x03)
+#define ICM20948_CONFIG_DLPFCFG             (5)
+#define ICM20948_CONFIG_DLPFCFG_SHIFT       (3)
+
+// FIFO frames, accel X/Y/Z then gyro X/Y/Z for the streamed sensors, big-endian
+#define ICM20948_FIFO_ACCEL_FRAME_SIZE      (6)
+#define ICM20948_FIFO_GYRO_FRAME_SIZE       (6)
+
+// Set in the address byte of an SPI read
+#define ICM20948_SPI_READ                   (0x80)
+
+#endif // _ICM20948_REGS_H_
+
+#ifdef __cplusplus
+}
+#endif
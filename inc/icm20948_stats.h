@@ -0,0 +1,145 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_stats.h
+ * @brief Public header file for the ICM20948 streaming statistics accumulator.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_STATS_H_
+#define _ICM20948_STATS_H_
+
+#include <stdint.h>
+#include "icm20948_api.h"
+
+#define ICM20948_STATS_AXIS_COUNT           (3)
+
+typedef struct {
+    uint64_t n;
+    double mean[ICM20948_STATS_AXIS_COUNT];
+    double m2[ICM20948_STATS_AXIS_COUNT];
+    int16_t min[ICM20948_STATS_AXIS_COUNT];
+    int16_t max[ICM20948_STATS_AXIS_COUNT];
+} icm20948_stats_t;
+
+typedef struct {
+    icm20948_stats_t *slots;
+    uint8_t slot_count;
+    uint8_t head;
+    uint32_t slot_len;
+} icm20948_stats_window_t;
+
+/*!
+ * @brief This API clears a statistics accumulator
+ *
+ * @param[in] st: Pointer to the accumulator to be cleared
+ */
+void icm20948_statsReset(icm20948_stats_t *st);
+
+/*!
+ * @brief This API adds a block of raw samples to the accumulator. The block is swept with
+ * exact integer sums and then folded into the running mean and M2 using the pairwise
+ * (Chan/Welford) update, so precision does not degrade with the number of samples.
+ *
+ * @param[in] st: Pointer to the accumulator
+ * @param[in] block: Pointer to the block of raw samples
+ *
+ * @return Returns the status of adding the block
+ */
+icm20948_return_code_t icm20948_statsAddBlock(icm20948_stats_t *st, const icm20948_block_t *block);
+
+/*!
+ * @brief This API merges a partial result into an accumulator. Partials may come from
+ * other threads or other sub-blocks; the order of merging does not matter.
+ *
+ * @param[in] dst: Pointer to the accumulator receiving the partial
+ * @param[in] src: Pointer to the partial result
+ *
+ * @return Returns the status of the merge
+ */
+icm20948_return_code_t icm20948_statsMerge(icm20948_stats_t *dst, const icm20948_stats_t *src);
+
+/*!
+ * @brief This API retrieves the mean of an axis
+ *
+ * @param[in] st: Pointer to the accumulator
+ * @param[in] axis: Axis index (0 = X, 1 = Y, 2 = Z)
+ *
+ * @return Returns the mean in LSB, or 0 if no samples were accumulated
+ */
+double icm20948_statsMean(const icm20948_stats_t *st, uint8_t axis);
+
+/*!
+ * @brief This API retrieves the population variance of an axis
+ *
+ * @param[in] st: Pointer to the accumulator
+ * @param[in] axis: Axis index (0 = X, 1 = Y, 2 = Z)
+ *
+ * @return Returns the variance in LSB^2, or 0 if no samples were accumulated
+ */
+double icm20948_statsVariance(const icm20948_stats_t *st, uint8_t axis);
+
+/*!
+ * @brief This API initializes a sliding window built from a ring of partial accumulators.
+ * The window spans between (slot_count - 1) and slot_count full slots of samples.
+ *
+ * @param[in] win: Pointer to the window to be initialized
+ * @param[in] slots: Pointer to caller owned storage for slot_count accumulators
+ * @param[in] slot_count: Number of slots in the ring
+ * @param[in] slot_len: Number of samples held by each slot
+ *
+ * @return Returns the status of initialization
+ */
+icm20948_return_code_t icm20948_statsWindowInit(icm20948_stats_window_t *win, icm20948_stats_t *slots, uint8_t slot_count, uint32_t slot_len);
+
+/*!
+ * @brief This API adds a block of raw samples to the sliding window, retiring the oldest
+ * slot each time the newest one fills up
+ *
+ * @param[in] win: Pointer to the window
+ * @param[in] block: Pointer to the block of raw samples
+ *
+ * @return Returns the status of adding the block
+ */
+icm20948_return_code_t icm20948_statsWindowAdd(icm20948_stats_window_t *win, const icm20948_block_t *block);
+
+/*!
+ * @brief This API retrieves the statistics over the whole sliding window
+ *
+ * @param[in] win: Pointer to the window
+ * @param[out] st: Pointer to the accumulator where the window result should be placed
+ *
+ * @return Returns the status of retrieving the window statistics
+ */
+icm20948_return_code_t icm20948_statsWindowGet(const icm20948_stats_window_t *win, icm20948_stats_t *st);
+
+#endif // _ICM20948_STATS_H_
+
+#ifdef __cplusplus
+}
+#endif
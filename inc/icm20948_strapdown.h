@@ -0,0 +1,110 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_strapdown.h
+ * @brief Public header file for the ICM20948 strapdown inertial integrator.
+ *
+ * Raw gyro and accel samples are integrated at the full FIFO rate into angle and
+ * velocity increments, and every decim samples an attitude, velocity and position
+ * update is produced. Coning (rotation vector) and sculling (velocity) corrections
+ * use the recursive second order algorithm of Savage, so accuracy is kept while
+ * the navigation update itself runs at the low output rate.
+ *
+ * The world frame is Z up with gravity along -Z; Earth rate and transport rate are
+ * ignored, which is appropriate for MEMS grade gyros over short horizons.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_STRAPDOWN_H_
+#define _ICM20948_STRAPDOWN_H_
+
+#include <stdint.h>
+#include "icm20948_api.h"
+
+typedef struct {
+    float sample_period;                        // Period of one raw sample, s
+    uint32_t decim;                             // Raw samples per navigation update
+    icm20948_gyro_full_scale_select_t gyro_fs;  // Full scale the raw gyro samples were taken at
+    icm20948_accel_full_scale_select_t accel_fs;// Full scale the raw accel samples were taken at
+    float gravity;                              // Local gravity, m/s^2
+    icm20948_quat_t q0;                         // Initial attitude
+} icm20948_strapdown_cfg_t;
+
+typedef struct {
+    icm20948_quat_t dq;         // Attitude increment over the update, body frame
+    float dv[3];                // Velocity increment over the update, world frame, m/s
+    float dp[3];                // Position increment over the update, world frame, m
+} icm20948_strapdown_out_t;
+
+typedef struct {
+    icm20948_strapdown_cfg_t cfg;
+    float gyro_scale;
+    float accel_scale;
+    // Navigation state
+    icm20948_quat_t q;
+    float v[3];
+    float p[3];
+    // Integrals over the current update
+    uint32_t n;
+    float alpha[3];
+    float nu[3];
+    float beta[3];
+    float scul[3];
+    float dtheta_prev[3];
+    float dv_prev[3];
+} icm20948_strapdown_t;
+
+/*!
+ * @brief This API initializes a strapdown integrator at rest at the origin
+ *
+ * @param[in] sd: Pointer to the integrator to be initialized
+ * @param[in] cfg: Pointer to the integrator configuration
+ *
+ * @return Returns the status of initialization
+ */
+icm20948_return_code_t icm20948_strapdownInit(icm20948_strapdown_t *sd, const icm20948_strapdown_cfg_t *cfg);
+
+/*!
+ * @brief This API integrates blocks of raw accel and gyro samples, as drained from the
+ * FIFO, and produces one navigation update every decim samples
+ *
+ * @param[in] sd: Pointer to the integrator
+ * @param[in] accel: Pointer to the raw accel block
+ * @param[in] gyro: Pointer to the raw gyro block, the same length as accel
+ * @param[out] out: Pointer to where the navigation updates should be placed
+ * @param[in,out] count: On entry the capacity of out, on return the number of updates
+ *
+ * @return Returns the status of integrating the blocks
+ */
+icm20948_return_code_t icm20948_strapdownProcess(icm20948_strapdown_t *sd, const icm20948_block_t *accel, const icm20948_block_t *gyro, icm20948_strapdown_out_t *out, uint32_t *count);
+
+#endif // _ICM20948_STRAPDOWN_H_
+
+#ifdef __cplusplus
+}
+#endif
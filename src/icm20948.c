@@ -27,6 +27,7 @@
  */
 
 #include <string.h>
+#include <math.h>
 #include "icm20948.h"
 #include "icm20948_api.h"
 
@@ -48,7 +49,19 @@ static icm20948_settings_t settings;
  * @return Returns the read status
  */
 static icm20948_return_code_t _spi_read(uint8_t addr, uint8_t *data, uint32_t len) {
+#if ICM20948_FEATURE_INSTRUMENTATION
+    icm20948_return_code_t ret = dev.intf.read((addr | (0x01 << 7)), data, len);
+
+    dev.stats.reads++;
+    dev.stats.bytes += 1 + len;
+    if( ret != ICM20948_RET_OK ) {
+        dev.stats.errors++;
+    }
+
+    return ret;
+#else
     return dev.intf.read((addr | (0x01 << 7)), data, len);
+#endif
 }
 
 /*!
@@ -61,8 +74,411 @@ static icm20948_return_code_t _spi_read(uint8_t addr, uint8_t *data, uint32_t le
  * @return Returns the write status
  */
 static icm20948_return_code_t _spi_write(uint8_t addr, uint8_t *data, uint32_t len) {
+#if ICM20948_FEATURE_INSTRUMENTATION
+    icm20948_return_code_t ret = dev.intf.write(addr, data, len);
+
+    dev.stats.writes++;
+    dev.stats.bytes += 1 + len;
+    if( ret != ICM20948_RET_OK ) {
+        dev.stats.errors++;
+    }
+
+    return ret;
+#else
     return dev.intf.write(addr, data, len);
+#endif
+}
+
+/*!
+ * @brief This API takes the developers lock, if one was installed, before touching the
+ * bus, the cached bank or the register shadows
+ */
+static void _lock(void) {
+#if ICM20948_FEATURE_LOCK
+    if( dev.intf.lock != NULL ) {
+        dev.intf.lock(dev.intf.lock_ctx);
+    }
+#endif
+}
+
+/*!
+ * @brief This API releases the developers lock, if one was installed
+ */
+static void _unlock(void) {
+#if ICM20948_FEATURE_LOCK
+    if( dev.intf.unlock != NULL ) {
+        dev.intf.unlock(dev.intf.lock_ctx);
+    }
+#endif
+}
+
+/*!
+ * @brief This API selects the requested user register bank, skipping the bus
+ * write if that bank is already selected
+ *
+ * @param[in] bank: User register bank to select
+ *
+ * @return Returns the bank select status
+ */
+static icm20948_return_code_t _select_bank(icm20948_reg_bank_sel_t bank) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    // The bank lives in bits [5:4] of REG_BANK_SEL
+    uint8_t sel = (uint8_t)(bank << ICM20948_REG_BANK_SEL_SHIFT);
+
+    if( dev.usr_bank.reg_bank_sel != bank ) {
+        ret = _spi_write(ICM20948_ADDR_REG_BANK_SEL, &sel, 0x01);
+
+        if( ret == ICM20948_RET_OK ) {
+            dev.usr_bank.reg_bank_sel = bank;
+#if ICM20948_FEATURE_INSTRUMENTATION
+            dev.stats.bank_switches++;
+#endif
+        }
+    }
+
+    return ret;
+}
+
+#if ICM20948_FEATURE_REGDUMP
+/*! @brief Configuration registers the driver shadows, by bank and address. FIFO_RST
+ * is left out as it is only ever pulsed. */
+static const struct {
+    uint8_t bank;
+    uint8_t addr;
+    uint8_t *reg;
+} shadow_map[] = {
+    { ICM20948_USER_BANK_0, ICM20948_ADDR_USER_CTRL, &dev.usr_bank.bank0.bytes.USER_CTRL.byte },
+    { ICM20948_USER_BANK_0, ICM20948_ADDR_LP_CONFIG, &dev.usr_bank.bank0.bytes.LP_CONFIG.byte },
+    { ICM20948_USER_BANK_0, ICM20948_ADDR_PWR_MGMT_1, &dev.usr_bank.bank0.bytes.PWR_MGMT_1.byte },
+    { ICM20948_USER_BANK_0, ICM20948_ADDR_PWR_MGMT_2, &dev.usr_bank.bank0.bytes.PWR_MGMT_2.byte },
+    { ICM20948_USER_BANK_0, ICM20948_ADDR_INT_ENABLE, &dev.usr_bank.bank0.bytes.INT_ENABLE.byte },
+    { ICM20948_USER_BANK_0, ICM20948_ADDR_FIFO_EN_2, &dev.usr_bank.bank0.bytes.FIFO_EN_2.byte },
+    { ICM20948_USER_BANK_0, ICM20948_ADDR_FIFO_MODE, &dev.usr_bank.bank0.bytes.FIFO_MODE.byte },
+    { ICM20948_USER_BANK_2, ICM20948_ADDR_GYRO_SMPLRT_DIV, &dev.usr_bank.bank2.bytes.GYRO_SMPLRT_DIV },
+    { ICM20948_USER_BANK_2, ICM20948_ADDR_GYRO_CONFIG_1, &dev.usr_bank.bank2.bytes.GYRO_CONFIG_1.byte },
+    { ICM20948_USER_BANK_2, ICM20948_ADDR_ACCEL_SMPLRT_DIV_1, &dev.usr_bank.bank2.bytes.ACCEL_SMPLRT_DIV_1.byte },
+    { ICM20948_USER_BANK_2, ICM20948_ADDR_ACCEL_SMPLRT_DIV_2, &dev.usr_bank.bank2.bytes.ACCEL_SMPLRT_DIV_2 },
+    { ICM20948_USER_BANK_2, ICM20948_ADDR_ACCEL_INTEL_CTRL, &dev.usr_bank.bank2.bytes.ACCEL_INTEL_CTRL.byte },
+    { ICM20948_USER_BANK_2, ICM20948_ADDR_ACCEL_WOM_THR, &dev.usr_bank.bank2.bytes.ACCEL_WOM_THR },
+    { ICM20948_USER_BANK_2, ICM20948_ADDR_ACCEL_CONFIG, &dev.usr_bank.bank2.bytes.ACCEL_CONFIG.byte },
+    { ICM20948_USER_BANK_2, ICM20948_ADDR_ACCEL_CONFIG_2, &dev.usr_bank.bank2.bytes.ACCEL_CONFIG_2.byte },
+};
+
+#define ICM20948_SHADOW_MAP_LEN             (sizeof(shadow_map) / sizeof(shadow_map[0]))
+
+/*!
+ * @brief This API finds a register in the shadow map
+ *
+ * @param[in] bank: User register bank
+ * @param[in] addr: Reg address
+ *
+ * @return Returns the index of the register in shadow_map, or the map size if the
+ * register is not shadowed
+ */
+static uint8_t _shadow_index(uint8_t bank, uint8_t addr) {
+    uint8_t i = 0;
+
+    while( (i < ICM20948_SHADOW_MAP_LEN) && ((shadow_map[i].bank != bank) || (shadow_map[i].addr != addr)) ) {
+        i++;
+    }
+
+    return i;
+}
+#endif
+
+#if ICM20948_FEATURE_VERIFY
+/*!
+ * @brief This API reads back the registers between two addresses of the selected bank.
+ * The burst is split around every register whose read has side effects, the same set
+ * the register dump skips, so a readback never drops a pending interrupt, pops the FIFO
+ * or moves the DMP address. Those registers are left untouched in regs.
+ *
+ * @param[in] lo: First register address
+ * @param[in] hi: Last register address
+ * @param[out] regs: Pointer to a 128 byte image of the bank, filled at lo to hi
+ *
+ * @return Returns the status of the readback
+ */
+static icm20948_return_code_t _verify_read(uint8_t lo, uint8_t hi, uint8_t *regs) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    const uint8_t bank = dev.usr_bank.reg_bank_sel;
+    uint16_t start = lo;
+
+    for( uint16_t addr = lo; (addr <= (uint16_t)hi + 1) && (ret == ICM20948_RET_OK); addr++ ) {
+        // A burst ends past hi or just before a register that must not be read
+        if( (addr > hi) || _icm20948_read_has_side_effects(bank, (uint8_t)addr) ) {
+            if( start < addr ) {
+                ret = _spi_read((uint8_t)start, &regs[start], (uint32_t)(addr - start));
+                dev.verify.stats.readbacks++;
+            }
+            start = addr + 1;
+        }
+    }
+
+    return ret;
+}
+#endif
+
+/*!
+ * @brief This API verifies the configuration registers written since the last flush,
+ * with one readback burst per bank, rewriting any that mismatch. The pending writes
+ * are always dropped, and nothing is read back if the writes themselves failed.
+ *
+ * @param[in] ret: Status of the writes being verified
+ *
+ * @return Returns ret, or the status of verifying the writes
+ */
+static icm20948_return_code_t _verify_flush(icm20948_return_code_t ret) {
+#if ICM20948_FEATURE_VERIFY
+    uint8_t bank_sel = dev.usr_bank.reg_bank_sel;
+    uint8_t regs[128];
+
+    if( (ret == ICM20948_RET_OK) && (dev.verify.count > 0) ) {
+        dev.verify.stats.flushes++;
+
+        for( uint8_t bank = ICM20948_USER_BANK_0; (bank <= ICM20948_USER_BANK_3) && (ret == ICM20948_RET_OK); bank++ ) {
+            uint8_t lo = 0x7F;
+            uint8_t hi = 0x00;
+            uint8_t mismatches = 0;
+
+            for( uint8_t i = 0; i < dev.verify.count; i++ ) {
+                if( dev.verify.pending[i].bank == bank ) {
+                    lo = (dev.verify.pending[i].addr < lo) ? dev.verify.pending[i].addr : lo;
+                    hi = (dev.verify.pending[i].addr > hi) ? dev.verify.pending[i].addr : hi;
+                }
+            }
+
+            // Banks with nothing written are skipped
+            if( lo <= hi ) {
+                ret = _select_bank((icm20948_reg_bank_sel_t)bank);
+                mismatches = 1;
+            }
+
+            for( uint8_t attempt = 0; (attempt <= ICM20948_VERIFY_RETRIES) && (mismatches > 0) && (ret == ICM20948_RET_OK); attempt++ ) {
+                ret = _verify_read(lo, hi, regs);
+                mismatches = 0;
+
+                for( uint8_t i = 0; (i < dev.verify.count) && (ret == ICM20948_RET_OK); i++ ) {
+                    icm20948_verify_entry_t *e = &dev.verify.pending[i];
+
+                    if( (e->bank == bank) && (regs[e->addr] != *e->expect) ) {
+                        mismatches++;
+                        dev.verify.stats.mismatches++;
+
+                        if( attempt < ICM20948_VERIFY_RETRIES ) {
+                            ret = _spi_write(e->addr, e->expect, 0x01);
+                            dev.verify.stats.rewrites++;
+                        }
+                    }
+                }
+            }
+
+            if( (ret == ICM20948_RET_OK) && (mismatches > 0) ) {
+                dev.verify.stats.failures++;
+                ret = ICM20948_RET_GEN_FAIL;
+            }
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            // Leave the bank as the caller had it
+            ret = _select_bank((icm20948_reg_bank_sel_t)bank_sel);
+        }
+    }
+
+    dev.verify.count = 0;
+#endif
+
+    return ret;
+}
+
+/*!
+ * @brief This API writes configuration registers of the selected bank, queueing them to
+ * be read back on the next flush when verify-after-write is enabled
+ *
+ * @param[in] addr: Reg address to write to
+ * @param[in] data: Pointer to the values to write, which must stay valid until the flush
+ * @param[in] len: Number of registers to write
+ *
+ * @return Returns the write status
+ */
+static icm20948_return_code_t _write_cfg(uint8_t addr, uint8_t *data, uint32_t len) {
+    icm20948_return_code_t ret = _spi_write(addr, data, len);
+
+#if ICM20948_FEATURE_VERIFY
+    for( uint32_t i = 0; (i < len) && dev.verify.en && (ret == ICM20948_RET_OK); i++ ) {
+        const uint8_t reg = (uint8_t)(addr + i);
+        uint8_t n = 0;
+
+        // Registers that cannot be read back without side effects are not queued
+        if( !_icm20948_read_has_side_effects(dev.usr_bank.reg_bank_sel, reg) ) {
+            // A register written twice is only checked for its last value
+            while( (n < dev.verify.count) && ((dev.verify.pending[n].bank != dev.usr_bank.reg_bank_sel) || (dev.verify.pending[n].addr != reg)) ) {
+                n++;
+            }
+
+            if( n == ICM20948_VERIFY_MAX_PENDING ) {
+                ret = _verify_flush(ret);
+                n = 0;
+            }
+
+            if( ret == ICM20948_RET_OK ) {
+                dev.verify.pending[n].bank = dev.usr_bank.reg_bank_sel;
+                dev.verify.pending[n].addr = reg;
+                dev.verify.pending[n].expect = &data[i];
+                dev.verify.count = (n == dev.verify.count) ? (uint8_t)(n + 1) : dev.verify.count;
+            }
+        }
+    }
+#endif
+
+#if ICM20948_FEATURE_REGDUMP
+    for( uint32_t i = 0; (i < len) && (ret == ICM20948_RET_OK); i++ ) {
+        // Mark the shadow as holding what the chip should read back
+        uint8_t n = _shadow_index(dev.usr_bank.reg_bank_sel, (uint8_t)(addr + i));
+        dev.written |= (uint16_t)((n < ICM20948_SHADOW_MAP_LEN) ? (0x01 << n) : 0x00);
+    }
+#endif
+
+    return ret;
+}
+
+/*! @brief Power-on reset values of the registers icm20948_applySettings writes */
+static const struct {
+    uint8_t bank;
+    uint8_t addr;
+    uint8_t value;
+} reset_values[] = {
+    { ICM20948_USER_BANK_2, ICM20948_ADDR_GYRO_SMPLRT_DIV, 0x00 },
+    { ICM20948_USER_BANK_2, ICM20948_ADDR_GYRO_CONFIG_1, 0x01 },
+    { ICM20948_USER_BANK_2, ICM20948_ADDR_ACCEL_SMPLRT_DIV_1, 0x00 },
+    { ICM20948_USER_BANK_2, ICM20948_ADDR_ACCEL_SMPLRT_DIV_2, 0x00 },
+    { ICM20948_USER_BANK_2, ICM20948_ADDR_ACCEL_CONFIG, 0x01 },
+};
+
+/*!
+ * @brief This API writes one configuration register of the selected bank, skipping the
+ * write when the chip is known to be fresh out of reset and the value is the reset value
+ *
+ * @param[in] addr: Reg address to write to
+ * @param[in] data: Pointer to the value to write, which must stay valid until the flush
+ * @param[in] from_reset: The register still holds its power-on reset value
+ *
+ * @return Returns the write status
+ */
+static icm20948_return_code_t _write_cfg_from_reset(uint8_t addr, uint8_t *data, bool from_reset) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    bool skip = false;
+
+    for( uint8_t i = 0; from_reset && (i < (sizeof(reset_values) / sizeof(reset_values[0]))); i++ ) {
+        skip = skip || ((reset_values[i].bank == dev.usr_bank.reg_bank_sel) && (reset_values[i].addr == addr) && (reset_values[i].value == *data));
+    }
+
+    if( !skip ) {
+        ret = _write_cfg(addr, data, 0x01);
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API saturates a value to the int16 range
+ *
+ * @param[in] v: Value to saturate
+ *
+ * @return Returns the saturated value
+ */
+static int16_t _sat16(int32_t v) {
+    return (int16_t)((v > INT16_MAX) ? INT16_MAX : ((v < INT16_MIN) ? INT16_MIN : v));
+}
+
+/*!
+ * @brief This API applies the mounting transform to one raw sample in place
+ *
+ * @param[in] mount: Pointer to the mounting transform
+ * @param[in,out] x: Pointer to the X sample
+ * @param[in,out] y: Pointer to the Y sample
+ * @param[in,out] z: Pointer to the Z sample
+ */
+static void _mount_apply(const icm20948_mount_t *mount, int16_t *x, int16_t *y, int16_t *z) {
+    const int32_t chip[3] = { *x, *y, *z };
+
+    if( mount->type == ICM20948_MOUNT_SIGNED_PERM ) {
+        *x = _sat16(mount->sign[0] * chip[mount->perm[0]]);
+        *y = _sat16(mount->sign[1] * chip[mount->perm[1]]);
+        *z = _sat16(mount->sign[2] * chip[mount->perm[2]]);
+    }
+    else if( mount->type == ICM20948_MOUNT_MATRIX ) {
+        *x = _sat16((int32_t)lrintf((mount->m[0][0] * chip[0]) + (mount->m[0][1] * chip[1]) + (mount->m[0][2] * chip[2])));
+        *y = _sat16((int32_t)lrintf((mount->m[1][0] * chip[0]) + (mount->m[1][1] * chip[1]) + (mount->m[1][2] * chip[2])));
+        *z = _sat16((int32_t)lrintf((mount->m[2][0] * chip[0]) + (mount->m[2][1] * chip[1]) + (mount->m[2][2] * chip[2])));
+    }
+}
+
+/*!
+ * @brief This API decodes one big-endian 3-axis sample into slot idx of a raw block
+ *
+ * @param[in] data: Pointer to the 6 bytes of the sample, X high byte first
+ * @param[out] blk: Pointer to the raw block
+ * @param[in] idx: Slot to write
+ */
+static void _decode_xyz(const uint8_t *data, icm20948_block_t *blk, uint32_t idx) {
+    blk->x[idx] = (int16_t)(((uint16_t)data[0] << 8) | data[1]);
+    blk->y[idx] = (int16_t)(((uint16_t)data[2] << 8) | data[3]);
+    blk->z[idx] = (int16_t)(((uint16_t)data[4] << 8) | data[5]);
+}
+
+#if ICM20948_FEATURE_FIFO
+/*!
+ * @brief This API computes the size of one FIFO frame
+ *
+ * @param[in] layout: Pointer to the frame layout
+ *
+ * @return Returns the frame size in bytes, 0 if neither sensor is streamed
+ */
+static uint32_t _fifo_frame_size(const icm20948_fifo_layout_t *layout) {
+    return (layout->accel ? ICM20948_FIFO_ACCEL_FRAME_SIZE : 0) + (layout->gyro ? ICM20948_FIFO_GYRO_FRAME_SIZE : 0);
+}
+
+/*!
+ * @brief This API captures the FIFO frame layout from the FIFO_EN_2 shadow. The caller
+ * must hold the lock.
+ *
+ * @param[out] layout: Pointer to where the layout should be placed
+ *
+ * @return Returns the frame size in bytes, 0 if the FIFO isn't enabled
+ */
+static uint32_t _fifo_layout(icm20948_fifo_layout_t *layout) {
+    layout->accel = dev.usr_bank.bank0.bytes.FIFO_EN_2.bits.ACCEL_FIFO_EN;
+    layout->gyro = dev.usr_bank.bank0.bytes.FIFO_EN_2.bits.GYRO_X_FIFO_EN;
+
+    return _fifo_frame_size(layout);
+}
+
+/*!
+ * @brief This API unpacks whole FIFO frames into raw sample blocks
+ *
+ * @param[in] buf: Pointer to the frames, accel first and then gyro within each frame
+ * @param[in] frames: Number of frames
+ * @param[in] layout: Pointer to the sensors the frames carry
+ * @param[out] accel: Pointer to the raw accel block, unused if the frames carry no accel
+ * @param[out] gyro: Pointer to the raw gyro block, unused if the frames carry no gyro
+ * @param[in] offset: First block slot to write
+ */
+static void _unpack_frames(const uint8_t *buf, uint32_t frames, const icm20948_fifo_layout_t *layout,
+                           icm20948_block_t *accel, icm20948_block_t *gyro, uint32_t offset) {
+    for( uint32_t i = 0; i < frames; i++ ) {
+        if( layout->accel ) {
+            _decode_xyz(buf, accel, offset + i);
+            buf += ICM20948_FIFO_ACCEL_FRAME_SIZE;
+        }
+
+        if( layout->gyro ) {
+            _decode_xyz(buf, gyro, offset + i);
+            buf += ICM20948_FIFO_GYRO_FRAME_SIZE;
+        }
+    }
 }
+#endif
 
 /*!
  * @brief This API initializes the ICM20948 comms interface, and then does a read from the device
@@ -79,29 +495,48 @@ icm20948_return_code_t icm20948_init(icm20948_read_fptr_t r, icm20948_write_fptr
         ret = ICM20948_RET_NULL_PTR;
     }
 
+    _lock();
+
     // Store the interface functions passed in to us to be used to
     // communicate with the IC.
     dev.intf.read = r;
     dev.intf.write = w;
     dev.intf.delay_us = delay;
 
-    // Select user register bank 0
-    dev.usr_bank.reg_bank_sel = ICM20948_USER_BANK_0;
+    // Force a write of the bank select by invalidating the cached bank
+    dev.usr_bank.reg_bank_sel = ICM20948_USER_BANK_3;
+
+#if ICM20948_FEATURE_VERIFY
+    memset(&dev.verify, 0x00, sizeof(dev.verify));
+#endif
+
+#if ICM20948_FEATURE_REGDUMP
+    dev.written = 0x0000;
+#endif
+
+#if ICM20948_FEATURE_INSTRUMENTATION
+    memset(&dev.stats, 0x00, sizeof(dev.stats));
+#endif
+
+    // Default both sample rate dividers to ~102Hz
+    dev.usr_bank.bank2.bytes.GYRO_SMPLRT_DIV = 0x0A;
+    dev.usr_bank.bank2.bytes.ACCEL_SMPLRT_DIV_1.bits.ACCEL_SMPLRT_DIV = 0;
+    dev.usr_bank.bank2.bytes.ACCEL_SMPLRT_DIV_2 = 0x0A;
 
     if( ret == ICM20948_RET_OK ) {
-        // Write to the reg bank select to select bank 0
-        ret = _spi_write(ICM20948_ADDR_REG_BANK_SEL, (uint8_t *)&dev.usr_bank.reg_bank_sel, 0x01);
+        // Select bank 0
+        ret = _select_bank(ICM20948_USER_BANK_0);
     }
 
     if( ret == ICM20948_RET_OK ) {
         // Ensure the local WHO_AM_I value is zeroed out before reading it from the chip
-        dev.usr_bank.bank0.bytes.WHO_AM_I = 0x00;
+        uint8_t who_am_i = 0x00;
 
         // If the bank was selected, read the WHO_AM_I register
-        ret = _spi_read(ICM20948_ADDR_WHO_AM_I, &dev.usr_bank.bank0.bytes.WHO_AM_I, 0x01);
+        ret = _spi_read(ICM20948_ADDR_WHO_AM_I, &who_am_i, 0x01);
 
         if( ret == ICM20948_RET_OK ) {
-            if( dev.usr_bank.bank0.bytes.WHO_AM_I != ICM20948_WHO_AM_I_DEFAULT ) {
+            if( who_am_i != ICM20948_WHO_AM_I_DEFAULT ) {
                 // The WHO_AM_I ID was incorrect.
                 ret = ICM20948_RET_GEN_FAIL;
             }
@@ -110,57 +545,91 @@ icm20948_return_code_t icm20948_init(icm20948_read_fptr_t r, icm20948_write_fptr
 
     if( ret == ICM20948_RET_OK ) {
         // Set the clock to best available
-        dev.usr_bank.bank0.bytes.PWR_MGMT_1.bits.CLKSEL = 1;
+        dev.usr_bank.bank0.bytes.PWR_MGMT_1.bits.CLKSEL = ICM20948_PWR_MGMT_1_CLKSEL_AUTO;
         dev.usr_bank.bank0.bytes.PWR_MGMT_1.bits.SLEEP = 0;
         dev.usr_bank.bank0.bytes.PWR_MGMT_1.bits.DEVICE_RESET = 0;
-        ret = _spi_write(ICM20948_ADDR_PWR_MGMT_1, & dev.usr_bank.bank0.bytes.PWR_MGMT_1.byte, 0x01);
+        ret = _write_cfg(ICM20948_ADDR_PWR_MGMT_1, & dev.usr_bank.bank0.bytes.PWR_MGMT_1.byte, 0x01);
     }
 
+    _unlock();
+
     // Return our init status
     return ret;
 }
 
+#if ICM20948_FEATURE_LOCK
+/*!
+ * @brief This API installs the developers lock hooks
+ */
+icm20948_return_code_t icm20948_setLockHooks(icm20948_lock_fptr_t lock, icm20948_lock_fptr_t unlock, void *ctx) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    // Either both hooks or neither
+    if( (lock == NULL) != (unlock == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        dev.intf.lock = lock;
+        dev.intf.unlock = unlock;
+        dev.intf.lock_ctx = ctx;
+    }
+
+    return ret;
+}
+#endif
+
 /*!
  * @brief This API applys the developers settings for configuring the ICM20948 components
+ *
+ * @param[in] newSettings: Pointer to the new ICM20948 settings to be applied
+ * @param[in] from_reset: The chip is fresh out of reset, so registers whose new value is
+ * the reset value need not be written
+ *
+ * @return Returns the status of applying settings
  */
-icm20948_return_code_t icm20948_applySettings(icm20948_settings_t *newSettings) {
+static icm20948_return_code_t _apply_settings(icm20948_settings_t *newSettings, bool from_reset) {
     icm20948_return_code_t ret = ICM20948_RET_OK;
 
-    // Copy over the new settings
-    memcpy(&settings, newSettings, sizeof(settings));
+    if( newSettings == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( _icm20948_mount_valid(&newSettings->mount) == false ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    _lock();
+
+    if( ret == ICM20948_RET_OK ) {
+        // Copy over the new settings
+        memcpy(&settings, newSettings, sizeof(settings));
+    }
 
     // Apply the new settings
     if( settings.gyro.en == ICM20948_MOD_ENABLED ) {
         // Select Bank 2 if it isn't already
-        if( (dev.usr_bank.reg_bank_sel != ICM20948_USER_BANK_2) && (ret == ICM20948_RET_OK) ) {
-            // Select Bank 0
-            dev.usr_bank.reg_bank_sel = ICM20948_USER_BANK_2;
-            // Write to the reg bank select to select bank 2
-            ret = _spi_write(ICM20948_ADDR_REG_BANK_SEL,  (uint8_t *)&dev.usr_bank.reg_bank_sel, 0x01);
+        if( ret == ICM20948_RET_OK ) {
+            ret = _select_bank(ICM20948_USER_BANK_2);
         }
 
         if( ret == ICM20948_RET_OK ) {
             // Set the Gyro Rate
             dev.usr_bank.bank2.bytes.GYRO_CONFIG_1.bits.GYRO_FS_SEL = settings.gyro.fs;
-            dev.usr_bank.bank2.bytes.GYRO_CONFIG_1.bits.GYRO_FCHOICE = 1;
-            dev.usr_bank.bank2.bytes.GYRO_CONFIG_1.bits.GYRO_DLPFCFG = 5;
-            ret = _spi_write(ICM20948_ADDR_GYRO_CONFIG_1, &dev.usr_bank.bank2.bytes.GYRO_CONFIG_1.byte, 0x01);
+            dev.usr_bank.bank2.bytes.GYRO_CONFIG_1.bits.GYRO_FCHOICE = ICM20948_CONFIG_FCHOICE;
+            dev.usr_bank.bank2.bytes.GYRO_CONFIG_1.bits.GYRO_DLPFCFG = ICM20948_CONFIG_DLPFCFG;
+            ret = _write_cfg_from_reset(ICM20948_ADDR_GYRO_CONFIG_1, &dev.usr_bank.bank2.bytes.GYRO_CONFIG_1.byte, from_reset);
         }
 
         if( ret == ICM20948_RET_OK ) {
             // Set the sample rate
-            dev.usr_bank.bank2.bytes.GYRO_SMPLRT_DIV = 0x0A;
-            ret = _spi_write(ICM20948_ADDR_GYRO_SMPLRT_DIV, &dev.usr_bank.bank2.bytes.GYRO_SMPLRT_DIV, 0x01);
+            ret = _write_cfg_from_reset(ICM20948_ADDR_GYRO_SMPLRT_DIV, &dev.usr_bank.bank2.bytes.GYRO_SMPLRT_DIV, from_reset);
         }
     }
     else {
         // Disable the Gyro
         // Select Bank 0 if it isn't already
-        if( (dev.usr_bank.reg_bank_sel != ICM20948_USER_BANK_0) && (ret == ICM20948_RET_OK) ) {
-            // Select Bank 0
-            dev.usr_bank.reg_bank_sel = ICM20948_USER_BANK_0;
-            // Write to the reg bank select to select bank 0
-            ret = _spi_write(ICM20948_ADDR_REG_BANK_SEL,  (uint8_t *)&dev.usr_bank.reg_bank_sel, 0x01);
+        if( ret == ICM20948_RET_OK ) {
+            ret = _select_bank(ICM20948_USER_BANK_0);
         }
 
         if( ret == ICM20948_RET_OK ) {
@@ -172,47 +641,39 @@ icm20948_return_code_t icm20948_applySettings(icm20948_settings_t *newSettings)
             // Now disable the gyro in the config
             dev.usr_bank.bank0.bytes.PWR_MGMT_2.bits.DISABLE_GYRO = 0b111;
             // Write the config back to the device
-            ret = _spi_write(ICM20948_ADDR_PWR_MGMT_2, &dev.usr_bank.bank0.bytes.PWR_MGMT_2.byte, 0x01);
+            ret = _write_cfg(ICM20948_ADDR_PWR_MGMT_2, &dev.usr_bank.bank0.bytes.PWR_MGMT_2.byte, 0x01);
         }
     }
 
     if( settings.accel.en == ICM20948_MOD_ENABLED ) {
         // Select Bank 2 if it isn't already
-        if( (dev.usr_bank.reg_bank_sel != ICM20948_USER_BANK_2) && (ret == ICM20948_RET_OK) ) {
-            // Select Bank 0
-            dev.usr_bank.reg_bank_sel = ICM20948_USER_BANK_2;
-            // Write to the reg bank select to select bank 2
-            ret = _spi_write(ICM20948_ADDR_REG_BANK_SEL,  (uint8_t *)&dev.usr_bank.reg_bank_sel, 0x01);
+        if( ret == ICM20948_RET_OK ) {
+            ret = _select_bank(ICM20948_USER_BANK_2);
         }
 
         if( ret == ICM20948_RET_OK ) {
             // Setup the Accel Config
             dev.usr_bank.bank2.bytes.ACCEL_CONFIG.bits.ACCEL_FS_SEL = settings.accel.fs;
-            dev.usr_bank.bank2.bytes.ACCEL_CONFIG.bits.ACCEL_FCHOICE = 1;
-            dev.usr_bank.bank2.bytes.ACCEL_CONFIG.bits.ACCEL_DLPFCFG = 5;
-            ret = _spi_write(ICM20948_ADDR_ACCEL_CONFIG, &dev.usr_bank.bank2.bytes.ACCEL_CONFIG.byte, 0x01);
+            dev.usr_bank.bank2.bytes.ACCEL_CONFIG.bits.ACCEL_FCHOICE = ICM20948_CONFIG_FCHOICE;
+            dev.usr_bank.bank2.bytes.ACCEL_CONFIG.bits.ACCEL_DLPFCFG = ICM20948_CONFIG_DLPFCFG;
+            ret = _write_cfg_from_reset(ICM20948_ADDR_ACCEL_CONFIG, &dev.usr_bank.bank2.bytes.ACCEL_CONFIG.byte, from_reset);
         }
 
         if( ret == ICM20948_RET_OK ) {
             // Set the sample rate
-            dev.usr_bank.bank2.bytes.ACCEL_SMPLRT_DIV_1.bits.ACCEL_SMPLRT_DIV = 0;
-            ret = _spi_write(ICM20948_ADDR_ACCEL_SMPLRT_DIV_1, &dev.usr_bank.bank2.bytes.ACCEL_SMPLRT_DIV_1.byte, 0x01);
+            ret = _write_cfg_from_reset(ICM20948_ADDR_ACCEL_SMPLRT_DIV_1, &dev.usr_bank.bank2.bytes.ACCEL_SMPLRT_DIV_1.byte, from_reset);
         }
 
         if( ret == ICM20948_RET_OK ) {
             // Set the sample rate
-            dev.usr_bank.bank2.bytes.ACCEL_SMPLRT_DIV_2 = 0x0A;
-            ret = _spi_write(ICM20948_ADDR_ACCEL_SMPLRT_DIV_2, &dev.usr_bank.bank2.bytes.ACCEL_SMPLRT_DIV_2, 0x01);
+            ret = _write_cfg_from_reset(ICM20948_ADDR_ACCEL_SMPLRT_DIV_2, &dev.usr_bank.bank2.bytes.ACCEL_SMPLRT_DIV_2, from_reset);
         }
     }
     else {
         // Disable the Accelerometer
         // Select Bank 0 if it isn't already
-        if( (dev.usr_bank.reg_bank_sel != ICM20948_USER_BANK_0) && (ret == ICM20948_RET_OK) ) {
-            // Select Bank 0
-            dev.usr_bank.reg_bank_sel = ICM20948_USER_BANK_0;
-            // Write to the reg bank select to select bank 0
-            ret = _spi_write(ICM20948_ADDR_REG_BANK_SEL,  (uint8_t *)&dev.usr_bank.reg_bank_sel, 0x01);
+        if( ret == ICM20948_RET_OK ) {
+            ret = _select_bank(ICM20948_USER_BANK_0);
         }
 
         if( ret == ICM20948_RET_OK ) {
@@ -224,46 +685,75 @@ icm20948_return_code_t icm20948_applySettings(icm20948_settings_t *newSettings)
             // Now disable the accel in the config
             dev.usr_bank.bank0.bytes.PWR_MGMT_2.bits.DISABLE_ACCEL = 0b111;
             // Write the config back to the device
-            ret = _spi_write(ICM20948_ADDR_PWR_MGMT_2, &dev.usr_bank.bank0.bytes.PWR_MGMT_2.byte, 0x01);
+            ret = _write_cfg(ICM20948_ADDR_PWR_MGMT_2, &dev.usr_bank.bank0.bytes.PWR_MGMT_2.byte, 0x01);
         }
     }
 
+    ret = _verify_flush(ret);
+
+    _unlock();
 
     return ret;
 }
 
+/*!
+ * @brief This API applys the developers settings for configuring the ICM20948 components
+ */
+icm20948_return_code_t icm20948_applySettings(icm20948_settings_t *newSettings) {
+    return _apply_settings(newSettings, false);
+}
+
+/*!
+ * @brief This API applys settings to a chip fresh out of reset, skipping reset values
+ */
+icm20948_return_code_t icm20948_applySettingsFromReset(icm20948_settings_t *newSettings) {
+    return _apply_settings(newSettings, true);
+}
+
 /*!
  * @brief This API retrieves the current gyro data from the device
  */
 icm20948_return_code_t icm20948_getGyroData(icm20948_gyro_t *gyro) {
     icm20948_return_code_t ret = ICM20948_RET_OK;
+    icm20948_gyro_settings_t cfg;
+    icm20948_mount_t mount;
+    uint8_t data[6];
+
+    _lock();
+
+    // Take the settings the sample is decoded with under the same lock as the read
+    cfg = settings.gyro;
+    mount = settings.mount;
 
     // Check if the Gyro is enabled
-    if( settings.gyro.en != ICM20948_MOD_ENABLED ) {
+    if( cfg.en != ICM20948_MOD_ENABLED ) {
         ret = ICM20948_RET_INV_CONFIG;
     }
 
-    if( (dev.usr_bank.reg_bank_sel != ICM20948_USER_BANK_0) && (ret == ICM20948_RET_OK) ) {
-        // Select Bank 0
-        dev.usr_bank.reg_bank_sel = ICM20948_USER_BANK_0;
-        // Write to the reg bank select to select bank 0
-        ret = _spi_write(ICM20948_ADDR_REG_BANK_SEL, (uint8_t *)&dev.usr_bank.reg_bank_sel, 0x01);
+    if( ret == ICM20948_RET_OK ) {
+        // Select Bank 0 if it isn't already
+        ret = _select_bank(ICM20948_USER_BANK_0);
     }
 
     if( ret == ICM20948_RET_OK ) {
         // Read out the 6 bytes of gyro data
-        ret = _spi_read(ICM20948_ADDR_GYRO_XOUT_H, &dev.usr_bank.bank0.bytes.GYRO_XOUT_H, 0x06);
+        ret = _spi_read(ICM20948_ADDR_GYRO_XOUT_H, data, 0x06);
     }
 
+    _unlock();
+
     if( ret == ICM20948_RET_OK ) {
         // Arrang the gyro data nicely in the provided struct
-        gyro->x = ((int16_t)dev.usr_bank.bank0.bytes.GYRO_XOUT_H << 8) | dev.usr_bank.bank0.bytes.GYRO_XOUT_L;
-        gyro->y = ((int16_t)dev.usr_bank.bank0.bytes.GYRO_YOUT_H << 8) | dev.usr_bank.bank0.bytes.GYRO_YOUT_L;
-        gyro->z = ((int16_t)dev.usr_bank.bank0.bytes.GYRO_ZOUT_H << 8) | dev.usr_bank.bank0.bytes.GYRO_ZOUT_L;
+        gyro->x = ((int16_t)data[0] << 8) | data[1];
+        gyro->y = ((int16_t)data[2] << 8) | data[3];
+        gyro->z = ((int16_t)data[4] << 8) | data[5];
+
+        // Move into the board frame before scaling
+        _mount_apply(&mount, &gyro->x, &gyro->y, &gyro->z);
 
         // Determine the scaling factor based on the Full scale select config
         // and then scale the values
-        switch( settings.gyro.fs ) {
+        switch( cfg.fs ) {
             case ICM20948_GYRO_FS_SEL_250DPS:
                 gyro->x /= 131;
                 gyro->y /= 131;
@@ -320,33 +810,45 @@ icm20948_return_code_t icm20948_getGyroData(icm20948_gyro_t *gyro) {
  */
 icm20948_return_code_t icm20948_getAccelData(icm20948_accel_t *accel) {
     icm20948_return_code_t ret = ICM20948_RET_OK;
+    icm20948_accel_settings_t cfg;
+    icm20948_mount_t mount;
+    uint8_t data[6];
+
+    _lock();
+
+    // Take the settings the sample is decoded with under the same lock as the read
+    cfg = settings.accel;
+    mount = settings.mount;
 
     // Check if the Accelerometer is enabled
-    if( settings.accel.en != ICM20948_MOD_ENABLED ) {
+    if( cfg.en != ICM20948_MOD_ENABLED ) {
         ret = ICM20948_RET_INV_CONFIG;
     }
 
-    if( (dev.usr_bank.reg_bank_sel != ICM20948_USER_BANK_0) && (ret == ICM20948_RET_OK) ) {
-        // Select Bank 0
-        dev.usr_bank.reg_bank_sel = ICM20948_USER_BANK_0;
-        // Write to the reg bank select to select bank 0
-        ret = _spi_write(ICM20948_ADDR_REG_BANK_SEL,  (uint8_t *)&dev.usr_bank.reg_bank_sel, 0x01);
+    if( ret == ICM20948_RET_OK ) {
+        // Select Bank 0 if it isn't already
+        ret = _select_bank(ICM20948_USER_BANK_0);
     }
 
     if( ret == ICM20948_RET_OK ) {
-        // Read out the 6 bytes of gyro data
-        ret = _spi_read(ICM20948_ADDR_ACCEL_XOUT_H, &dev.usr_bank.bank0.bytes.ACCEL_XOUT_H, 0x06);
+        // Read out the 6 bytes of accel data
+        ret = _spi_read(ICM20948_ADDR_ACCEL_XOUT_H, data, 0x06);
     }
 
+    _unlock();
+
     if( ret == ICM20948_RET_OK ) {
-        // Arrang the gyro data nicely in the provided struct
-        accel->x = ((int16_t)dev.usr_bank.bank0.bytes.ACCEL_XOUT_H << 8) | dev.usr_bank.bank0.bytes.ACCEL_XOUT_L;
-        accel->y = ((int16_t)dev.usr_bank.bank0.bytes.ACCEL_YOUT_H << 8) | dev.usr_bank.bank0.bytes.ACCEL_YOUT_L;
-        accel->z = ((int16_t)dev.usr_bank.bank0.bytes.ACCEL_ZOUT_H << 8) | dev.usr_bank.bank0.bytes.ACCEL_ZOUT_L;
+        // Arrang the accel data nicely in the provided struct
+        accel->x = ((int16_t)data[0] << 8) | data[1];
+        accel->y = ((int16_t)data[2] << 8) | data[3];
+        accel->z = ((int16_t)data[4] << 8) | data[5];
+
+        // Move into the board frame before scaling
+        _mount_apply(&mount, &accel->x, &accel->y, &accel->z);
 
         // Determine the scaling factor based on the Full scale select config
         // and then scale the values
-        switch( settings.accel.fs ) {
+        switch( cfg.fs ) {
             case ICM20948_ACCEL_FS_SEL_2G:
                 accel->x /= 16;
                 accel->y /= 16;
@@ -396,4 +898,854 @@ icm20948_return_code_t icm20948_getAccelData(icm20948_accel_t *accel) {
     }
 
     return ret;
-}
\ No newline at end of file
+}
+
+/*!
+ * @brief This API reads the accel and gyro output registers straight into the caller's buffer
+ */
+icm20948_return_code_t icm20948_readBurst(uint8_t *buf) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( buf == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        _lock();
+
+        // Only the bank select cache is touched, the data never passes through the shadow
+        ret = _select_bank(ICM20948_USER_BANK_0);
+
+        if( ret == ICM20948_RET_OK ) {
+            ret = _spi_read(ICM20948_ADDR_ACCEL_XOUT_H, buf, ICM20948_BURST_SIZE);
+        }
+
+        _unlock();
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API decodes a burst buffer into one slot of raw sample blocks
+ */
+icm20948_return_code_t icm20948_decodeBurst(const uint8_t *buf, icm20948_block_t *accel, icm20948_block_t *gyro, uint32_t idx) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( buf == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( ((accel != NULL) && (idx >= accel->len)) || ((gyro != NULL) && (idx >= gyro->len)) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        // The accel output registers come first, then gyro
+        if( accel != NULL ) {
+            _decode_xyz(&buf[0], accel, idx);
+        }
+        if( gyro != NULL ) {
+            _decode_xyz(&buf[6], gyro, idx);
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API reads one accel and gyro sample in a single burst and converts it into
+ * the caller's buffers
+ */
+icm20948_return_code_t icm20948_readScaled(float *accel, float *gyro) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint8_t buf[ICM20948_BURST_SIZE];
+    int16_t raw[2][3];
+    icm20948_block_t raw_accel = { &raw[0][0], &raw[0][1], &raw[0][2], 1 };
+    icm20948_block_t raw_gyro = { &raw[1][0], &raw[1][1], &raw[1][2], 1 };
+
+    if( (accel == NULL) && (gyro == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        ret = icm20948_readBurst(buf);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        ret = icm20948_decodeBurst(buf, &raw_accel, &raw_gyro, 0);
+    }
+
+    if( (ret == ICM20948_RET_OK) && (accel != NULL) ) {
+        icm20948_fblock_t out = { &accel[0], &accel[1], &accel[2], 1 };
+        ret = icm20948_convertBlock(ICM20948_SENSOR_ACCEL, &raw_accel, &out);
+    }
+
+    if( (ret == ICM20948_RET_OK) && (gyro != NULL) ) {
+        icm20948_fblock_t out = { &gyro[0], &gyro[1], &gyro[2], 1 };
+        ret = icm20948_convertBlock(ICM20948_SENSOR_GYRO, &raw_gyro, &out);
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API sets the gyro and accel sample rate dividers used by icm20948_applySettings
+ */
+icm20948_return_code_t icm20948_setSampleRateDiv(uint8_t gyroDiv, uint16_t accelDiv) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    // The accel divider is only 12 bits wide
+    if( accelDiv > 0x0FFF ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        _lock();
+        dev.usr_bank.bank2.bytes.GYRO_SMPLRT_DIV = gyroDiv;
+        dev.usr_bank.bank2.bytes.ACCEL_SMPLRT_DIV_1.bits.ACCEL_SMPLRT_DIV = (uint8_t)(accelDiv >> 8);
+        dev.usr_bank.bank2.bytes.ACCEL_SMPLRT_DIV_2 = (uint8_t)(accelDiv & 0xFF);
+        _unlock();
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API writes the gyro user offset registers
+ */
+icm20948_return_code_t icm20948_setGyroOffsets(const int16_t *offs) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint8_t data[6];
+
+    if( offs == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else {
+        for( uint8_t i = 0; i < 3; i++ ) {
+            data[(i * 2)] = (uint8_t)((uint16_t)offs[i] >> 8);
+            data[(i * 2) + 1] = (uint8_t)((uint16_t)offs[i] & 0xFF);
+        }
+    }
+
+    _lock();
+
+    if( ret == ICM20948_RET_OK ) {
+        ret = _select_bank(ICM20948_USER_BANK_2);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        // X/Y/Z H/L are contiguous, so one burst covers all three axes
+        ret = _write_cfg(ICM20948_ADDR_XG_OFFS_USRH, data, sizeof(data));
+    }
+
+    ret = _verify_flush(ret);
+
+    _unlock();
+
+    return ret;
+}
+
+/*!
+ * @brief This API writes the accel offset registers
+ */
+icm20948_return_code_t icm20948_setAccelOffsets(const int16_t *offs) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    const uint8_t addr[3] = { ICM20948_ADDR_XA_OFFS_H, ICM20948_ADDR_YA_OFFS_H, ICM20948_ADDR_ZA_OFFS_H };
+    uint8_t data[8];
+
+    if( offs == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else {
+        for( uint8_t i = 0; i < 3; i++ ) {
+            if( (offs[i] < -16384) || (offs[i] > 16383) ) {
+                ret = ICM20948_RET_INV_PARAM;
+            }
+        }
+    }
+
+    _lock();
+
+    if( ret == ICM20948_RET_OK ) {
+        ret = _select_bank(ICM20948_USER_BANK_1);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        // Read XA_OFFS_H through ZA_OFFS_L so the reserved bit 0 of each low byte is kept
+        ret = _spi_read(ICM20948_ADDR_XA_OFFS_H, data, sizeof(data));
+    }
+
+    for( uint8_t i = 0; (i < 3) && (ret == ICM20948_RET_OK); i++ ) {
+        uint8_t *reg = &data[addr[i] - ICM20948_ADDR_XA_OFFS_H];
+        const uint8_t h = (uint8_t)(((uint16_t)offs[i] >> 7) & 0xFF);
+        const uint8_t l = (uint8_t)((((uint16_t)offs[i] << 1) & 0xFE) | (reg[1] & 0x01));
+
+        // Axes already holding the offset, e.g. the factory trim itself, are left alone
+        if( (reg[0] != h) || (reg[1] != l) ) {
+            reg[0] = h;
+            reg[1] = l;
+            ret = _write_cfg(addr[i], reg, 0x02);
+        }
+    }
+
+    ret = _verify_flush(ret);
+
+    _unlock();
+
+    return ret;
+}
+
+#if ICM20948_FEATURE_FIFO
+/*!
+ * @brief This API configures which sensors are streamed into the FIFO, resets it, and enables it
+ */
+icm20948_return_code_t icm20948_enableFifo(icm20948_mod_enable_t accel, icm20948_mod_enable_t gyro) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint8_t fifo_rst = ICM20948_FIFO_RST_ALL;
+
+    _lock();
+
+    // Any drain in progress must not join what is left with what comes after the reset
+    dev.fifo_resets++;
+
+    ret = _select_bank(ICM20948_USER_BANK_0);
+
+    if( ret == ICM20948_RET_OK ) {
+        // Stop the FIFO while it is being reconfigured
+        dev.usr_bank.bank0.bytes.USER_CTRL.bits.FIFO_EN = 0;
+        ret = _write_cfg(ICM20948_ADDR_USER_CTRL, &dev.usr_bank.bank0.bytes.USER_CTRL.byte, 0x01);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        // Select the sensors written into the FIFO
+        dev.usr_bank.bank0.bytes.FIFO_EN_2.byte = 0x00;
+        dev.usr_bank.bank0.bytes.FIFO_EN_2.bits.ACCEL_FIFO_EN = (accel == ICM20948_MOD_ENABLED);
+        dev.usr_bank.bank0.bytes.FIFO_EN_2.bits.GYRO_X_FIFO_EN = (gyro == ICM20948_MOD_ENABLED);
+        dev.usr_bank.bank0.bytes.FIFO_EN_2.bits.GYRO_Y_FIFO_EN = (gyro == ICM20948_MOD_ENABLED);
+        dev.usr_bank.bank0.bytes.FIFO_EN_2.bits.GYRO_Z_FIFO_EN = (gyro == ICM20948_MOD_ENABLED);
+        ret = _write_cfg(ICM20948_ADDR_FIFO_EN_2, &dev.usr_bank.bank0.bytes.FIFO_EN_2.byte, 0x01);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        // Stream mode, the oldest data is replaced when the FIFO fills
+        dev.usr_bank.bank0.bytes.FIFO_MODE.byte = 0x00;
+        ret = _write_cfg(ICM20948_ADDR_FIFO_MODE, &dev.usr_bank.bank0.bytes.FIFO_MODE.byte, 0x01);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        // Assert and then release the FIFO reset
+        ret = _spi_write(ICM20948_ADDR_FIFO_RST, &fifo_rst, 0x01);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        dev.usr_bank.bank0.bytes.FIFO_RST.byte = 0x00;
+        ret = _spi_write(ICM20948_ADDR_FIFO_RST, &dev.usr_bank.bank0.bytes.FIFO_RST.byte, 0x01);
+    }
+
+    if( (ret == ICM20948_RET_OK) && (dev.usr_bank.bank0.bytes.FIFO_EN_2.byte != 0x00) ) {
+        // Start the FIFO
+        dev.usr_bank.bank0.bytes.USER_CTRL.bits.FIFO_EN = 1;
+        ret = _write_cfg(ICM20948_ADDR_USER_CTRL, &dev.usr_bank.bank0.bytes.USER_CTRL.byte, 0x01);
+    }
+
+    ret = _verify_flush(ret);
+
+    _unlock();
+
+    return ret;
+}
+
+/*!
+ * @brief This API drains whole frames from the FIFO into the provided raw sample blocks
+ */
+icm20948_return_code_t icm20948_readFifo(icm20948_block_t *accel, icm20948_block_t *gyro) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    icm20948_fifo_layout_t layout;
+    uint32_t resets = 0;
+    uint32_t frame_size = 0;
+    uint8_t buf[ICM20948_FIFO_CHUNK_FRAMES * (ICM20948_FIFO_ACCEL_FRAME_SIZE + ICM20948_FIFO_GYRO_FRAME_SIZE)];
+    uint8_t fifo_count[2];
+    uint32_t frames = UINT32_MAX;
+    uint32_t done = 0;
+
+    _lock();
+
+    frame_size = _fifo_layout(&layout);
+    resets = dev.fifo_resets;
+
+    if( frame_size == 0 ) {
+        // The FIFO hasn't been enabled
+        ret = ICM20948_RET_INV_CONFIG;
+    }
+    else if( (layout.accel && (accel == NULL)) || (layout.gyro && (gyro == NULL)) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        // The block lengths coming in are their capacities
+        if( layout.accel ) {
+            frames = accel->len;
+        }
+        if( layout.gyro && (gyro->len < frames) ) {
+            frames = gyro->len;
+        }
+
+        ret = _select_bank(ICM20948_USER_BANK_0);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        // Read out both bytes of the FIFO count
+        ret = _spi_read(ICM20948_ADDR_FIFO_COUNTH, fifo_count, 0x02);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        uint32_t count = ((uint32_t)(fifo_count[0] & ICM20948_FIFO_COUNTH_MASK) << 8) | fifo_count[1];
+
+        // Only pull whole frames so the FIFO stays aligned for the next drain
+        if( (count / frame_size) < frames ) {
+            frames = count / frame_size;
+        }
+    }
+
+    _unlock();
+
+    while( (ret == ICM20948_RET_OK) && (done < frames) ) {
+        uint32_t chunk = frames - done;
+        if( chunk > ICM20948_FIFO_CHUNK_FRAMES ) {
+            chunk = ICM20948_FIFO_CHUNK_FRAMES;
+        }
+
+        // Other callers may get the bus between chunks, so reselect the bank each
+        // time, which costs nothing unless someone else moved it
+        _lock();
+        if( dev.fifo_resets != resets ) {
+            // The FIFO was reset between chunks, even with the same layout what is left
+            // in it belongs to the next drain
+            frames = done;
+            chunk = 0;
+        }
+        else {
+            ret = _select_bank(ICM20948_USER_BANK_0);
+        }
+        if( (ret == ICM20948_RET_OK) && (chunk > 0) ) {
+            ret = _spi_read(ICM20948_ADDR_FIFO_R_W, buf, chunk * frame_size);
+        }
+        _unlock();
+
+        if( ret == ICM20948_RET_OK ) {
+            // Frames are written in register order, accel first and then gyro
+            _unpack_frames(buf, chunk, &layout, accel, gyro, done);
+            done += chunk;
+        }
+    }
+
+    // Report back how many samples were placed in each block
+    if( layout.accel && (accel != NULL) ) {
+        accel->len = done;
+    }
+    if( layout.gyro && (gyro != NULL) ) {
+        gyro->len = done;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API drains whole FIFO frames straight into the caller's buffer in one transfer
+ */
+icm20948_return_code_t icm20948_readFifoBytes(uint8_t *buf, uint32_t *len, icm20948_fifo_layout_t *layout) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint32_t frame_size = 0;
+    uint8_t fifo_count[2];
+    uint32_t bytes = 0;
+
+    if( (buf == NULL) || (len == NULL) || (layout == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    _lock();
+
+    if( ret == ICM20948_RET_OK ) {
+        // Captured with the read so the layout always describes the bytes returned
+        frame_size = _fifo_layout(layout);
+
+        if( frame_size == 0 ) {
+            // The FIFO hasn't been enabled
+            ret = ICM20948_RET_INV_CONFIG;
+        }
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        ret = _select_bank(ICM20948_USER_BANK_0);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        ret = _spi_read(ICM20948_ADDR_FIFO_COUNTH, fifo_count, 0x02);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        bytes = ((uint32_t)(fifo_count[0] & ICM20948_FIFO_COUNTH_MASK) << 8) | fifo_count[1];
+        if( *len < bytes ) {
+            bytes = *len;
+        }
+
+        // Only pull whole frames so the FIFO stays aligned for the next drain
+        bytes -= bytes % frame_size;
+
+        if( bytes > 0 ) {
+            ret = _spi_read(ICM20948_ADDR_FIFO_R_W, buf, bytes);
+        }
+    }
+
+    _unlock();
+
+    if( len != NULL ) {
+        *len = (ret == ICM20948_RET_OK) ? bytes : 0;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API unpacks FIFO bytes into raw sample blocks
+ */
+icm20948_return_code_t icm20948_parseFifo(const uint8_t *buf, uint32_t len, const icm20948_fifo_layout_t *layout,
+                                          icm20948_block_t *accel, icm20948_block_t *gyro) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    const uint32_t frame_size = (layout != NULL) ? _fifo_frame_size(layout) : 0;
+    uint32_t frames = 0;
+
+    if( layout == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( frame_size == 0 ) {
+        ret = ICM20948_RET_INV_CONFIG;
+    }
+    else if( ((buf == NULL) && (len != 0)) || (layout->accel && (accel == NULL)) || (layout->gyro && (gyro == NULL)) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (len % frame_size) != 0 ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+    else {
+        frames = len / frame_size;
+        if( (layout->accel && (accel->len < frames)) || (layout->gyro && (gyro->len < frames)) ) {
+            ret = ICM20948_RET_INV_PARAM;
+        }
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        _unpack_frames(buf, frames, layout, accel, gyro, 0);
+
+        if( layout->accel ) {
+            accel->len = frames;
+        }
+        if( layout->gyro ) {
+            gyro->len = frames;
+        }
+    }
+
+    return ret;
+}
+
+#endif
+
+#if ICM20948_FEATURE_WOM
+/*!
+ * @brief This API arms or disarms the wake-on-motion interrupt
+ */
+icm20948_return_code_t icm20948_enableWakeOnMotion(icm20948_mod_enable_t en, uint8_t threshold) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    const uint8_t armed = (en == ICM20948_MOD_ENABLED) ? 1 : 0;
+
+    _lock();
+
+    ret = _select_bank(ICM20948_USER_BANK_2);
+
+    if( ret == ICM20948_RET_OK ) {
+        dev.usr_bank.bank2.bytes.ACCEL_WOM_THR = threshold;
+        ret = _write_cfg(ICM20948_ADDR_ACCEL_WOM_THR, &dev.usr_bank.bank2.bytes.ACCEL_WOM_THR, 0x01);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        // Compare each sample against the previous one rather than the first
+        dev.usr_bank.bank2.bytes.ACCEL_INTEL_CTRL.bits.ACCEL_INTEL_EN = armed;
+        dev.usr_bank.bank2.bytes.ACCEL_INTEL_CTRL.bits.ACCEL_INTEL_MODE_INT = 1;
+        ret = _write_cfg(ICM20948_ADDR_ACCEL_INTEL_CTRL, &dev.usr_bank.bank2.bytes.ACCEL_INTEL_CTRL.byte, 0x01);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        ret = _select_bank(ICM20948_USER_BANK_0);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        // Route the motion interrupt to INT1
+        dev.usr_bank.bank0.bytes.INT_ENABLE.bits.WOM_INT_EN = armed;
+        ret = _write_cfg(ICM20948_ADDR_INT_ENABLE, &dev.usr_bank.bank0.bytes.INT_ENABLE.byte, 0x01);
+    }
+
+    ret = _verify_flush(ret);
+
+    _unlock();
+
+    return ret;
+}
+
+/*!
+ * @brief This API reads and clears the wake-on-motion interrupt status
+ */
+icm20948_return_code_t icm20948_getWakeOnMotionStatus(bool *triggered) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint8_t int_status = 0x00;
+
+    if( triggered == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    _lock();
+
+    if( ret == ICM20948_RET_OK ) {
+        ret = _select_bank(ICM20948_USER_BANK_0);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        // Reading INT_STATUS clears it
+        ret = _spi_read(ICM20948_ADDR_INT_STATUS, &int_status, 0x01);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        *triggered = ((int_status & ICM20948_INT_STATUS_WOM_INT) != 0);
+    }
+
+    _unlock();
+
+    return ret;
+}
+
+/*!
+ * @brief This API switches the accel between continuous and duty-cycled sampling
+ */
+icm20948_return_code_t icm20948_enableAccelCycle(icm20948_mod_enable_t en, uint8_t averaging) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( averaging > 0x03 ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    _lock();
+
+    if( ret == ICM20948_RET_OK ) {
+        ret = _select_bank(ICM20948_USER_BANK_2);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        dev.usr_bank.bank2.bytes.ACCEL_CONFIG_2.bits.DEC3_CFG = averaging;
+        ret = _write_cfg(ICM20948_ADDR_ACCEL_CONFIG_2, &dev.usr_bank.bank2.bytes.ACCEL_CONFIG_2.byte, 0x01);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        ret = _select_bank(ICM20948_USER_BANK_0);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        dev.usr_bank.bank0.bytes.LP_CONFIG.bits.ACCEL_CYCLE = (en == ICM20948_MOD_ENABLED) ? 1 : 0;
+        ret = _write_cfg(ICM20948_ADDR_LP_CONFIG, &dev.usr_bank.bank0.bytes.LP_CONFIG.byte, 0x01);
+    }
+
+    ret = _verify_flush(ret);
+
+    _unlock();
+
+    return ret;
+}
+
+#endif
+
+#if ICM20948_FEATURE_VERIFY
+/*!
+ * @brief This API enables verify-after-write of configuration registers
+ */
+icm20948_return_code_t icm20948_setVerify(icm20948_mod_enable_t en) {
+    _lock();
+    dev.verify.en = (en == ICM20948_MOD_ENABLED);
+    dev.verify.count = 0;
+    _unlock();
+
+    return ICM20948_RET_OK;
+}
+
+/*!
+ * @brief This API retrieves the verify-after-write counters
+ */
+icm20948_return_code_t icm20948_getVerifyStats(icm20948_verify_stats_t *stats, bool reset) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( stats == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        _lock();
+        *stats = dev.verify.stats;
+        if( reset ) {
+            memset(&dev.verify.stats, 0x00, sizeof(dev.verify.stats));
+        }
+        _unlock();
+    }
+
+    return ret;
+}
+#endif
+
+#if ICM20948_FEATURE_REGDUMP
+/*!
+ * @brief This API reads a run of registers from any user bank
+ */
+icm20948_return_code_t icm20948_readRegisters(uint8_t bank, uint8_t addr, uint8_t *data, uint32_t len) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( data == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (bank > ICM20948_USER_BANK_3) || (len == 0) || (((uint32_t)addr + len) > 0x80) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        _lock();
+
+        ret = _select_bank((icm20948_reg_bank_sel_t)bank);
+
+        if( ret == ICM20948_RET_OK ) {
+            ret = _spi_read(addr, data, len);
+        }
+
+        _unlock();
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API retrieves the value the driver last wrote to a configuration register
+ */
+icm20948_return_code_t icm20948_getShadowRegister(uint8_t bank, uint8_t addr, uint8_t *value) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint8_t n = 0;
+
+    if( value == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        _lock();
+
+        n = _shadow_index(bank, addr);
+
+        if( (n < ICM20948_SHADOW_MAP_LEN) && (dev.written & (0x01 << n)) ) {
+            *value = *shadow_map[n].reg;
+        }
+        else {
+            ret = ICM20948_RET_INV_PARAM;
+        }
+
+        _unlock();
+    }
+
+    return ret;
+}
+#endif
+
+#if ICM20948_FEATURE_INSTRUMENTATION
+/*!
+ * @brief This API retrieves the bus activity counters
+ */
+icm20948_return_code_t icm20948_getBusStats(icm20948_bus_stats_t *stats, bool reset) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( stats == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        _lock();
+        *stats = dev.stats;
+        if( reset ) {
+            memset(&dev.stats, 0x00, sizeof(dev.stats));
+        }
+        _unlock();
+    }
+
+    return ret;
+}
+#endif
+
+/*!
+ * @brief This API retrieves the gyro sensitivity for a full scale setting
+ */
+float icm20948_gyroSensitivity(icm20948_gyro_full_scale_select_t fs) {
+    float lsb = 0.0f;
+
+    switch( fs ) {
+        case ICM20948_GYRO_FS_SEL_250DPS:
+            lsb = 131.0f;
+            break;
+
+        case ICM20948_GYRO_FS_SEL_500DPS:
+            lsb = 65.5f;
+            break;
+
+        case ICM20948_GYRO_FS_SEL_1000DPS:
+            lsb = 32.8f;
+            break;
+
+        case ICM20948_GYRO_FS_SEL_2000DPS:
+            lsb = 16.4f;
+            break;
+
+        default:
+            break;
+    }
+
+    return lsb;
+}
+
+/*!
+ * @brief This API retrieves the accel sensitivity for a full scale setting
+ */
+float icm20948_accelSensitivity(icm20948_accel_full_scale_select_t fs) {
+    float lsb = 0.0f;
+
+    switch( fs ) {
+        case ICM20948_ACCEL_FS_SEL_2G:
+            lsb = 16384.0f;
+            break;
+
+        case ICM20948_ACCEL_FS_SEL_4G:
+            lsb = 8192.0f;
+            break;
+
+        case ICM20948_ACCEL_FS_SEL_8G:
+            lsb = 4096.0f;
+            break;
+
+        case ICM20948_ACCEL_FS_SEL_16G:
+            lsb = 2048.0f;
+            break;
+
+        default:
+            break;
+    }
+
+    return lsb;
+}
+
+/*!
+ * @brief This API converts a block of raw samples to scaled board frame samples in a single pass
+ */
+icm20948_return_code_t icm20948_convertBlock(icm20948_sensor_t sensor, const icm20948_block_t *raw, icm20948_fblock_t *out) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    // The AK09916 shares X with the chip but its Y and Z point the other way
+    float align[3] = { 1.0f, 1.0f, 1.0f };
+    float scale = 0.0f;
+    icm20948_accel_full_scale_select_t accel_fs;
+    icm20948_gyro_full_scale_select_t gyro_fs;
+    icm20948_mount_t mount_cfg;
+
+    // Take a consistent view of the settings the block is scaled with
+    _lock();
+    accel_fs = settings.accel.fs;
+    gyro_fs = settings.gyro.fs;
+    mount_cfg = settings.mount;
+    _unlock();
+
+    if( (raw == NULL) || (out == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (raw->len != 0) && ((raw->x == NULL) || (raw->y == NULL) || (raw->z == NULL) ||
+             (out->x == NULL) || (out->y == NULL) || (out->z == NULL)) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( out->len < raw->len ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        switch( sensor ) {
+            case ICM20948_SENSOR_ACCEL:
+                scale = 1.0f / icm20948_accelSensitivity(accel_fs);
+                break;
+
+            case ICM20948_SENSOR_GYRO:
+                scale = 1.0f / icm20948_gyroSensitivity(gyro_fs);
+                break;
+
+#if ICM20948_FEATURE_MAG
+            case ICM20948_SENSOR_MAG:
+                scale = ICM20948_MAG_UT_PER_LSB;
+                align[1] = -1.0f;
+                align[2] = -1.0f;
+                break;
+#endif
+
+            default:
+                ret = ICM20948_RET_INV_PARAM;
+                break;
+        }
+
+        // An invalid full scale setting leaves an infinite scale
+        if( (ret == ICM20948_RET_OK) && (isfinite(scale) == 0) ) {
+            ret = ICM20948_RET_INV_CONFIG;
+        }
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        const int16_t *src[3] = { raw->x, raw->y, raw->z };
+        float *dst[3] = { out->x, out->y, out->z };
+        const icm20948_mount_t *mount = &mount_cfg;
+
+        if( mount->type == ICM20948_MOUNT_MATRIX ) {
+            // Fold the scale and the sensor alignment into the matrix columns
+            float m[3][3];
+            for( uint8_t r = 0; r < 3; r++ ) {
+                for( uint8_t c = 0; c < 3; c++ ) {
+                    m[r][c] = mount->m[r][c] * align[c] * scale;
+                }
+            }
+
+            for( uint8_t r = 0; r < 3; r++ ) {
+                float *o = dst[r];
+                const float m0 = m[r][0];
+                const float m1 = m[r][1];
+                const float m2 = m[r][2];
+                for( uint32_t i = 0; i < raw->len; i++ ) {
+                    o[i] = (m0 * (float)raw->x[i]) + (m1 * (float)raw->y[i]) + (m2 * (float)raw->z[i]);
+                }
+            }
+        }
+        else {
+            // Signed permutation fast path, including the identity. Each output axis
+            // is a single scaled copy of one input axis, which vectorizes cleanly.
+            for( uint8_t r = 0; r < 3; r++ ) {
+                uint8_t c = r;
+                float k = scale;
+
+                if( mount->type == ICM20948_MOUNT_SIGNED_PERM ) {
+                    c = mount->perm[r];
+                    k *= (float)mount->sign[r];
+                }
+                k *= align[c];
+
+                const int16_t *in = src[c];
+                float *o = dst[r];
+                for( uint32_t i = 0; i < raw->len; i++ ) {
+                    o[i] = (float)in[i] * k;
+                }
+            }
+        }
+
+        out->len = raw->len;
+    }
+
+    return ret;
+}
@@ -34,15 +34,20 @@ extern "C" {
 #define _ICM20948_H_
 
 #include <stdint.h>
+#include <math.h>
 #include "icm20948_api.h"
+#include "icm20948_regs.h"
 
 #define ICM20948_BANK0_REG_COUNT            (65)
 #define ICM20948_BANK1_REG_COUNT            (14)
 #define ICM20948_BANK2_REG_COUNT            (20)
 #define ICM20948_BANK3_REG_COUNT            (25)
 
-#define ICM20948_WHO_AM_I_DEFAULT           (0xEA)
-#define ICM20948_EXT_SLV_SENS_DATA_COUNT    (25)
+#define ICM20948_EXT_SLV_SENS_DATA_COUNT    (24)
+
+#define ICM20948_FIFO_CHUNK_FRAMES          (10)
+
+#define ICM20948_MAG_UT_PER_LSB             (0.15f)
 
 #define ICM20948_GYRO_RATE_250              (0x00)
 #define ICM20948_GYRO_LPF_17HZ              (0x29)
@@ -54,84 +59,152 @@ typedef enum {
     ICM20948_USER_BANK_3 = 0x03
 } icm20948_reg_bank_sel_t;
 
-#define ICM20948_ADDR_REG_BANK_SEL          (0x7F)
+// Configuration registers the driver writes, shared by the full and compact shadows
+typedef union {
+    struct {
+        uint8_t RSVD                : 1;
+        uint8_t I2C_MST_RST         : 1;
+        uint8_t SRAM_RST            : 1;
+        uint8_t DMP_RST             : 1;
+        uint8_t I2C_IF_DS           : 1;
+        uint8_t I2C_MST_EN          : 1;
+        uint8_t FIFO_EN             : 1;
+        uint8_t DMP_EN              : 1;
+    } bits;
+    uint8_t byte;
+} icm20948_reg_user_ctrl_t;
 
-typedef enum {
-    ICM20948_ADDR_WHO_AM_I = 0x00,
-    ICM20948_ADDR_PWR_MGMT_1 = 0x06,
-    ICM20948_ADDR_PWR_MGMT_2 = 0x07,
-    ICM20948_ADDR_ACCEL_XOUT_H = 0x2D,
-    ICM20948_ADDR_ACCEL_XOUT_L = 0x2E,
-    ICM20948_ADDR_ACCEL_YOUT_H = 0x2F,
-    ICM20948_ADDR_ACCEL_YOUT_L = 0x30,
-    ICM20948_ADDR_ACCEL_ZOUT_H = 0x31,
-    ICM20948_ADDR_ACCEL_ZOUT_L = 0x32,
-    ICM20948_ADDR_GYRO_XOUT_H = 0x33,
-    ICM20948_ADDR_GYRO_XOUT_L = 0x34,
-    ICM20948_ADDR_GYRO_YOUT_H = 0x35,
-    ICM20948_ADDR_GYRO_YOUT_L = 0x36,
-    ICM20948_ADDR_GYRO_ZOUT_H = 0x37,
-    ICM20948_ADDR_GYRO_ZOUT_L = 0x38,
-} icm20948_reg_bank0_addr_t;
+typedef union {
+    struct {
+        uint8_t RSVD0               : 4;
+        uint8_t GYRO_CYCLE          : 1;
+        uint8_t ACCEL_CYCLE         : 1;
+        uint8_t I2C_MST_CYCLE       : 1;
+        uint8_t RSVD1               : 1;
+    } bits;
+    uint8_t byte;
+} icm20948_reg_lp_config_t;
 
-typedef enum {
-    ICM20948_ADDR_GYRO_SMPLRT_DIV = 0x00,
-    ICM20948_ADDR_GYRO_CONFIG_1 = 0x01,
-    ICM20948_ADDR_ACCEL_SMPLRT_DIV_1 = 0x10,
-    ICM20948_ADDR_ACCEL_SMPLRT_DIV_2 = 0x11,
-    ICM20948_ADDR_ACCEL_CONFIG  = 0x14,
-    ICM20948_ADDR_ACCEL_CONFIG_2 = 0x15,
-} icm20948_reg_bank2_addr_t;
+typedef union {
+    struct {
+        uint8_t CLKSEL              : 3;
+        uint8_t TEMP_DIS            : 1;
+        uint8_t RSVD                : 1;
+        uint8_t LP_EN               : 1;
+        uint8_t SLEEP               : 1;
+        uint8_t DEVICE_RESET        : 1;
+    } bits;
+    uint8_t byte;
+} icm20948_reg_pwr_mgmt_1_t;
+
+typedef union {
+    struct {
+        uint8_t DISABLE_GYRO        : 3;
+        uint8_t DISABLE_ACCEL       : 3;
+        uint8_t RSVD                : 2;
+    } bits;
+    uint8_t byte;
+} icm20948_reg_pwr_mgmt_2_t;
+
+typedef union {
+    struct {
+        uint8_t I2C_MST_INT_EN      : 1;
+        uint8_t DMP_INT1_EN         : 1;
+        uint8_t PLL_RDY_EN          : 1;
+        uint8_t WOM_INT_EN          : 1;
+        uint8_t RSVD                : 3;
+        uint8_t REG_WOF_EN          : 1;
+    } bits;
+    uint8_t byte;
+} icm20948_reg_int_enable_t;
+
+typedef union {
+    struct {
+        uint8_t TEMP_FIFO_EN        : 1;
+        uint8_t GYRO_X_FIFO_EN      : 1;
+        uint8_t GYRO_Y_FIFO_EN      : 1;
+        uint8_t GYRO_Z_FIFO_EN      : 1;
+        uint8_t ACCEL_FIFO_EN       : 1;
+        uint8_t RSVD                : 3;
+    } bits;
+    uint8_t byte;
+} icm20948_reg_fifo_en_2_t;
+
+typedef union {
+    struct {
+        uint8_t FIFO_RESET          : 5;
+        uint8_t RSVD                : 3;
+    } bits;
+    uint8_t byte;
+} icm20948_reg_fifo_rst_t;
+
+typedef union {
+    struct {
+        uint8_t FIFO_MODE           : 5;
+        uint8_t RSVD                : 3;
+    } bits;
+    uint8_t byte;
+} icm20948_reg_fifo_mode_t;
+
+typedef union {
+    struct {
+        uint8_t GYRO_FCHOICE        : 1;
+        uint8_t GYRO_FS_SEL         : 2;
+        uint8_t GYRO_DLPFCFG        : 3;
+        uint8_t RSVD                : 2;
+    } bits;
+    uint8_t byte;
+} icm20948_reg_gyro_config_1_t;
+
+typedef union {
+    struct {
+        uint8_t ACCEL_SMPLRT_DIV    : 4;
+        uint8_t RSVD                : 4;
+    } bits;
+    uint8_t byte;
+} icm20948_reg_accel_smplrt_div_1_t;
+
+typedef union {
+    struct {
+        uint8_t ACCEL_INTEL_MODE_INT    : 1;
+        uint8_t ACCEL_INTEL_EN      : 1;
+        uint8_t RSVD                : 6;
+    } bits;
+    uint8_t byte;
+} icm20948_reg_accel_intel_ctrl_t;
+
+typedef union {
+    struct {
+        uint8_t ACCEL_FCHOICE       : 1;
+        uint8_t ACCEL_FS_SEL        : 2;
+        uint8_t ACCEL_DLPFCFG       : 3;
+        uint8_t RSVD                : 2;
+    } bits;
+    uint8_t byte;
+} icm20948_reg_accel_config_t;
+
+typedef union {
+    struct {
+        uint8_t DEC3_CFG            : 2;
+        uint8_t AZ_ST_EN_REG        : 1;
+        uint8_t AY_ST_EN_REG        : 1;
+        uint8_t AX_ST_EN_REG        : 1;
+        uint8_t RSVD                : 3;
+    } bits;
+    uint8_t byte;
+} icm20948_reg_accel_config_2_t;
 
 typedef union {
     struct {
         uint8_t WHO_AM_I;
 
-        union {
-            struct {
-                uint8_t RSVD                : 1;
-                uint8_t I2C_MST_RST         : 1;
-                uint8_t SRAM_RST            : 1;
-                uint8_t DMP_RST             : 1;
-                uint8_t I2C_IF_DS           : 1;
-                uint8_t I2C_MST_EN          : 1;
-                uint8_t FIFO_EN             : 1;
-                uint8_t DMP_EN              : 1;
-            } bits;
-            uint8_t byte;
-        } USER_CTRL;
+        icm20948_reg_user_ctrl_t USER_CTRL;
 
-        union {
-            struct {
-                uint8_t RSVD0               : 4;
-                uint8_t GYRO_CYCLE          : 1;
-                uint8_t ACCEL_CYCLE         : 1;
-                uint8_t I2C_MST_CYCLE       : 1;
-                uint8_t RSVD1               : 1;
-            } bits;
-            uint8_t byte;
-        } LP_CONFIG;
+        icm20948_reg_lp_config_t LP_CONFIG;
 
-        union {
-            struct {
-                uint8_t CLKSEL              : 3;
-                uint8_t TEMP_DIS            : 1;
-                uint8_t RSVD                : 1;
-                uint8_t LP_EN               : 1;
-                uint8_t SLEEP               : 1;
-                uint8_t DEVICE_RESET        : 1;
-            } bits;
-            uint8_t byte;
-        } PWR_MGMT_1;
+        icm20948_reg_pwr_mgmt_1_t PWR_MGMT_1;
 
-        union {
-            struct {
-                uint8_t DISABLE_GYRO        : 3;
-                uint8_t DISABLE_ACCEL       : 3;
-                uint8_t RSVD                : 2;
-            } bits;
-            uint8_t byte;
-        } PWR_MGMT_2;
+        icm20948_reg_pwr_mgmt_2_t PWR_MGMT_2;
 
         union {
             struct {
@@ -147,17 +220,7 @@ typedef union {
             uint8_t byte;
         } INT_PIN_CFG;
 
-        union {
-            struct {
-                uint8_t I2C_MST_INT_EN      : 1;
-                uint8_t DMP_INT1_EN         : 1;
-                uint8_t PLL_RDY_EN          : 1;
-                uint8_t WOM_INT_EN          : 1;
-                uint8_t RSVD                : 3;
-                uint8_t REG_WOF_EN          : 1;
-            } bits;
-            uint8_t byte;
-        } INT_ENABLE;
+        icm20948_reg_int_enable_t INT_ENABLE;
 
         union {
             struct {
@@ -261,33 +324,11 @@ typedef union {
             uint8_t byte;
         } FIFO_EN_1;
 
-        union {
-            struct {
-                uint8_t TEMP_FIFO_EN        : 1;
-                uint8_t GYRO_X_FIFO_EN      : 1;
-                uint8_t GYRO_Y_FIFO_EN      : 1;
-                uint8_t GYRO_Z_FIFO_EN      : 1;
-                uint8_t ACCEL_FIFO_EN       : 1;
-                uint8_t RSVD                : 3;
-            } bits;
-            uint8_t byte;
-        } FIFO_EN_2;
+        icm20948_reg_fifo_en_2_t FIFO_EN_2;
 
-        union {
-            struct {
-                uint8_t FIFO_RESET          : 5;
-                uint8_t RSVD                : 3;
-            } bits;
-            uint8_t byte;
-        } FIFO_RST;
+        icm20948_reg_fifo_rst_t FIFO_RST;
 
-        union {
-            struct {
-                uint8_t FIFO_MODE           : 5;
-                uint8_t RSVD                : 3;
-            } bits;
-            uint8_t byte;
-        } FIFO_MODE;
+        icm20948_reg_fifo_mode_t FIFO_MODE;
 
         union {
             struct {
@@ -370,15 +411,7 @@ typedef union {
     struct {
         uint8_t GYRO_SMPLRT_DIV;
 
-        union {
-            struct {
-                uint8_t GYRO_FCHOICE        : 1;
-                uint8_t GYRO_FS_SEL         : 2;
-                uint8_t GYRO_DLPFCFG        : 3;
-                uint8_t RSVD                : 2;
-            } bits;
-            uint8_t byte;
-        } GYRO_CONFIG_1;
+        icm20948_reg_gyro_config_1_t GYRO_CONFIG_1;
 
         union {
             struct {
@@ -406,47 +439,17 @@ typedef union {
             uint8_t byte;
         } ODR_ALIGN_EN;
 
-        union {
-            struct {
-                uint8_t ACCEL_SMPLRT_DIV    : 4;
-                uint8_t RSVD                : 4;
-            } bits;
-            uint8_t byte;
-        } ACCEL_SMPLRT_DIV_1;
+        icm20948_reg_accel_smplrt_div_1_t ACCEL_SMPLRT_DIV_1;
 
         uint8_t ACCEL_SMPLRT_DIV_2;
 
-        union {
-            struct {
-                uint8_t ACCEL_INTEL_MODE_INT    : 1;
-                uint8_t ACCEL_INTEL_EN      : 1;
-                uint8_t RSVD                : 6;
-            } bits;
-            uint8_t byte;
-        } ACCEL_INTEL_CTRL;
+        icm20948_reg_accel_intel_ctrl_t ACCEL_INTEL_CTRL;
 
         uint8_t ACCEL_WOM_THR;
 
-        union {
-            struct {
-                uint8_t ACCEL_FCHOICE       : 1;
-                uint8_t ACCEL_FS_SEL        : 2;
-                uint8_t ACCEL_DLPFCFG       : 3;
-                uint8_t RSVD                : 2;
-            } bits;
-            uint8_t byte;
-        } ACCEL_CONFIG;
+        icm20948_reg_accel_config_t ACCEL_CONFIG;
 
-        union {
-            struct {
-                uint8_t DEC3_CFG            : 2;
-                uint8_t AZ_ST_EN_REG        : 1;
-                uint8_t AY_ST_EN_REG        : 1;
-                uint8_t AX_ST_EN_REG        : 1;
-                uint8_t RSVD                : 3;
-            } bits;
-            uint8_t byte;
-        } ACCEL_CONFIG_2;
+        icm20948_reg_accel_config_2_t ACCEL_CONFIG_2;
 
         union {
             struct {
@@ -506,7 +509,7 @@ typedef union {
                 uint8_t MULT_MST_EN         : 1;
             } bits;
             uint8_t byte;
-        } ISC_MST_CTRL;
+        } I2C_MST_CTRL;
 
         union {
             struct {
@@ -548,8 +551,8 @@ typedef union {
         // Slave 1
         union {
             struct {
-                uint8_t I2C_ID_0            : 7;
-                uint8_t I2C_SLV0_RNW        : 1;
+                uint8_t I2C_ID_1            : 7;
+                uint8_t I2C_SLV1_RNW        : 1;
             } bits;
             uint8_t byte;
         } I2C_SLV1_ADDR;
@@ -630,16 +633,16 @@ typedef union {
 
         union {
             struct {
-                uint8_t I2C_SLV4_LENG       : 4;
-                uint8_t I2C_SLV4_GRP        : 1;
+                uint8_t I2C_SLV4_DLY        : 5;
                 uint8_t I2C_SLV4_REG_DIS    : 1;
-                uint8_t I2C_SLV4_BYTE_SW    : 1;
+                uint8_t I2C_SLV4_INT_EN     : 1;
                 uint8_t I2C_SLV4_EN         : 1;
             } bits;
             uint8_t byte;
         } I2C_SLV4_CTRL;
 
         uint8_t I2C_SLV4_DO;
+        uint8_t I2C_SLV4_DI;
 
         union {
             struct {
@@ -654,6 +657,7 @@ typedef union {
     uint8_t arr[ICM20948_BANK3_REG_COUNT];
 } icm20948_reg_bank_3_t;
 
+#if ICM20948_FEATURE_FULL_SHADOW
 typedef struct {
     icm20948_reg_bank_0_t bank0;
     icm20948_reg_bank_1_t bank1;
@@ -661,18 +665,149 @@ typedef struct {
     icm20948_reg_bank_3_t bank3;
     icm20948_reg_bank_sel_t reg_bank_sel;
 } icm20948_usr_bank_t;
+#else
+// Compact shadow holding only the configuration registers the driver writes, packed
+// by bank under the same names as the full shadow. Read-only and output registers
+// are read into locals or caller buffers instead.
+typedef struct {
+    struct {
+        struct {
+            icm20948_reg_user_ctrl_t USER_CTRL;
+            icm20948_reg_lp_config_t LP_CONFIG;
+            icm20948_reg_pwr_mgmt_1_t PWR_MGMT_1;
+            icm20948_reg_pwr_mgmt_2_t PWR_MGMT_2;
+            icm20948_reg_int_enable_t INT_ENABLE;
+            icm20948_reg_fifo_en_2_t FIFO_EN_2;
+            icm20948_reg_fifo_rst_t FIFO_RST;
+            icm20948_reg_fifo_mode_t FIFO_MODE;
+        } bytes;
+    } bank0;
+    struct {
+        struct {
+            uint8_t GYRO_SMPLRT_DIV;
+            icm20948_reg_gyro_config_1_t GYRO_CONFIG_1;
+            icm20948_reg_accel_smplrt_div_1_t ACCEL_SMPLRT_DIV_1;
+            uint8_t ACCEL_SMPLRT_DIV_2;
+            icm20948_reg_accel_intel_ctrl_t ACCEL_INTEL_CTRL;
+            uint8_t ACCEL_WOM_THR;
+            icm20948_reg_accel_config_t ACCEL_CONFIG;
+            icm20948_reg_accel_config_2_t ACCEL_CONFIG_2;
+        } bytes;
+    } bank2;
+    uint8_t reg_bank_sel;
+} icm20948_usr_bank_t;
+#endif
 
 typedef struct {
     icm20948_read_fptr_t read;
     icm20948_write_fptr_t write;
     icm20948_delay_us_fptr_t delay_us;
+#if ICM20948_FEATURE_LOCK
+    icm20948_lock_fptr_t lock;
+    icm20948_lock_fptr_t unlock;
+    void *lock_ctx;
+#endif
 } icm20948_dev_intf_t;
 
+#if ICM20948_FEATURE_VERIFY
+#define ICM20948_VERIFY_MAX_PENDING         (12)
+#define ICM20948_VERIFY_RETRIES             (2)
+
+/*! @brief A configuration register written since the last verify, and the value it
+ * should read back */
+typedef struct {
+    uint8_t bank;
+    uint8_t addr;
+    uint8_t *expect;
+} icm20948_verify_entry_t;
+
+typedef struct {
+    bool en;
+    uint8_t count;
+    icm20948_verify_entry_t pending[ICM20948_VERIFY_MAX_PENDING];
+    icm20948_verify_stats_t stats;
+} icm20948_verify_t;
+#endif
+
 typedef struct {
     icm20948_dev_intf_t intf;
     icm20948_usr_bank_t usr_bank;
+#if ICM20948_FEATURE_VERIFY
+    icm20948_verify_t verify;
+#endif
+#if ICM20948_FEATURE_REGDUMP
+    uint16_t written;           // Shadowed configuration registers written since init
+#endif
+#if ICM20948_FEATURE_FIFO
+    uint32_t fifo_resets;       // FIFO reconfigurations, each discards what it held
+#endif
+#if ICM20948_FEATURE_INSTRUMENTATION
+    icm20948_bus_stats_t stats;
+#endif
 } icm20948_dev_t;
 
+/*!
+ * @brief This API checks whether reading a register changes chip state. In bank 0
+ * I2C_MST_STATUS and INT_STATUS to INT_STATUS_3 clear on read, FIFO_R_W pops the FIFO
+ * and MEM_R_W advances the DMP address. Bursts that read registers back for a
+ * diagnostic or a verify must split around these.
+ *
+ * @param[in] bank: User register bank
+ * @param[in] addr: Register address
+ *
+ * @return Returns true if reading the register has side effects
+ */
+static inline bool _icm20948_read_has_side_effects(uint8_t bank, uint8_t addr) {
+    static const uint8_t bank0[] = {
+        ICM20948_ADDR_I2C_MST_STATUS, ICM20948_ADDR_INT_STATUS, ICM20948_ADDR_INT_STATUS_1, ICM20948_ADDR_INT_STATUS_2,
+        ICM20948_ADDR_INT_STATUS_3, ICM20948_ADDR_FIFO_R_W, ICM20948_ADDR_MEM_R_W
+    };
+    bool side_effects = false;
+
+    for( uint8_t i = 0; (bank == 0) && (i < sizeof(bank0)); i++ ) {
+        side_effects = side_effects || (bank0[i] == addr);
+    }
+
+    return side_effects;
+}
+
+/*!
+ * @brief This API checks that a mounting transform is well formed, before it is applied
+ * or accepted from a stored configuration
+ *
+ * @param[in] mount: Pointer to the mounting transform
+ *
+ * @return Returns true if the transform can be applied
+ */
+static inline bool _icm20948_mount_valid(const icm20948_mount_t *mount) {
+    bool valid = true;
+
+    if( mount->type == ICM20948_MOUNT_SIGNED_PERM ) {
+        // Every chip axis must be used exactly once
+        uint8_t used = 0x00;
+        for( uint8_t i = 0; i < 3; i++ ) {
+            if( (mount->perm[i] > 2) || ((mount->sign[i] != 1) && (mount->sign[i] != -1)) ) {
+                valid = false;
+            }
+            else {
+                used |= (uint8_t)(0x01 << mount->perm[i]);
+            }
+        }
+        valid = valid && (used == 0x07);
+    }
+    else if( mount->type == ICM20948_MOUNT_MATRIX ) {
+        // A NaN or infinity would poison every converted sample
+        for( uint8_t i = 0; i < 9; i++ ) {
+            valid = valid && isfinite(mount->m[i / 3][i % 3]);
+        }
+    }
+    else if( mount->type != ICM20948_MOUNT_IDENTITY ) {
+        valid = false;
+    }
+
+    return valid;
+}
+
 #endif // _ICM20948_H_
 
 #ifdef __cplusplus
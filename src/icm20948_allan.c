@@ -0,0 +1,182 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_allan.c
+ * @brief Source file for the ICM20948 streaming Allan deviation estimator.
+ */
+
+#include <string.h>
+#include <math.h>
+#include "icm20948_allan.h"
+
+/*! @brief Bias instability is read off the flat region as sigma_min / sqrt(2 ln 2 / pi) */
+#define ICM20948_ALLAN_BIAS_FACTOR          (0.664)
+
+/*! @brief Largest distance from the ideal slope still considered part of a noise region */
+#define ICM20948_ALLAN_SLOPE_TOL            (0.15)
+
+/*!
+ * @brief This API initializes an Allan deviation estimator for one axis
+ */
+icm20948_return_code_t icm20948_allanInit(icm20948_allan_t *est, int64_t *hist, uint8_t taus) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (est == NULL) || (hist == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (taus == 0) || (taus > ICM20948_ALLAN_MAX_TAUS) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        memset(est, 0x00, sizeof(icm20948_allan_t));
+        est->hist = hist;
+        est->taus = taus;
+        // The cumulative sum before the first sample is zero
+        est->hist[0] = 0;
+        est->k = 1;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API feeds a contiguous run of raw samples of one axis to the estimator
+ */
+icm20948_return_code_t icm20948_allanAdd(icm20948_allan_t *est, const int16_t *data, uint32_t len) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (est == NULL) || ((data == NULL) && (len != 0)) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        const uint64_t mask = ((uint64_t)1 << est->taus) - 1;
+        int64_t *hist = est->hist;
+        int64_t cum = est->cum;
+        uint64_t k = est->k;
+
+        for( uint32_t i = 0; i < len; i++ ) {
+            cum += data[i];
+
+            // With C the cumulative sum, each term is the difference of two adjacent
+            // cluster sums, C(k) - 2C(k - m) + C(k - 2m), which is exact in integers
+            for( uint8_t j = 0; j < est->taus; j++ ) {
+                const uint64_t m = (uint64_t)1 << j;
+                if( k < (2 * m) ) {
+                    break;
+                }
+
+                const int64_t d = cum - (2 * hist[(k - m) & mask]) + hist[(k - (2 * m)) & mask];
+                est->sum_sq[j] += (double)d * (double)d;
+                est->terms[j]++;
+            }
+
+            hist[k & mask] = cum;
+            k++;
+        }
+
+        est->cum = cum;
+        est->k = k;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API retrieves the overlapping Allan deviation at cluster size 2^idx
+ */
+double icm20948_allanDeviation(const icm20948_allan_t *est, uint8_t idx) {
+    double adev = 0.0;
+
+    if( (est != NULL) && (idx < est->taus) && (est->terms[idx] != 0) ) {
+        const double m = (double)((uint64_t)1 << idx);
+        adev = sqrt(est->sum_sq[idx] / (2.0 * m * m * (double)est->terms[idx]));
+    }
+
+    return adev;
+}
+
+/*!
+ * @brief This API extracts the standard noise coefficients from an Allan deviation curve
+ */
+icm20948_return_code_t icm20948_allanCoefficients(const double *tau, const double *adev, uint8_t count, icm20948_allan_coeff_t *coeff) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (tau == NULL) || (adev == NULL) || (coeff == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( count < 2 ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        double best_arw = ICM20948_ALLAN_SLOPE_TOL;
+        double best_rrw = ICM20948_ALLAN_SLOPE_TOL;
+        double min = adev[0];
+        uint8_t min_idx = 0;
+
+        memset(coeff, 0x00, sizeof(icm20948_allan_coeff_t));
+
+        for( uint8_t i = 1; i < count; i++ ) {
+            if( (adev[i] > 0.0) && (adev[i] < min) ) {
+                min = adev[i];
+                min_idx = i;
+            }
+        }
+        coeff->bias_instability = min / ICM20948_ALLAN_BIAS_FACTOR;
+        coeff->tau_bias = tau[min_idx];
+
+        for( uint8_t i = 0; (i + 1) < count; i++ ) {
+            if( (adev[i] <= 0.0) || (adev[i + 1] <= 0.0) ) {
+                continue;
+            }
+
+            // Local log-log slope between neighbouring points
+            const double slope = log(adev[i + 1] / adev[i]) / log(tau[i + 1] / tau[i]);
+            const double t = sqrt(tau[i] * tau[i + 1]);
+            const double a = sqrt(adev[i] * adev[i + 1]);
+
+            // White noise, sigma = N / sqrt(tau), read where the slope is closest to -1/2
+            if( fabs(slope + 0.5) < best_arw ) {
+                best_arw = fabs(slope + 0.5);
+                coeff->arw = a * sqrt(t);
+            }
+
+            // Random walk, sigma = K * sqrt(tau / 3), read where the slope is closest to +1/2
+            if( (i >= min_idx) && (fabs(slope - 0.5) < best_rrw) ) {
+                best_rrw = fabs(slope - 0.5);
+                coeff->rrw = a * sqrt(3.0 / t);
+            }
+        }
+
+        // Without a clean -1/2 region fall back to the shortest cluster time
+        if( coeff->arw == 0.0 ) {
+            coeff->arw = adev[0] * sqrt(tau[0]);
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,92 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_atomic.h
+ * @brief Private atomic access helpers for the structures shared between contexts.
+ *
+ * GCC and Clang, including the embedded ARM toolchains, provide the __atomic builtins
+ * on plain integer fields, so the public structures stay free of _Atomic types. Other
+ * compilers fall back to plain access, which is only safe where the caller serializes
+ * every context, e.g. by masking interrupts on a single core.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_ATOMIC_H_
+#define _ICM20948_ATOMIC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+
+#define ICM20948_LOAD_ACQUIRE(p)            __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ICM20948_LOAD_RELAXED(p)            __atomic_load_n((p), __ATOMIC_RELAXED)
+#define ICM20948_STORE_RELEASE(p, v)        __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define ICM20948_STORE_RELAXED(p, v)        __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define ICM20948_FETCH_ADD(p, v)            __atomic_fetch_add((p), (v), __ATOMIC_ACQ_REL)
+#define ICM20948_FETCH_SUB(p, v)            __atomic_fetch_sub((p), (v), __ATOMIC_ACQ_REL)
+#define ICM20948_CAS(p, expected, desired)  __atomic_compare_exchange_n((p), (expected), (desired), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#define ICM20948_FENCE_ACQUIRE()            __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define ICM20948_FENCE_FULL()               __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#else
+
+#define ICM20948_LOAD_ACQUIRE(p)            (*(p))
+#define ICM20948_LOAD_RELAXED(p)            (*(p))
+#define ICM20948_STORE_RELEASE(p, v)        (*(p) = (v))
+#define ICM20948_STORE_RELAXED(p, v)        (*(p) = (v))
+#define ICM20948_FETCH_ADD(p, v)            _icm20948_fetch_add32((p), (v))
+#define ICM20948_FETCH_SUB(p, v)            _icm20948_fetch_add32((p), (uint32_t)0 - (v))
+#define ICM20948_CAS(p, expected, desired)  _icm20948_cas32((p), (expected), (desired))
+#define ICM20948_FENCE_ACQUIRE()
+#define ICM20948_FENCE_FULL()
+
+static inline uint32_t _icm20948_fetch_add32(uint32_t *p, uint32_t v) {
+    const uint32_t old = *p;
+    *p = old + v;
+    return old;
+}
+
+static inline bool _icm20948_cas32(uint32_t *p, uint32_t *expected, uint32_t desired) {
+    const bool ok = (*p == *expected);
+    if( ok ) {
+        *p = desired;
+    }
+    else {
+        *expected = *p;
+    }
+    return ok;
+}
+
+#endif
+
+#endif // _ICM20948_ATOMIC_H_
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,509 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+
+/*! @file icm20948_blob.c
+ * @brief Source file for the ICM20948 persisted configuration and calibration blob.
+ */
+
+#include <string.h>
+#include "icm20948_blob.h"
+#include "icm20948.h"
+
+#define ICM20948_BLOB_LAST_TAG              (ICM20948_BLOB_GYRO_TEMP)
+
+// Data size of each known record, indexed by tag
+static const uint8_t rec_size[ICM20948_BLOB_LAST_TAG + 1] = {
+    0, 52, 6, 6, 48, 48, 48, 40, 40
+};
+
+// CRC-32 (reflected 0xEDB88320) remainders for one nibble, small enough for flash
+static const uint32_t crc_table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+/*!
+ * @brief This API folds bytes into a running CRC-32. Start from 0xFFFFFFFF and invert
+ * the final value.
+ *
+ * @param[in] crc: Running CRC
+ * @param[in] data: Pointer to the bytes to fold in
+ * @param[in] len: Number of bytes
+ *
+ * @return Returns the updated running CRC
+ */
+static uint32_t _crc32(uint32_t crc, const uint8_t *data, uint32_t len) {
+    for( uint32_t i = 0; i < len; i++ ) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ crc_table[crc & 0x0F];
+        crc = (crc >> 4) ^ crc_table[crc & 0x0F];
+    }
+
+    return crc;
+}
+
+/*!
+ * @brief This API packs a little endian uint16
+ *
+ * @param[out] dst: Pointer to the bytes to write
+ * @param[in] v: Value to pack
+ */
+static void _put_u16(uint8_t *dst, uint16_t v) {
+    dst[0] = (uint8_t)(v & 0xFF);
+    dst[1] = (uint8_t)(v >> 8);
+}
+
+/*!
+ * @brief This API packs a little endian uint32
+ *
+ * @param[out] dst: Pointer to the bytes to write
+ * @param[in] v: Value to pack
+ */
+static void _put_u32(uint8_t *dst, uint32_t v) {
+    dst[0] = (uint8_t)(v & 0xFF);
+    dst[1] = (uint8_t)((v >> 8) & 0xFF);
+    dst[2] = (uint8_t)((v >> 16) & 0xFF);
+    dst[3] = (uint8_t)((v >> 24) & 0xFF);
+}
+
+/*!
+ * @brief This API unpacks a little endian uint16
+ *
+ * @param[in] src: Pointer to the bytes to read
+ *
+ * @return Returns the unpacked value
+ */
+static uint16_t _get_u16(const uint8_t *src) {
+    return (uint16_t)(((uint16_t)src[1] << 8) | src[0]);
+}
+
+/*!
+ * @brief This API unpacks a little endian uint32
+ *
+ * @param[in] src: Pointer to the bytes to read
+ *
+ * @return Returns the unpacked value
+ */
+static uint32_t _get_u32(const uint8_t *src) {
+    return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+/*!
+ * @brief This API packs a run of floats as little endian IEEE-754 singles
+ *
+ * @param[out] dst: Pointer to the bytes to write
+ * @param[in] v: Pointer to the floats
+ * @param[in] count: Number of floats
+ */
+static void _put_floats(uint8_t *dst, const float *v, uint32_t count) {
+    uint32_t bits = 0;
+
+    for( uint32_t i = 0; i < count; i++ ) {
+        memcpy(&bits, &v[i], sizeof(bits));
+        _put_u32(&dst[i * 4], bits);
+    }
+}
+
+/*!
+ * @brief This API unpacks a run of little endian IEEE-754 singles
+ *
+ * @param[in] src: Pointer to the bytes to read
+ * @param[out] v: Pointer to the floats
+ * @param[in] count: Number of floats
+ */
+static void _get_floats(const uint8_t *src, float *v, uint32_t count) {
+    uint32_t bits = 0;
+
+    for( uint32_t i = 0; i < count; i++ ) {
+        bits = _get_u32(&src[i * 4]);
+        memcpy(&v[i], &bits, sizeof(bits));
+    }
+}
+
+/*!
+ * @brief This API locates the data of a record within a blob
+ *
+ * @param[in] blob: Pointer to the blob contents
+ * @param[in] tag: Record tag
+ *
+ * @return Returns a pointer to the record data in blob
+ */
+static const void *_rec_data(const icm20948_blob_t *blob, icm20948_blob_tag_t tag) {
+    const void *data = NULL;
+
+    switch( tag ) {
+        case ICM20948_BLOB_ACCEL_OFFS: data = blob->accel_offs; break;
+        case ICM20948_BLOB_GYRO_OFFS: data = blob->gyro_offs; break;
+        case ICM20948_BLOB_ACCEL_CAL: data = &blob->accel_cal; break;
+        case ICM20948_BLOB_GYRO_CAL: data = &blob->gyro_cal; break;
+        case ICM20948_BLOB_MAG_CAL: data = &blob->mag_cal; break;
+        case ICM20948_BLOB_ACCEL_TEMP: data = &blob->accel_temp; break;
+        case ICM20948_BLOB_GYRO_TEMP: data = &blob->gyro_temp; break;
+        default: data = &blob->settings; break;
+    }
+
+    return data;
+}
+
+/*!
+ * @brief This API packs the data of one record
+ *
+ * @param[out] dst: Pointer to the record data bytes to write
+ * @param[in] blob: Pointer to the blob contents
+ * @param[in] tag: Record tag
+ */
+static void _pack_rec(uint8_t *dst, const icm20948_blob_t *blob, icm20948_blob_tag_t tag) {
+    const icm20948_settings_t *s = &blob->settings;
+
+    if( tag == ICM20948_BLOB_SETTINGS ) {
+        memset(dst, 0x00, rec_size[tag]);
+        dst[0] = (uint8_t)s->gyro.en;
+        dst[1] = (uint8_t)s->gyro.fs;
+        dst[2] = (uint8_t)s->accel.en;
+        dst[3] = (uint8_t)s->accel.fs;
+        dst[4] = (uint8_t)s->mag.en;
+        dst[5] = blob->gyro_div;
+        _put_u16(&dst[6], blob->accel_div);
+        dst[8] = (uint8_t)s->mount.type;
+        memcpy(&dst[9], s->mount.perm, 3);
+        memcpy(&dst[12], s->mount.sign, 3);
+        _put_floats(&dst[16], &s->mount.m[0][0], 9);
+    }
+    else if( (tag == ICM20948_BLOB_ACCEL_OFFS) || (tag == ICM20948_BLOB_GYRO_OFFS) ) {
+        const int16_t *offs = (const int16_t *)_rec_data(blob, tag);
+        for( uint8_t i = 0; i < 3; i++ ) {
+            _put_u16(&dst[i * 2], (uint16_t)offs[i]);
+        }
+    }
+    else {
+        // Calibrations and temperature models are flat runs of floats
+        _put_floats(dst, (const float *)_rec_data(blob, tag), rec_size[tag] / 4);
+    }
+}
+
+/*!
+ * @brief This API unpacks and range checks the data of one record
+ *
+ * @param[in] src: Pointer to the record data bytes to read
+ * @param[out] blob: Pointer to the blob contents
+ * @param[in] tag: Record tag
+ *
+ * @return Returns the status of unpacking the record
+ */
+static icm20948_return_code_t _unpack_rec(const uint8_t *src, icm20948_blob_t *blob, icm20948_blob_tag_t tag) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    icm20948_settings_t *s = &blob->settings;
+
+    if( tag == ICM20948_BLOB_SETTINGS ) {
+        if( (src[0] > ICM20948_MOD_ENABLED) || (src[1] > ICM20948_GYRO_FS_SEL_2000DPS) ||
+            (src[2] > ICM20948_MOD_ENABLED) || (src[3] > ICM20948_ACCEL_FS_SEL_16G) ||
+            (src[4] > ICM20948_MOD_ENABLED) || (_get_u16(&src[6]) > 0x0FFF) || (src[8] > ICM20948_MOUNT_MATRIX) ) {
+            ret = ICM20948_RET_INV_CONFIG;
+        }
+        else {
+            s->gyro.en = (icm20948_mod_enable_t)src[0];
+            s->gyro.fs = (icm20948_gyro_full_scale_select_t)src[1];
+            s->accel.en = (icm20948_mod_enable_t)src[2];
+            s->accel.fs = (icm20948_accel_full_scale_select_t)src[3];
+            s->mag.en = (icm20948_mod_enable_t)src[4];
+            blob->gyro_div = src[5];
+            blob->accel_div = _get_u16(&src[6]);
+            s->mount.type = (icm20948_mount_type_t)src[8];
+            memcpy(s->mount.perm, &src[9], 3);
+            memcpy(s->mount.sign, &src[12], 3);
+            _get_floats(&src[16], &s->mount.m[0][0], 9);
+
+            // Rejected here rather than by icm20948_applySettings(), which runs after the
+            // dividers have already been taken
+            if( _icm20948_mount_valid(&s->mount) == false ) {
+                ret = ICM20948_RET_INV_CONFIG;
+            }
+        }
+    }
+    else if( (tag == ICM20948_BLOB_ACCEL_OFFS) || (tag == ICM20948_BLOB_GYRO_OFFS) ) {
+        int16_t *offs = (int16_t *)_rec_data(blob, tag);
+        for( uint8_t i = 0; i < 3; i++ ) {
+            offs[i] = (int16_t)_get_u16(&src[i * 2]);
+            if( (tag == ICM20948_BLOB_ACCEL_OFFS) && ((offs[i] < -16384) || (offs[i] > 16383)) ) {
+                ret = ICM20948_RET_INV_CONFIG;
+            }
+        }
+    }
+    else {
+        _get_floats(src, (float *)_rec_data(blob, tag), rec_size[tag] / 4);
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API checks a blob header and reads out the payload length
+ *
+ * @param[in] buf: Pointer to the blob
+ * @param[in] len: Number of bytes available in buf
+ * @param[out] payload: Pointer to where the payload length should be placed
+ *
+ * @return Returns the status of checking the header
+ */
+static icm20948_return_code_t _check_header(const uint8_t *buf, uint32_t len, uint32_t *payload) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( buf == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( len < ICM20948_BLOB_HEADER_SIZE ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+    else {
+        *payload = _get_u16(&buf[6]);
+
+        if( (_get_u32(&buf[0]) != ICM20948_BLOB_MAGIC) || (buf[4] == 0) || (buf[4] > ICM20948_BLOB_VERSION) ||
+            (*payload > (len - ICM20948_BLOB_HEADER_SIZE)) ) {
+            ret = ICM20948_RET_INV_PARAM;
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API serializes the records present in a blob
+ */
+icm20948_return_code_t icm20948_blobWrite(const icm20948_blob_t *blob, uint8_t *buf, uint32_t *len) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint32_t size = ICM20948_BLOB_HEADER_SIZE;
+    uint32_t crc = 0xFFFFFFFF;
+
+    if( (blob == NULL) || (buf == NULL) || (len == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else {
+        for( uint8_t tag = 1; tag <= ICM20948_BLOB_LAST_TAG; tag++ ) {
+            if( blob->present & ICM20948_BLOB_HAS(tag) ) {
+                size += 2u + rec_size[tag];
+            }
+        }
+
+        if( size > *len ) {
+            ret = ICM20948_RET_INV_PARAM;
+        }
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        uint32_t pos = ICM20948_BLOB_HEADER_SIZE;
+
+        for( uint8_t tag = 1; tag <= ICM20948_BLOB_LAST_TAG; tag++ ) {
+            if( blob->present & ICM20948_BLOB_HAS(tag) ) {
+                buf[pos] = tag;
+                buf[pos + 1] = rec_size[tag];
+                _pack_rec(&buf[pos + 2], blob, (icm20948_blob_tag_t)tag);
+                pos += 2u + rec_size[tag];
+            }
+        }
+
+        _put_u32(&buf[0], ICM20948_BLOB_MAGIC);
+        buf[4] = ICM20948_BLOB_VERSION;
+        buf[5] = 0;
+        _put_u16(&buf[6], (uint16_t)(size - ICM20948_BLOB_HEADER_SIZE));
+
+        crc = _crc32(crc, buf, 8);
+        crc = _crc32(crc, &buf[ICM20948_BLOB_HEADER_SIZE], size - ICM20948_BLOB_HEADER_SIZE);
+        _put_u32(&buf[8], crc ^ 0xFFFFFFFF);
+
+        *len = size;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API validates a blob's header and CRC without decoding it
+ */
+icm20948_return_code_t icm20948_blobValidate(const uint8_t *buf, uint32_t len) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint32_t payload = 0;
+    uint32_t crc = 0xFFFFFFFF;
+
+    ret = _check_header(buf, len, &payload);
+
+    if( ret == ICM20948_RET_OK ) {
+        crc = _crc32(crc, buf, 8);
+        crc = _crc32(crc, &buf[ICM20948_BLOB_HEADER_SIZE], payload);
+
+        if( (crc ^ 0xFFFFFFFF) != _get_u32(&buf[8]) ) {
+            ret = ICM20948_RET_GEN_FAIL;
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API validates and decodes a blob in a single pass
+ */
+icm20948_return_code_t icm20948_blobParse(const uint8_t *buf, uint32_t len, icm20948_blob_t *blob) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    icm20948_return_code_t rec_ret = ICM20948_RET_OK;
+    icm20948_blob_t out;
+    uint32_t payload = 0;
+    uint32_t pos = ICM20948_BLOB_HEADER_SIZE;
+    uint32_t end = 0;
+    uint32_t crc = 0xFFFFFFFF;
+
+    if( blob == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else {
+        ret = _check_header(buf, len, &payload);
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        memset(&out, 0x00, sizeof(out));
+        end = ICM20948_BLOB_HEADER_SIZE + payload;
+        crc = _crc32(crc, buf, 8);
+
+        // Decode each record as its bytes are folded into the CRC
+        while( (pos < end) && (rec_ret == ICM20948_RET_OK) ) {
+            uint8_t tag = buf[pos];
+            uint32_t size = 0;
+
+            if( (end - pos) < 2 ) {
+                rec_ret = ICM20948_RET_INV_CONFIG;
+            }
+            else {
+                size = 2u + buf[pos + 1];
+
+                if( size > (end - pos) ) {
+                    rec_ret = ICM20948_RET_INV_CONFIG;
+                }
+                else if( (tag == 0) || (tag > ICM20948_BLOB_LAST_TAG) ) {
+                    // Unknown record from a newer writer, skip it
+                }
+                else if( buf[pos + 1] != rec_size[tag] ) {
+                    rec_ret = ICM20948_RET_INV_CONFIG;
+                }
+                else {
+                    rec_ret = _unpack_rec(&buf[pos + 2], &out, (icm20948_blob_tag_t)tag);
+                    out.present |= ICM20948_BLOB_HAS(tag);
+                }
+            }
+
+            if( rec_ret == ICM20948_RET_OK ) {
+                crc = _crc32(crc, &buf[pos], size);
+                pos += size;
+            }
+        }
+
+        // A malformed record is usually corruption, so finish the CRC to report it as such
+        crc = _crc32(crc, &buf[pos], end - pos);
+
+        if( (crc ^ 0xFFFFFFFF) != _get_u32(&buf[8]) ) {
+            ret = ICM20948_RET_GEN_FAIL;
+        }
+        else {
+            ret = rec_ret;
+        }
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        memcpy(blob, &out, sizeof(out));
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API parses a blob and configures the device from it
+ */
+icm20948_return_code_t icm20948_blobApply(const uint8_t *buf, uint32_t len, icm20948_blob_t *blob) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    icm20948_blob_t local;
+
+    if( blob == NULL ) {
+        blob = &local;
+    }
+
+    ret = icm20948_blobParse(buf, len, blob);
+
+    if( (ret == ICM20948_RET_OK) && (blob->present & ICM20948_BLOB_HAS(ICM20948_BLOB_SETTINGS)) ) {
+        ret = icm20948_setSampleRateDiv(blob->gyro_div, blob->accel_div);
+
+        if( ret == ICM20948_RET_OK ) {
+            // Registers left at their reset value, such as dividers of 0, aren't written
+            ret = icm20948_applySettingsFromReset(&blob->settings);
+        }
+    }
+
+    // The gyro user offsets reset to 0, so a zero record needs no bus traffic
+    if( (ret == ICM20948_RET_OK) && (blob->present & ICM20948_BLOB_HAS(ICM20948_BLOB_GYRO_OFFS)) &&
+        ((blob->gyro_offs[0] != 0) || (blob->gyro_offs[1] != 0) || (blob->gyro_offs[2] != 0)) ) {
+        ret = icm20948_setGyroOffsets(blob->gyro_offs);
+    }
+
+    // The accel offsets reset to the factory trim rather than a fixed value, so they are
+    // compared against what the chip holds and only differing axes are written
+    if( (ret == ICM20948_RET_OK) && (blob->present & ICM20948_BLOB_HAS(ICM20948_BLOB_ACCEL_OFFS)) ) {
+        ret = icm20948_setAccelOffsets(blob->accel_offs);
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API corrects a block of scaled samples in place
+ */
+icm20948_return_code_t icm20948_blobCorrect(const icm20948_cal_t *cal, const icm20948_temp_model_t *temp, float temp_c, icm20948_fblock_t *block) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    float tb[3] = { 0.0f, 0.0f, 0.0f };
+
+    if( (block == NULL) || (block->x == NULL) || (block->y == NULL) || (block->z == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( temp != NULL ) {
+        // The temperature is constant across a block, so evaluate the model once
+        float dt = temp_c - temp->t0;
+        for( uint8_t a = 0; a < 3; a++ ) {
+            tb[a] = temp->c[a][0] + (dt * (temp->c[a][1] + (dt * temp->c[a][2])));
+        }
+    }
+
+    for( uint32_t i = 0; (ret == ICM20948_RET_OK) && (i < block->len); i++ ) {
+        float v[3] = { block->x[i] - tb[0], block->y[i] - tb[1], block->z[i] - tb[2] };
+
+        if( cal != NULL ) {
+            float w[3] = { v[0] - cal->bias[0], v[1] - cal->bias[1], v[2] - cal->bias[2] };
+            for( uint8_t a = 0; a < 3; a++ ) {
+                v[a] = (cal->m[a][0] * w[0]) + (cal->m[a][1] * w[1]) + (cal->m[a][2] * w[2]);
+            }
+        }
+
+        block->x[i] = v[0];
+        block->y[i] = v[1];
+        block->z[i] = v[2];
+    }
+
+    return ret;
+}
@@ -0,0 +1,187 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_deadband.c
+ * @brief Source file for the ICM20948 change-threshold (deadband) reporting.
+ */
+
+#include <stddef.h>
+#include <math.h>
+#include "icm20948_deadband.h"
+#include "icm20948_math.h"
+
+/*!
+ * @brief This API decides whether the current sample is reported and updates the counts
+ *
+ * @param[in] db: Pointer to the filter
+ * @param[in] changed: True if the sample moved past the threshold
+ *
+ * @return Returns true if the sample is reported
+ */
+static bool _deadband_step(icm20948_deadband_t *db, bool changed) {
+    const bool report = !db->primed || changed ||
+                        ((db->cfg.max_interval != 0) && (db->since + 1 >= db->cfg.max_interval));
+
+    if( report ) {
+        db->reported++;
+        db->primed = true;
+    }
+    else {
+        db->suppressed++;
+        db->since++;
+    }
+
+    return report;
+}
+
+/*!
+ * @brief This API initializes a deadband filter
+ */
+icm20948_return_code_t icm20948_deadbandInit(icm20948_deadband_t *db, const icm20948_deadband_cfg_t *cfg) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (db == NULL) || (cfg == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( !(cfg->threshold >= 0.0f) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        db->cfg = *cfg;
+        db->dist_sq = cfg->threshold * cfg->threshold;
+        // Angles past pi are never reached, |dot| covers both quaternion signs
+        db->half_cos = (cfg->threshold < ICM20948_PI) ? cosf(0.5f * cfg->threshold) : 0.0f;
+        db->last[0] = db->last[1] = db->last[2] = db->last[3] = 0.0f;
+        db->primed = false;
+        db->since = 0;
+        db->reported = 0;
+        db->suppressed = 0;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API filters a block of 3-axis samples
+ */
+icm20948_return_code_t icm20948_deadbandProcess(icm20948_deadband_t *db, const icm20948_fblock_t *in, icm20948_fblock_t *out, uint32_t *gap) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint32_t n = 0;
+
+    if( (db == NULL) || (in == NULL) || (out == NULL) ||
+        (in->x == NULL) || (in->y == NULL) || (in->z == NULL) ||
+        (out->x == NULL) || (out->y == NULL) || (out->z == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( out->len < in->len ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    for( uint32_t i = 0; (ret == ICM20948_RET_OK) && (i < in->len); i++ ) {
+        const float x = in->x[i];
+        const float y = in->y[i];
+        const float z = in->z[i];
+        const float dx = x - db->last[0];
+        const float dy = y - db->last[1];
+        const float dz = z - db->last[2];
+
+        if( _deadband_step(db, (dx * dx + dy * dy + dz * dz) > db->dist_sq) ) {
+            // n never passes i, so compacting in place is safe
+            out->x[n] = x;
+            out->y[n] = y;
+            out->z[n] = z;
+            if( gap != NULL ) {
+                gap[n] = db->since;
+            }
+            db->last[0] = x;
+            db->last[1] = y;
+            db->last[2] = z;
+            db->since = 0;
+            n++;
+        }
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        out->len = n;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API filters a block of orientations
+ */
+icm20948_return_code_t icm20948_deadbandProcessQuat(icm20948_deadband_t *db, const icm20948_quat_t *in, uint32_t len, icm20948_quat_t *out, uint32_t *gap, uint32_t *count) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint32_t n = 0;
+
+    if( (db == NULL) || (in == NULL) || (out == NULL) || (count == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    for( uint32_t i = 0; (ret == ICM20948_RET_OK) && (i < len); i++ ) {
+        const icm20948_quat_t q = in[i];
+        const float dot = q.w * db->last[0] + q.x * db->last[1] + q.y * db->last[2] + q.z * db->last[3];
+
+        // The rotation between the two has angle 2 * acos(|dot|)
+        if( _deadband_step(db, fabsf(dot) < db->half_cos) ) {
+            out[n] = q;
+            if( gap != NULL ) {
+                gap[n] = db->since;
+            }
+            db->last[0] = q.w;
+            db->last[1] = q.x;
+            db->last[2] = q.y;
+            db->last[3] = q.z;
+            db->since = 0;
+            n++;
+        }
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        *count = n;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API retrieves the number of samples reported and suppressed so far
+ */
+icm20948_return_code_t icm20948_deadbandGetCounts(const icm20948_deadband_t *db, uint64_t *reported, uint64_t *suppressed) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (db == NULL) || (reported == NULL) || (suppressed == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        *reported = db->reported;
+        *suppressed = db->suppressed;
+    }
+
+    return ret;
+}
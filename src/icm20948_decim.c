@@ -0,0 +1,173 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_decim.c
+ * @brief Source file for the ICM20948 oversample-and-decimate stage.
+ */
+
+#include <string.h>
+#include <math.h>
+#include "icm20948_decim.h"
+
+/*!
+ * @brief This API runs one axis of a block through the integrator and comb sections
+ *
+ * @param[in] dec: Pointer to the decimator
+ * @param[in] axis: Axis index being processed
+ * @param[in] in: Pointer to the raw axis samples
+ * @param[in] len: Number of raw samples
+ * @param[out] out: Pointer to where the decimated samples should be placed
+ */
+static void _decim_axis(icm20948_decim_t *dec, uint8_t axis, const int16_t *in, uint32_t len, int32_t *out) {
+    uint32_t *integ = dec->integ[axis];
+    uint32_t *comb = dec->comb[axis];
+    const uint8_t order = dec->cfg.order;
+    const uint32_t rate = (uint32_t)1 << dec->cfg.rate_log2;
+    // The CIC gain is R^N, shift what is left of the 16 fractional bits back in
+    const uint8_t shift = (uint8_t)(ICM20948_DECIM_OUT_FRAC_BITS - (order * dec->cfg.rate_log2));
+    uint32_t phase = dec->phase;
+    uint32_t k = 0;
+
+    for( uint32_t i = 0; i < len; i++ ) {
+        // Integrators wrap modulo 2^32, which the combs undo exactly as long as
+        // the true output fits in 32 bits
+        uint32_t v = (uint32_t)(int32_t)in[i];
+        for( uint8_t s = 0; s < order; s++ ) {
+            integ[s] += v;
+            v = integ[s];
+        }
+
+        if( ++phase == rate ) {
+            phase = 0;
+            for( uint8_t s = 0; s < order; s++ ) {
+                const uint32_t prev = comb[s];
+                comb[s] = v;
+                v -= prev;
+            }
+            out[k++] = (int32_t)(v << shift);
+        }
+    }
+}
+
+/*!
+ * @brief This API computes n choose k as a double
+ *
+ * @param[in] n: Size of the set
+ * @param[in] k: Size of the subset
+ *
+ * @return Returns the binomial coefficient
+ */
+static double _decim_binomial(uint32_t n, uint32_t k) {
+    double c = 1.0;
+
+    for( uint32_t i = 1; i <= k; i++ ) {
+        c = (c * (double)(n - k + i)) / (double)i;
+    }
+
+    return c;
+}
+
+/*!
+ * @brief This API initializes a decimator with the given configuration
+ */
+icm20948_return_code_t icm20948_decimInit(icm20948_decim_t *dec, const icm20948_decim_cfg_t *cfg) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (dec == NULL) || (cfg == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (cfg->order == 0) || (cfg->order > ICM20948_DECIM_MAX_ORDER) ||
+             (cfg->rate_log2 == 0) || ((cfg->order * cfg->rate_log2) > ICM20948_DECIM_OUT_FRAC_BITS) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        memset(dec, 0x00, sizeof(icm20948_decim_t));
+        memcpy(&dec->cfg, cfg, sizeof(icm20948_decim_cfg_t));
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API passes a block of raw samples through the decimator
+ */
+icm20948_return_code_t icm20948_decimProcess(icm20948_decim_t *dec, const icm20948_block_t *in, icm20948_block32_t *out) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint32_t produced = 0;
+
+    if( (dec == NULL) || (in == NULL) || (out == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (in->len != 0) && ((in->x == NULL) || (in->y == NULL) || (in->z == NULL) ||
+             (out->x == NULL) || (out->y == NULL) || (out->z == NULL)) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        produced = (uint32_t)(((uint64_t)dec->phase + in->len) >> dec->cfg.rate_log2);
+
+        if( produced > out->len ) {
+            ret = ICM20948_RET_INV_PARAM;
+        }
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        _decim_axis(dec, 0, in->x, in->len, out->x);
+        _decim_axis(dec, 1, in->y, in->len, out->y);
+        _decim_axis(dec, 2, in->z, in->len, out->z);
+
+        dec->phase = (dec->phase + in->len) & (((uint32_t)1 << dec->cfg.rate_log2) - 1);
+        out->len = produced;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API computes the white noise gain of a decimator configuration
+ */
+float icm20948_decimNoiseGain(const icm20948_decim_cfg_t *cfg) {
+    float gain = 0.0f;
+
+    if( (cfg != NULL) && (cfg->order != 0) && (cfg->order <= ICM20948_DECIM_MAX_ORDER) &&
+        (cfg->rate_log2 != 0) && ((cfg->order * cfg->rate_log2) <= ICM20948_DECIM_OUT_FRAC_BITS) ) {
+        const uint32_t n = cfg->order;
+        const uint32_t r = (uint32_t)1 << cfg->rate_log2;
+        const uint32_t k = n * (r - 1);
+        double sum_sq = 0.0;
+
+        // The sum of the squared impulse response taps is the centre coefficient of
+        // ((1 - z^-R) / (1 - z^-1))^2N, which has a closed form by inclusion-exclusion
+        for( uint32_t j = 0; (j <= (2 * n)) && ((j * r) <= k); j++ ) {
+            const double term = _decim_binomial(2 * n, j) * _decim_binomial(k - (j * r) + (2 * n) - 1, (2 * n) - 1);
+            sum_sq += (j & 0x01) ? -term : term;
+        }
+
+        gain = (float)(sqrt(sum_sq) / pow((double)r, (double)n));
+    }
+
+    return gain;
+}
@@ -0,0 +1,130 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_derived.c
+ * @brief Source file for the ICM20948 orientation derived outputs.
+ */
+
+#include <stddef.h>
+#include <math.h>
+#include "icm20948_derived.h"
+#include "icm20948_math.h"
+
+/*!
+ * @brief This API computes the derived outputs for a batch of samples
+ */
+icm20948_return_code_t icm20948_derivedProcess(const icm20948_derived_cfg_t *cfg, const icm20948_quat_t *q, const icm20948_fblock_t *accel, const icm20948_fblock_t *mag, icm20948_derived_out_t *out) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    bool want_gravity = false;
+    bool want_body = false;
+    bool want_world = false;
+
+    if( (cfg == NULL) || (q == NULL) || (accel == NULL) || (out == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (out->heading != NULL) && ((mag == NULL) || (mag->len != accel->len)) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+    else {
+        want_gravity = (out->gravity.x != NULL);
+        want_body = (out->lin_body.x != NULL);
+        want_world = (out->lin_world.x != NULL);
+
+        if( (want_gravity && (out->gravity.len < accel->len)) ||
+            (want_body && (out->lin_body.len < accel->len)) ||
+            (want_world && (out->lin_world.len < accel->len)) ) {
+            ret = ICM20948_RET_INV_PARAM;
+        }
+    }
+
+    for( uint32_t i = 0; (ret == ICM20948_RET_OK) && (i < accel->len); i++ ) {
+        const icm20948_quat_t p = q[i];
+        // Body to world rotation matrix, built once and shared by every output
+        const float r00 = 1.0f - (2.0f * ((p.y * p.y) + (p.z * p.z)));
+        const float r01 = 2.0f * ((p.x * p.y) - (p.w * p.z));
+        const float r02 = 2.0f * ((p.x * p.z) + (p.w * p.y));
+        const float r10 = 2.0f * ((p.x * p.y) + (p.w * p.z));
+        const float r11 = 1.0f - (2.0f * ((p.x * p.x) + (p.z * p.z)));
+        const float r12 = 2.0f * ((p.y * p.z) - (p.w * p.x));
+        const float r20 = 2.0f * ((p.x * p.z) - (p.w * p.y));
+        const float r21 = 2.0f * ((p.y * p.z) + (p.w * p.x));
+        const float r22 = 1.0f - (2.0f * ((p.x * p.x) + (p.y * p.y)));
+        const float ax = accel->x[i];
+        const float ay = accel->y[i];
+        const float az = accel->z[i];
+
+        // World up seen from the body is the bottom row of the matrix
+        const float gx = r20 * cfg->gravity;
+        const float gy = r21 * cfg->gravity;
+        const float gz = r22 * cfg->gravity;
+
+        if( want_gravity ) {
+            out->gravity.x[i] = gx;
+            out->gravity.y[i] = gy;
+            out->gravity.z[i] = gz;
+        }
+
+        if( want_body ) {
+            out->lin_body.x[i] = ax - gx;
+            out->lin_body.y[i] = ay - gy;
+            out->lin_body.z[i] = az - gz;
+        }
+
+        if( want_world ) {
+            out->lin_world.x[i] = (r00 * ax) + (r01 * ay) + (r02 * az);
+            out->lin_world.y[i] = (r10 * ax) + (r11 * ay) + (r12 * az);
+            out->lin_world.z[i] = ((r20 * ax) + (r21 * ay) + (r22 * az)) - cfg->gravity;
+        }
+
+        if( out->heading != NULL ) {
+            // Bearing of the horizontal field in the world frame, less the estimate's
+            // own yaw, leaves the heading from tilt alone
+            const float mx = (r00 * mag->x[i]) + (r01 * mag->y[i]) + (r02 * mag->z[i]);
+            const float my = (r10 * mag->x[i]) + (r11 * mag->y[i]) + (r12 * mag->z[i]);
+            const float yaw = atan2f(r10, r00);
+            float heading = ((atan2f(my, mx) - yaw) * ICM20948_RAD_TO_DEG) + cfg->declination;
+
+            heading = fmodf(heading, 360.0f);
+            if( heading < 0.0f ) {
+                heading += 360.0f;
+            }
+            out->heading[i] = heading;
+        }
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        if( want_gravity ) {
+            out->gravity.len = accel->len;
+        }
+        if( want_body ) {
+            out->lin_body.len = accel->len;
+        }
+        if( want_world ) {
+            out->lin_world.len = accel->len;
+        }
+    }
+
+    return ret;
+}
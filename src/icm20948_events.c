@@ -0,0 +1,283 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_events.c
+ * @brief Source file for the ICM20948 motion event detectors.
+ */
+
+#include <string.h>
+#include <math.h>
+#include "icm20948_events.h"
+#include "icm20948_atomic.h"
+
+/*!
+ * @brief This API reports one event through the configured callback
+ *
+ * @param[in] det: Pointer to the detector
+ * @param[in] type: Type of event
+ * @param[in] ts: Timestamp of the event
+ * @param[in] axis: Dominant axis
+ * @param[in] sign: Direction along the dominant axis
+ * @param[in] peak: Event peak value
+ */
+static void _events_emit(icm20948_events_t *det, icm20948_event_type_t type, uint64_t ts, uint8_t axis, int8_t sign, float peak) {
+    icm20948_event_t ev;
+
+    if( det->cfg.cb != NULL ) {
+        ev.type = type;
+        ev.timestamp_us = ts;
+        ev.axis = axis;
+        ev.sign = sign;
+        ev.peak = peak;
+        det->cfg.cb(&ev, det->cfg.ctx);
+    }
+}
+
+/*!
+ * @brief This API finds the axis with the largest absolute value
+ *
+ * @param[in] v: Pointer to the 3 values
+ * @param[out] axis: Index of the dominant axis
+ * @param[out] sign: Sign along the dominant axis
+ *
+ * @return Returns the absolute value on the dominant axis
+ */
+static float _events_dominant(const float v[3], uint8_t *axis, int8_t *sign) {
+    uint8_t best = 0;
+
+    for( uint8_t i = 1; i < 3; i++ ) {
+        if( fabsf(v[i]) > fabsf(v[best]) ) {
+            best = i;
+        }
+    }
+    *axis = best;
+    *sign = (v[best] < 0.0f) ? -1 : 1;
+
+    return fabsf(v[best]);
+}
+
+/*!
+ * @brief This API steps the free-fall detector
+ *
+ * @param[in] det: Pointer to the detector
+ * @param[in] mag: Acceleration magnitude, g
+ * @param[in] ts: Timestamp of the sample
+ */
+static void _events_freefall(icm20948_events_t *det, float mag, uint64_t ts) {
+    if( !det->ff_active ) {
+        det->ff_count = (mag < det->cfg.ff_threshold) ? (det->ff_count + 1) : 0;
+        det->ff_active = (det->ff_count >= det->cfg.ff_min_samples);
+    }
+    else if( mag < (det->cfg.ff_threshold + det->cfg.hysteresis) ) {
+        det->ff_count++;
+    }
+    else {
+        // Report on landing so the duration, and with it the drop height, is known
+        _events_emit(det, ICM20948_EVENT_FREEFALL, ts, 0, 0,
+                     (float)det->ff_count * (float)det->cfg.sample_period_us * 1e-6f);
+        det->ff_active = false;
+        det->ff_count = 0;
+    }
+}
+
+/*!
+ * @brief This API steps the shock detector
+ *
+ * @param[in] det: Pointer to the detector
+ * @param[in] a: Acceleration sample, g
+ * @param[in] mag: Acceleration magnitude, g
+ * @param[in] ts: Timestamp of the sample
+ */
+static void _events_shock(icm20948_events_t *det, const float a[3], float mag, uint64_t ts) {
+    if( det->shock_holdoff > 0 ) {
+        det->shock_holdoff--;
+    }
+    else if( det->shock_active ) {
+        if( mag > det->shock_peak ) {
+            det->shock_peak = mag;
+            (void)_events_dominant(a, &det->shock_axis, &det->shock_sign);
+        }
+        if( mag < (det->cfg.shock_threshold - det->cfg.hysteresis) ) {
+            _events_emit(det, ICM20948_EVENT_SHOCK, ts, det->shock_axis, det->shock_sign, det->shock_peak);
+            det->shock_active = false;
+            det->shock_holdoff = det->cfg.shock_holdoff;
+        }
+    }
+    else if( mag > det->cfg.shock_threshold ) {
+        det->shock_active = true;
+        det->shock_peak = mag;
+        (void)_events_dominant(a, &det->shock_axis, &det->shock_sign);
+    }
+}
+
+/*!
+ * @brief This API steps the tap detector
+ *
+ * @param[in] det: Pointer to the detector
+ * @param[in] d: Sample-to-sample change in acceleration, g
+ * @param[in] ts: Timestamp of the sample
+ */
+static void _events_tap(icm20948_events_t *det, const float d[3], uint64_t ts) {
+    uint8_t axis;
+    int8_t sign;
+    const float jerk = _events_dominant(d, &axis, &sign);
+
+    // A pending single tap expires once the double tap window has passed
+    if( det->tap_pending && ((det->n - det->last_tap) > det->cfg.double_tap_window) ) {
+        det->tap_pending = false;
+    }
+
+    if( det->tap_quiet > 0 ) {
+        det->tap_quiet--;
+    }
+    else if( det->tap_active ) {
+        det->tap_len++;
+        if( jerk > det->tap_peak ) {
+            det->tap_peak = jerk;
+            det->tap_axis = axis;
+            det->tap_sign = sign;
+        }
+        if( det->tap_len > det->cfg.tap_max_samples ) {
+            // Too long for a tap, wait for the motion to settle before re-arming
+            det->tap_active = (jerk >= (det->cfg.tap_threshold - det->cfg.hysteresis));
+        }
+        else if( jerk < (det->cfg.tap_threshold - det->cfg.hysteresis) ) {
+            _events_emit(det, ICM20948_EVENT_TAP, ts, det->tap_axis, det->tap_sign, det->tap_peak);
+            if( det->tap_pending ) {
+                _events_emit(det, ICM20948_EVENT_DOUBLE_TAP, ts, det->tap_axis, det->tap_sign, det->tap_peak);
+            }
+            det->tap_pending = !det->tap_pending;
+            det->last_tap = det->n;
+            det->tap_active = false;
+            det->tap_quiet = det->cfg.tap_quiet_samples;
+        }
+    }
+    else if( jerk > det->cfg.tap_threshold ) {
+        det->tap_active = true;
+        det->tap_len = 1;
+        det->tap_peak = jerk;
+        det->tap_axis = axis;
+        det->tap_sign = sign;
+    }
+}
+
+/*!
+ * @brief This API initializes the event detectors
+ */
+icm20948_return_code_t icm20948_eventsInit(icm20948_events_t *det, const icm20948_events_cfg_t *cfg) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (det == NULL) || (cfg == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (cfg->sample_period_us == 0) || (cfg->hysteresis < 0.0f) ||
+             ((cfg->ff_threshold > 0.0f) && (cfg->ff_min_samples == 0)) ||
+             ((cfg->tap_threshold > 0.0f) && (cfg->tap_max_samples == 0)) ||
+             ((cfg->idle_samples != 0) && (cfg->arm == NULL)) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+    else {
+        memset(det, 0, sizeof(icm20948_events_t));
+        det->cfg = *cfg;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API runs a block of accel samples through the detectors
+ */
+icm20948_return_code_t icm20948_eventsProcess(icm20948_events_t *det, const icm20948_fblock_t *accel, uint64_t t0_us) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (det == NULL) || (accel == NULL) || (accel->x == NULL) || (accel->y == NULL) || (accel->z == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    if( (ret == ICM20948_RET_OK) && (ICM20948_LOAD_ACQUIRE(&det->wake) != 0) ) {
+        // Wakes raised before the flag is cleared are folded into this one
+        ICM20948_STORE_RELAXED(&det->wake, 0u);
+        det->gated = false;
+        det->still = 0;
+        // The signal jumped while gated, so don't take a tap step across the gap
+        det->primed = false;
+        det->tap_active = false;
+        det->tap_pending = false;
+    }
+
+    for( uint32_t i = 0; (ret == ICM20948_RET_OK) && (i < accel->len); i++ ) {
+        const float a[3] = { accel->x[i], accel->y[i], accel->z[i] };
+        const float mag = sqrtf(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+        const uint64_t ts = t0_us + (uint64_t)i * det->cfg.sample_period_us;
+
+        if( det->gated ) {
+            // The remainder of the block predates the wake interrupt
+            break;
+        }
+
+        if( det->cfg.ff_threshold > 0.0f ) {
+            _events_freefall(det, mag, ts);
+        }
+        if( det->cfg.shock_threshold > 0.0f ) {
+            _events_shock(det, a, mag, ts);
+        }
+        if( (det->cfg.tap_threshold > 0.0f) && det->primed ) {
+            const float d[3] = { a[0] - det->prev[0], a[1] - det->prev[1], a[2] - det->prev[2] };
+            _events_tap(det, d, ts);
+        }
+
+        if( det->cfg.idle_samples != 0 ) {
+            det->still = (fabsf(mag - 1.0f) <= det->cfg.idle_tolerance) ? (det->still + 1) : 0;
+            if( det->still >= det->cfg.idle_samples ) {
+                ret = det->cfg.arm(det->cfg.ctx);
+                det->gated = (ret == ICM20948_RET_OK);
+                det->still = 0;
+            }
+        }
+
+        memcpy(det->prev, a, sizeof(det->prev));
+        det->primed = true;
+        det->n++;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API releases the detector from wake-on-motion gating
+ */
+void icm20948_eventsWake(icm20948_events_t *det) {
+    if( det != NULL ) {
+        // Only the flag is touched here, the detector state belongs to the processing context
+        ICM20948_STORE_RELEASE(&det->wake, 1u);
+    }
+}
+
+/*!
+ * @brief This API checks whether the detector is gated waiting for wake-on-motion
+ */
+bool icm20948_eventsGated(const icm20948_events_t *det) {
+    return (det != NULL) && det->gated && (ICM20948_LOAD_ACQUIRE(&det->wake) == 0);
+}
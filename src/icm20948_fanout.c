@@ -0,0 +1,331 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_fanout.c
+ * @brief Source file for the ICM20948 single producer, multi subscriber fan out ring.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "icm20948_fanout.h"
+#include "icm20948_atomic.h"
+
+/*!
+ * @brief This API looks up an active subscriber
+ *
+ * @param[in] f: Pointer to the ring
+ * @param[in] id: Subscriber id
+ *
+ * @return Returns the subscriber, NULL if the id is not in use
+ */
+static icm20948_fanout_sub_t *_fanout_sub(const icm20948_fanout_t *f, uint8_t id) {
+    icm20948_fanout_sub_t *sub = NULL;
+
+    if( (f != NULL) && (id < ICM20948_FANOUT_MAX_SUBS) && f->subs[id].active ) {
+        sub = (icm20948_fanout_sub_t *)&f->subs[id];
+    }
+
+    return sub;
+}
+
+/*!
+ * @brief This API initializes a fan out ring over caller storage
+ */
+icm20948_return_code_t icm20948_fanoutInit(icm20948_fanout_t *f, void *buf, uint32_t elem_size, uint32_t capacity) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (f == NULL) || (buf == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (elem_size == 0) || (capacity == 0) || (capacity > (1u << 30)) || ((capacity & (capacity - 1)) != 0) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        memset(f, 0, sizeof(icm20948_fanout_t));
+        f->buf = (uint8_t *)buf;
+        f->elem_size = elem_size;
+        f->mask = capacity - 1;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API adds a subscriber
+ */
+icm20948_return_code_t icm20948_fanoutSubscribe(icm20948_fanout_t *f, icm20948_fanout_policy_t policy, uint32_t decimate, uint8_t *id) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint8_t slot = ICM20948_FANOUT_MAX_SUBS;
+
+    if( (f == NULL) || (id == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (policy > ICM20948_FANOUT_DECIMATE) || ((policy == ICM20948_FANOUT_DECIMATE) && (decimate == 0)) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    for( uint8_t i = 0; (ret == ICM20948_RET_OK) && (i < ICM20948_FANOUT_MAX_SUBS) && (slot == ICM20948_FANOUT_MAX_SUBS); i++ ) {
+        slot = f->subs[i].active ? slot : i;
+    }
+
+    if( (ret == ICM20948_RET_OK) && (slot == ICM20948_FANOUT_MAX_SUBS) ) {
+        ret = ICM20948_RET_INV_CONFIG;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        icm20948_fanout_sub_t *sub = &f->subs[slot];
+        const uint32_t head = ICM20948_LOAD_ACQUIRE(&f->head);
+
+        memset(sub, 0, sizeof(icm20948_fanout_sub_t));
+        sub->policy = policy;
+        sub->decimate = (policy == ICM20948_FANOUT_DECIMATE) ? decimate : 1;
+        sub->tail = head;
+        sub->peeked = head;
+        ICM20948_STORE_RELEASE(&sub->active, true);
+        *id = slot;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API removes a subscriber
+ */
+icm20948_return_code_t icm20948_fanoutUnsubscribe(icm20948_fanout_t *f, uint8_t id) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    icm20948_fanout_sub_t *sub = _fanout_sub(f, id);
+
+    if( sub == NULL ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        ICM20948_STORE_RELEASE(&sub->active, false);
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API reserves room for the producer to write elements in place
+ */
+icm20948_return_code_t icm20948_fanoutReserve(icm20948_fanout_t *f, void **elems, uint32_t *count) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint32_t head = 0;
+    uint32_t free = 0;
+    uint32_t run = 0;
+
+    if( (f == NULL) || (elems == NULL) || (count == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        head = f->head;
+        free = f->mask + 1;
+
+        // Only BLOCK subscribers hold the producer back
+        for( uint8_t i = 0; i < ICM20948_FANOUT_MAX_SUBS; i++ ) {
+            const icm20948_fanout_sub_t *sub = &f->subs[i];
+
+            if( ICM20948_LOAD_ACQUIRE(&sub->active) && (sub->policy == ICM20948_FANOUT_BLOCK) ) {
+                const uint32_t used = head - ICM20948_LOAD_ACQUIRE(&sub->tail);
+                free = ((f->mask + 1 - used) < free) ? (f->mask + 1 - used) : free;
+            }
+        }
+
+        run = (f->mask + 1) - (head & f->mask);
+        run = (run < free) ? run : free;
+
+        // Announce the slots about to be overwritten before touching them, so a
+        // subscriber reading there can tell on release
+        ICM20948_STORE_RELAXED(&f->claim, head + run);
+        ICM20948_FENCE_FULL();
+
+        *elems = &f->buf[(head & f->mask) * f->elem_size];
+        *count = run;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API publishes elements written into a reservation
+ */
+icm20948_return_code_t icm20948_fanoutCommit(icm20948_fanout_t *f, uint32_t count) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( f == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( count > (f->claim - f->head) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        ICM20948_STORE_RELEASE(&f->head, f->head + count);
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API copies elements into the ring and publishes them
+ */
+icm20948_return_code_t icm20948_fanoutPublish(icm20948_fanout_t *f, const void *elems, uint32_t count, uint32_t *accepted) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint32_t done = 0;
+    uint32_t run = 0;
+    void *dst = NULL;
+
+    if( (f == NULL) || (elems == NULL) || (accepted == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    // At most two runs, either side of the wrap
+    while( (ret == ICM20948_RET_OK) && (done < count) ) {
+        ret = icm20948_fanoutReserve(f, &dst, &run);
+
+        if( (ret == ICM20948_RET_OK) && (run == 0) ) {
+            break;
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            run = (run < (count - done)) ? run : (count - done);
+            memcpy(dst, &((const uint8_t *)elems)[done * f->elem_size], run * f->elem_size);
+            ret = icm20948_fanoutCommit(f, run);
+            done += run;
+        }
+    }
+
+    if( accepted != NULL ) {
+        *accepted = done;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API hands a subscriber the next run of elements in place
+ */
+icm20948_return_code_t icm20948_fanoutPeek(icm20948_fanout_t *f, uint8_t id, icm20948_fanout_span_t *span) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    icm20948_fanout_sub_t *sub = _fanout_sub(f, id);
+    const uint32_t capacity = (f != NULL) ? (f->mask + 1) : 0;
+    int32_t lag = 0;
+    uint32_t run = 0;
+
+    if( span == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( sub == NULL ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        // A decimating cursor may sit up to decimate - 1 past the head
+        lag = (int32_t)(ICM20948_LOAD_ACQUIRE(&f->head) - sub->tail);
+
+        if( (sub->policy != ICM20948_FANOUT_BLOCK) && (lag > (int32_t)capacity) ) {
+            uint32_t skip = (uint32_t)lag - capacity;
+            skip = ((skip + sub->decimate - 1) / sub->decimate) * sub->decimate;
+            sub->tail += skip;
+            sub->metrics.dropped += skip;
+            lag -= (int32_t)skip;
+        }
+
+        sub->metrics.lag = (lag > 0) ? (uint32_t)lag : 0;
+        sub->metrics.max_lag = (sub->metrics.lag > sub->metrics.max_lag) ? sub->metrics.lag : sub->metrics.max_lag;
+
+        run = capacity - (sub->tail & f->mask);
+        run = (run < sub->metrics.lag) ? run : sub->metrics.lag;
+
+        sub->peeked = sub->tail;
+        sub->peeked_count = (run + sub->decimate - 1) / sub->decimate;
+        span->data = &f->buf[(sub->tail & f->mask) * f->elem_size];
+        span->count = sub->peeked_count;
+        span->stride = sub->decimate * f->elem_size;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API releases elements a subscriber has finished with
+ */
+icm20948_return_code_t icm20948_fanoutRelease(icm20948_fanout_t *f, uint8_t id, uint32_t count) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    icm20948_fanout_sub_t *sub = _fanout_sub(f, id);
+
+    if( (sub == NULL) || (count > sub->peeked_count) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( (ret == ICM20948_RET_OK) && (sub->policy != ICM20948_FANOUT_BLOCK) ) {
+        // Order the span reads before checking how far the producer has claimed
+        ICM20948_FENCE_ACQUIRE();
+        if( (int32_t)(ICM20948_LOAD_RELAXED(&f->claim) - (f->mask + 1) - sub->peeked) > 0 ) {
+            ret = ICM20948_RET_GEN_FAIL;
+        }
+    }
+
+    if( sub != NULL ) {
+        if( ret == ICM20948_RET_OK ) {
+            sub->metrics.delivered += count;
+        }
+        else if( ret == ICM20948_RET_GEN_FAIL ) {
+            sub->metrics.dropped += count * sub->decimate;
+        }
+
+        if( ret != ICM20948_RET_INV_PARAM ) {
+            sub->peeked_count -= count;
+            sub->peeked += count * sub->decimate;
+            ICM20948_STORE_RELEASE(&sub->tail, sub->peeked);
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API retrieves a subscriber's lag and delivery counters
+ */
+icm20948_return_code_t icm20948_fanoutGetMetrics(const icm20948_fanout_t *f, uint8_t id, icm20948_fanout_metrics_t *metrics) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    const icm20948_fanout_sub_t *sub = _fanout_sub(f, id);
+
+    if( metrics == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( sub == NULL ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        *metrics = sub->metrics;
+    }
+
+    return ret;
+}
@@ -0,0 +1,214 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_health.c
+ * @brief Source file for the ICM20948 sensor health monitor.
+ */
+
+#include <string.h>
+#include "icm20948_health.h"
+
+/*!
+ * @brief This API accumulates one contiguous run of samples for a single axis
+ *
+ * @param[in] mon: Pointer to the health monitor
+ * @param[in] axis: Axis index being accumulated
+ * @param[in] data: Pointer to the axis samples
+ * @param[in] len: Number of samples to accumulate
+ */
+static void _health_sweep(icm20948_health_t *mon, uint8_t axis, const int16_t *data, uint32_t len) {
+    uint32_t spikes = 0;
+    uint32_t run = mon->run[axis];
+    uint32_t max_run = mon->max_run[axis];
+    int32_t prev = mon->primed ? mon->last[axis] : data[0];
+    const int32_t spike_delta = mon->cfg.spike_delta;
+
+    // The first sample's step is taken against the previous block, the rest of
+    // the sweep has no loop carried dependency so the compiler is free to
+    // vectorize it
+    spikes += ((data[0] - prev) > spike_delta) || ((prev - data[0]) > spike_delta);
+    for( uint32_t i = 1; i < len; i++ ) {
+        const int32_t d = (int32_t)data[i] - (int32_t)data[i - 1];
+        spikes += (d > spike_delta) || (-d > spike_delta);
+    }
+
+    // Repeated value runs carry state sample to sample
+    for( uint32_t i = 0; i < len; i++ ) {
+        run = (data[i] == prev) ? (run + 1) : 1;
+        max_run = (run > max_run) ? run : max_run;
+        prev = data[i];
+    }
+
+    mon->spikes[axis] += (mon->cfg.spike_delta != 0) ? spikes : 0;
+    mon->run[axis] = run;
+    mon->max_run[axis] = max_run;
+    mon->last[axis] = (int16_t)prev;
+}
+
+/*!
+ * @brief This API steps the hysteresis for one alarm and reports any change in state
+ *
+ * @param[in] mon: Pointer to the health monitor
+ * @param[in] axis: Axis index being evaluated
+ * @param[in] alarm: Alarm being evaluated
+ * @param[in] cond: True if the alarm condition was met in the last window
+ */
+static void _health_hysteresis(icm20948_health_t *mon, uint8_t axis, icm20948_health_alarm_t alarm, bool cond) {
+    const uint8_t mask = (uint8_t)(0x01 << alarm);
+    bool active = (mon->active[axis] & mask) != 0;
+
+    if( cond ) {
+        mon->good[axis][alarm] = 0;
+        if( mon->bad[axis][alarm] < UINT8_MAX ) {
+            mon->bad[axis][alarm]++;
+        }
+
+        if( (active == false) && (mon->bad[axis][alarm] >= mon->cfg.raise_windows) ) {
+            mon->active[axis] |= mask;
+            if( mon->cfg.cb != NULL ) {
+                mon->cfg.cb(axis, alarm, true, mon->cfg.ctx);
+            }
+        }
+    }
+    else {
+        mon->bad[axis][alarm] = 0;
+        if( mon->good[axis][alarm] < UINT8_MAX ) {
+            mon->good[axis][alarm]++;
+        }
+
+        if( active && (mon->good[axis][alarm] >= mon->cfg.clear_windows) ) {
+            mon->active[axis] &= (uint8_t)~mask;
+            if( mon->cfg.cb != NULL ) {
+                mon->cfg.cb(axis, alarm, false, mon->cfg.ctx);
+            }
+        }
+    }
+}
+
+/*!
+ * @brief This API evaluates the alarms at the end of a window and restarts the window
+ *
+ * @param[in] mon: Pointer to the health monitor
+ */
+static void _health_evaluate(icm20948_health_t *mon) {
+    for( uint8_t axis = 0; axis < ICM20948_HEALTH_AXIS_COUNT; axis++ ) {
+        mon->variance[axis] = (float)icm20948_statsVariance(&mon->stats, axis);
+
+        _health_hysteresis(mon, axis, ICM20948_HEALTH_ALARM_STUCK,
+            (mon->cfg.stuck_run != 0) && (mon->max_run[axis] >= mon->cfg.stuck_run));
+        _health_hysteresis(mon, axis, ICM20948_HEALTH_ALARM_NOISE_LOW,
+            mon->variance[axis] < mon->cfg.var_min);
+        _health_hysteresis(mon, axis, ICM20948_HEALTH_ALARM_NOISE_HIGH,
+            (mon->cfg.var_max > 0.0f) && (mon->variance[axis] > mon->cfg.var_max));
+        _health_hysteresis(mon, axis, ICM20948_HEALTH_ALARM_SPIKES,
+            mon->spikes[axis] > mon->cfg.spike_max);
+
+        mon->spikes[axis] = 0;
+        // Carry the current run over so a sensor that stays stuck keeps reporting it
+        mon->max_run[axis] = mon->run[axis];
+    }
+
+    icm20948_statsReset(&mon->stats);
+}
+
+/*!
+ * @brief This API initializes a health monitor with the given configuration
+ */
+icm20948_return_code_t icm20948_healthInit(icm20948_health_t *mon, const icm20948_health_cfg_t *cfg) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (mon == NULL) || (cfg == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (cfg->window == 0) || (cfg->raise_windows == 0) || (cfg->clear_windows == 0) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        memset(mon, 0x00, sizeof(icm20948_health_t));
+        memcpy(&mon->cfg, cfg, sizeof(icm20948_health_cfg_t));
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API feeds a block of raw samples through the health monitor
+ */
+icm20948_return_code_t icm20948_healthProcess(icm20948_health_t *mon, const icm20948_block_t *block) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint32_t offset = 0;
+
+    if( (mon == NULL) || (block == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (block->len != 0) && ((block->x == NULL) || (block->y == NULL) || (block->z == NULL)) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    while( (ret == ICM20948_RET_OK) && (offset < block->len) ) {
+        // Never let a sweep cross a window boundary
+        uint32_t chunk = block->len - offset;
+        if( chunk > (mon->cfg.window - (uint32_t)mon->stats.n) ) {
+            chunk = mon->cfg.window - (uint32_t)mon->stats.n;
+        }
+
+        icm20948_block_t sub = {
+            .x = &block->x[offset],
+            .y = &block->y[offset],
+            .z = &block->z[offset],
+            .len = chunk
+        };
+        ret = icm20948_statsAddBlock(&mon->stats, &sub);
+
+        // Partial statistics must never reach a verdict
+        if( ret == ICM20948_RET_OK ) {
+            _health_sweep(mon, 0, &block->x[offset], chunk);
+            _health_sweep(mon, 1, &block->y[offset], chunk);
+            _health_sweep(mon, 2, &block->z[offset], chunk);
+            mon->primed = true;
+            offset += chunk;
+
+            if( mon->stats.n == mon->cfg.window ) {
+                _health_evaluate(mon);
+            }
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API retrieves the currently active alarms for an axis
+ */
+uint8_t icm20948_healthGetAlarms(const icm20948_health_t *mon, uint8_t axis) {
+    uint8_t alarms = 0x00;
+
+    if( (mon != NULL) && (axis < ICM20948_HEALTH_AXIS_COUNT) ) {
+        alarms = mon->active[axis];
+    }
+
+    return alarms;
+}
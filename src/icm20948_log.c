@@ -0,0 +1,306 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_log.c
+ * @brief Source file for the ICM20948 binary sample log format.
+ */
+
+#include <string.h>
+#include "icm20948_log.h"
+
+/*!
+ * @brief This API packs one axis triplet into a frame as little endian int16
+ *
+ * @param[out] dst: Pointer to the frame bytes to write
+ * @param[in] block: Pointer to the block holding the sample
+ * @param[in] i: Index of the sample in the block
+ */
+static void _log_pack(uint8_t *dst, const icm20948_block_t *block, uint32_t i) {
+    dst[0] = (uint8_t)((uint16_t)block->x[i] & 0xFF);
+    dst[1] = (uint8_t)((uint16_t)block->x[i] >> 8);
+    dst[2] = (uint8_t)((uint16_t)block->y[i] & 0xFF);
+    dst[3] = (uint8_t)((uint16_t)block->y[i] >> 8);
+    dst[4] = (uint8_t)((uint16_t)block->z[i] & 0xFF);
+    dst[5] = (uint8_t)((uint16_t)block->z[i] >> 8);
+}
+
+/*!
+ * @brief This API unpacks one little endian axis triplet from a frame
+ *
+ * @param[in] src: Pointer to the frame bytes to read
+ * @param[out] block: Pointer to the block receiving the sample
+ * @param[in] i: Index of the sample in the block
+ */
+static void _log_unpack(const uint8_t *src, icm20948_block_t *block, uint32_t i) {
+    block->x[i] = (int16_t)(((uint16_t)src[1] << 8) | src[0]);
+    block->y[i] = (int16_t)(((uint16_t)src[3] << 8) | src[2]);
+    block->z[i] = (int16_t)(((uint16_t)src[5] << 8) | src[4]);
+}
+
+/*!
+ * @brief This API computes the size of one frame for the given header
+ */
+uint32_t icm20948_logFrameSize(const icm20948_log_header_t *hdr) {
+    uint32_t size = 0;
+
+    if( hdr != NULL ) {
+        size += (hdr->channels & ICM20948_LOG_CH_ACCEL) ? 6 : 0;
+        size += (hdr->channels & ICM20948_LOG_CH_GYRO) ? 6 : 0;
+        size += (hdr->channels & ICM20948_LOG_CH_QUAT) ? icm20948_quatEncodedSize(hdr->quat_enc) : 0;
+    }
+
+    return size;
+}
+
+/*!
+ * @brief This API initializes a log writer and writes out the log header
+ */
+icm20948_return_code_t icm20948_logWriterInit(icm20948_log_writer_t *w, const icm20948_log_header_t *hdr, icm20948_log_write_fptr_t write, void *ctx) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint8_t buf[ICM20948_LOG_HEADER_SIZE];
+
+    if( (w == NULL) || (hdr == NULL) || (write == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (icm20948_logFrameSize(hdr) == 0) ||
+             ((hdr->channels & ICM20948_LOG_CH_QUAT) && (icm20948_quatEncodedSize(hdr->quat_enc) == 0)) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        memcpy(&w->hdr, hdr, sizeof(icm20948_log_header_t));
+        w->write = write;
+        w->ctx = ctx;
+        w->frames = 0;
+
+        memset(buf, 0x00, sizeof(buf));
+        buf[0] = (uint8_t)(ICM20948_LOG_MAGIC & 0xFF);
+        buf[1] = (uint8_t)((ICM20948_LOG_MAGIC >> 8) & 0xFF);
+        buf[2] = (uint8_t)((ICM20948_LOG_MAGIC >> 16) & 0xFF);
+        buf[3] = (uint8_t)((ICM20948_LOG_MAGIC >> 24) & 0xFF);
+        buf[4] = ICM20948_LOG_VERSION;
+        buf[5] = hdr->channels;
+        buf[6] = (hdr->channels & ICM20948_LOG_CH_QUAT) ? (uint8_t)hdr->quat_enc : 0;
+        buf[8] = (uint8_t)(hdr->sample_period_us & 0xFF);
+        buf[9] = (uint8_t)((hdr->sample_period_us >> 8) & 0xFF);
+        buf[10] = (uint8_t)((hdr->sample_period_us >> 16) & 0xFF);
+        buf[11] = (uint8_t)((hdr->sample_period_us >> 24) & 0xFF);
+        buf[12] = (uint8_t)hdr->accel_fs;
+        buf[13] = (uint8_t)hdr->gyro_fs;
+
+        ret = w->write(w->ctx, buf, sizeof(buf));
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API appends raw sample blocks to the log
+ */
+icm20948_return_code_t icm20948_logWrite(icm20948_log_writer_t *w, const icm20948_block_t *accel, const icm20948_block_t *gyro) {
+    return icm20948_logWriteFrames(w, accel, gyro, NULL, 0);
+}
+
+/*!
+ * @brief This API appends raw sample blocks and orientations to the log
+ */
+icm20948_return_code_t icm20948_logWriteFrames(icm20948_log_writer_t *w, const icm20948_block_t *accel, const icm20948_block_t *gyro, const icm20948_quat_t *quat, uint32_t count) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint8_t buf[ICM20948_LOG_CHUNK_FRAMES * ICM20948_LOG_MAX_FRAME_SIZE];
+    uint32_t frame_size = 0;
+    bool accel_en = false;
+    bool gyro_en = false;
+    bool quat_en = false;
+
+    if( w == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else {
+        accel_en = (w->hdr.channels & ICM20948_LOG_CH_ACCEL) != 0;
+        gyro_en = (w->hdr.channels & ICM20948_LOG_CH_GYRO) != 0;
+        quat_en = (w->hdr.channels & ICM20948_LOG_CH_QUAT) != 0;
+        frame_size = icm20948_logFrameSize(&w->hdr);
+
+        if( (accel_en && (accel == NULL)) || (gyro_en && (gyro == NULL)) || (quat_en && (quat == NULL)) ) {
+            ret = ICM20948_RET_NULL_PTR;
+        }
+        else {
+            count = accel_en ? accel->len : (gyro_en ? gyro->len : count);
+
+            if( (accel_en && gyro_en && (accel->len != gyro->len)) || (!quat_en && !accel_en && !gyro_en) ) {
+                ret = ICM20948_RET_INV_PARAM;
+            }
+        }
+    }
+
+    for( uint32_t done = 0; (ret == ICM20948_RET_OK) && (done < count); ) {
+        uint32_t chunk = count - done;
+        if( chunk > ICM20948_LOG_CHUNK_FRAMES ) {
+            chunk = ICM20948_LOG_CHUNK_FRAMES;
+        }
+
+        // Interleave the blocks into frames, then hand the chunk off in one write
+        for( uint32_t i = 0; (ret == ICM20948_RET_OK) && (i < chunk); i++ ) {
+            uint8_t *frame = &buf[i * frame_size];
+
+            if( accel_en ) {
+                _log_pack(frame, accel, done + i);
+                frame += 6;
+            }
+            if( gyro_en ) {
+                _log_pack(frame, gyro, done + i);
+                frame += 6;
+            }
+            if( quat_en ) {
+                ret = icm20948_quatEncode(w->hdr.quat_enc, &quat[done + i], 1, frame);
+            }
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            ret = w->write(w->ctx, buf, chunk * frame_size);
+        }
+        if( ret == ICM20948_RET_OK ) {
+            done += chunk;
+            w->frames += chunk;
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API parses and validates a log header
+ */
+icm20948_return_code_t icm20948_logParseHeader(const uint8_t *buf, uint32_t len, icm20948_log_header_t *hdr) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (buf == NULL) || (hdr == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( len < ICM20948_LOG_HEADER_SIZE ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+    else {
+        uint32_t magic = (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+
+        if( (magic != ICM20948_LOG_MAGIC) || (buf[4] == 0) || (buf[4] > ICM20948_LOG_VERSION) ) {
+            ret = ICM20948_RET_INV_PARAM;
+        }
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        hdr->channels = buf[5];
+        hdr->sample_period_us = (uint32_t)buf[8] | ((uint32_t)buf[9] << 8) | ((uint32_t)buf[10] << 16) | ((uint32_t)buf[11] << 24);
+        hdr->accel_fs = (icm20948_accel_full_scale_select_t)buf[12];
+        hdr->gyro_fs = (icm20948_gyro_full_scale_select_t)buf[13];
+        hdr->quat_enc = (icm20948_quat_enc_t)buf[6];
+
+        // Unknown channel bits would leave frames the size computation doesn't account for
+        if( (hdr->channels & ~(ICM20948_LOG_CH_ACCEL | ICM20948_LOG_CH_GYRO | ICM20948_LOG_CH_QUAT)) ||
+            (icm20948_logFrameSize(hdr) == 0) || (buf[12] > ICM20948_ACCEL_FS_SEL_16G) || (buf[13] > ICM20948_GYRO_FS_SEL_2000DPS) ||
+            ((buf[4] < 2) && (hdr->channels & ICM20948_LOG_CH_QUAT)) ||
+            ((hdr->channels & ICM20948_LOG_CH_QUAT) && (icm20948_quatEncodedSize(hdr->quat_enc) == 0)) ) {
+            ret = ICM20948_RET_INV_PARAM;
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API unpacks frames into raw sample blocks
+ */
+icm20948_return_code_t icm20948_logUnpack(const icm20948_log_header_t *hdr, const uint8_t *frames, uint32_t count, icm20948_block_t *accel, icm20948_block_t *gyro) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint32_t frame_size = 0;
+    bool accel_en = false;
+    bool gyro_en = false;
+
+    if( (hdr == NULL) || (frames == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else {
+        frame_size = icm20948_logFrameSize(hdr);
+        accel_en = ((hdr->channels & ICM20948_LOG_CH_ACCEL) != 0) && (accel != NULL);
+        gyro_en = ((hdr->channels & ICM20948_LOG_CH_GYRO) != 0) && (gyro != NULL);
+
+        if( (accel_en && (accel->len < count)) || (gyro_en && (gyro->len < count)) ) {
+            ret = ICM20948_RET_INV_PARAM;
+        }
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        // Accel, when present, always leads the frame
+        const uint32_t gyro_offset = (hdr->channels & ICM20948_LOG_CH_ACCEL) ? 6 : 0;
+
+        for( uint32_t i = 0; i < count; i++ ) {
+            const uint8_t *frame = &frames[i * frame_size];
+
+            if( accel_en ) {
+                _log_unpack(frame, accel, i);
+            }
+            if( gyro_en ) {
+                _log_unpack(&frame[gyro_offset], gyro, i);
+            }
+        }
+
+        if( accel_en ) {
+            accel->len = count;
+        }
+        if( gyro_en ) {
+            gyro->len = count;
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API decodes the orientations out of frames
+ */
+icm20948_return_code_t icm20948_logUnpackQuat(const icm20948_log_header_t *hdr, const uint8_t *frames, uint32_t count, icm20948_quat_t *quat) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint32_t frame_size = 0;
+    uint32_t offset = 0;
+
+    if( (hdr == NULL) || (frames == NULL) || (quat == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (hdr->channels & ICM20948_LOG_CH_QUAT) == 0 ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        // The orientation trails the raw channels
+        frame_size = icm20948_logFrameSize(hdr);
+        offset = frame_size - icm20948_quatEncodedSize(hdr->quat_enc);
+    }
+
+    for( uint32_t i = 0; (ret == ICM20948_RET_OK) && (i < count); i++ ) {
+        ret = icm20948_quatDecode(hdr->quat_enc, &frames[i * frame_size + offset], 1, &quat[i]);
+    }
+
+    return ret;
+}
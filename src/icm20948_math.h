@@ -0,0 +1,129 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_math.h
+ * @brief Private vector and quaternion helpers shared by the processing stages.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ICM20948_MATH_H_
+#define _ICM20948_MATH_H_
+
+#include <math.h>
+#include "icm20948_api.h"
+
+#define ICM20948_PI                         (3.14159265358979f)
+#define ICM20948_DEG_TO_RAD                 (ICM20948_PI / 180.0f)
+#define ICM20948_RAD_TO_DEG                 (180.0f / ICM20948_PI)
+#define ICM20948_STANDARD_GRAVITY           (9.80665f)
+
+/*! @brief out = a x b, out may not alias a or b */
+static inline void _vec_cross(const float a[3], const float b[3], float out[3]) {
+    out[0] = (a[1] * b[2]) - (a[2] * b[1]);
+    out[1] = (a[2] * b[0]) - (a[0] * b[2]);
+    out[2] = (a[0] * b[1]) - (a[1] * b[0]);
+}
+
+/*! @brief Hamilton product a * b */
+static inline icm20948_quat_t _quat_mul(icm20948_quat_t a, icm20948_quat_t b) {
+    icm20948_quat_t q;
+
+    q.w = (a.w * b.w) - (a.x * b.x) - (a.y * b.y) - (a.z * b.z);
+    q.x = (a.w * b.x) + (a.x * b.w) + (a.y * b.z) - (a.z * b.y);
+    q.y = (a.w * b.y) - (a.x * b.z) + (a.y * b.w) + (a.z * b.x);
+    q.z = (a.w * b.z) + (a.x * b.y) - (a.y * b.x) + (a.z * b.w);
+
+    return q;
+}
+
+/*! @brief Normalizes q, falling back to identity for a degenerate quaternion */
+static inline icm20948_quat_t _quat_normalize(icm20948_quat_t q) {
+    const float n = sqrtf((q.w * q.w) + (q.x * q.x) + (q.y * q.y) + (q.z * q.z));
+    icm20948_quat_t r = { 1.0f, 0.0f, 0.0f, 0.0f };
+
+    if( n > 0.0f ) {
+        r.w = q.w / n;
+        r.x = q.x / n;
+        r.y = q.y / n;
+        r.z = q.z / n;
+    }
+
+    return r;
+}
+
+/*! @brief Quaternion for a rotation vector, exact for any angle */
+static inline icm20948_quat_t _quat_from_rotvec(const float phi[3]) {
+    const float angle = sqrtf((phi[0] * phi[0]) + (phi[1] * phi[1]) + (phi[2] * phi[2]));
+    icm20948_quat_t q;
+    float k;
+
+    // Small angles use the series of sin(a/2)/a to avoid dividing by ~0
+    if( angle < 1e-4f ) {
+        k = 0.5f - ((angle * angle) / 48.0f);
+    }
+    else {
+        k = sinf(0.5f * angle) / angle;
+    }
+
+    q.w = cosf(0.5f * angle);
+    q.x = phi[0] * k;
+    q.y = phi[1] * k;
+    q.z = phi[2] * k;
+
+    return q;
+}
+
+/*! @brief Rotates the body frame vector v into the world frame, out may alias v */
+static inline void _quat_rotate(icm20948_quat_t q, const float v[3], float out[3]) {
+    // v' = v + 2w (u x v) + 2 u x (u x v), with u the vector part of q
+    const float u[3] = { q.x, q.y, q.z };
+    float t[3];
+    float c[3];
+
+    _vec_cross(u, v, t);
+    t[0] *= 2.0f;
+    t[1] *= 2.0f;
+    t[2] *= 2.0f;
+    _vec_cross(u, t, c);
+
+    out[0] = v[0] + (q.w * t[0]) + c[0];
+    out[1] = v[1] + (q.w * t[1]) + c[1];
+    out[2] = v[2] + (q.w * t[2]) + c[2];
+}
+
+/*! @brief Rotates the world frame vector v into the body frame, out may alias v */
+static inline void _quat_rotate_inv(icm20948_quat_t q, const float v[3], float out[3]) {
+    icm20948_quat_t c = { q.w, -q.x, -q.y, -q.z };
+    _quat_rotate(c, v, out);
+}
+
+#endif // _ICM20948_MATH_H_
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,192 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_pedometer.c
+ * @brief Source file for the ICM20948 step counter and activity level classifier.
+ */
+
+#include <string.h>
+#include <math.h>
+#include "icm20948_pedometer.h"
+#include "icm20948_math.h"
+
+/*!
+ * @brief This API closes an activity epoch and classifies it
+ *
+ * @param[in] ped: Pointer to the step counter
+ */
+static void _pedometer_epoch(icm20948_pedometer_t *ped) {
+    const float rms = (float)sqrt(ped->epoch_sumsq / (double)ped->epoch_count);
+    uint8_t level = ICM20948_ACTIVITY_SEDENTARY;
+
+    while( (level < (ICM20948_ACTIVITY_LEVELS - 1)) && (rms >= ped->cfg.level_thresholds[level]) ) {
+        level++;
+    }
+
+    ped->status.level = (icm20948_activity_level_t)level;
+    ped->status.level_epochs[level]++;
+    ped->epoch_count = 0;
+    ped->epoch_sumsq = 0.0;
+}
+
+/*!
+ * @brief This API handles a threshold crossing that may be a step
+ *
+ * @param[in] ped: Pointer to the step counter
+ */
+static void _pedometer_step(icm20948_pedometer_t *ped) {
+    const float cadence = 60.0e6f / ((float)ped->since_step * (float)ped->cfg.sample_period_us);
+
+    ped->since_step = 0;
+
+    if( ped->regular ) {
+        ped->status.steps++;
+        ped->status.cadence = cadence;
+    }
+    else if( ++ped->pending >= ped->cfg.regulation_steps ) {
+        // Walking established, credit the steps that led up to it
+        ped->status.steps += ped->pending;
+        ped->status.cadence = cadence;
+        ped->pending = 0;
+        ped->regular = true;
+    }
+}
+
+/*!
+ * @brief This API initializes the step counter
+ */
+icm20948_return_code_t icm20948_pedometerInit(icm20948_pedometer_t *ped, const icm20948_pedometer_cfg_t *cfg) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    float dt = 0.0f;
+
+    if( (ped == NULL) || (cfg == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (cfg->sample_period_us == 0) || (cfg->smoothing_hz <= 0.0f) ||
+             (cfg->min_step_interval_ms == 0) || (cfg->max_step_interval_ms <= cfg->min_step_interval_ms) ||
+             (cfg->epoch_ms == 0) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        memset(ped, 0, sizeof(icm20948_pedometer_t));
+        ped->cfg = *cfg;
+        dt = (float)cfg->sample_period_us * 1e-6f;
+
+        ped->grav_alpha = 1.0f - expf(-dt / ((float)cfg->max_step_interval_ms * 1e-3f));
+        ped->smooth_alpha = 1.0f - expf(-2.0f * (float)ICM20948_PI * cfg->smoothing_hz * dt);
+
+        ped->min_interval = (uint32_t)(((uint64_t)cfg->min_step_interval_ms * 1000u) / cfg->sample_period_us);
+        ped->max_interval = (uint32_t)(((uint64_t)cfg->max_step_interval_ms * 1000u) / cfg->sample_period_us);
+        ped->epoch_len = (uint32_t)(((uint64_t)cfg->epoch_ms * 1000u) / cfg->sample_period_us);
+
+        // The threshold window has to span the slowest step to see a full swing
+        ped->window_len = ped->max_interval;
+        ped->since_step = ped->max_interval + 1;
+
+        if( (ped->min_interval == 0) || (ped->epoch_len == 0) ) {
+            ret = ICM20948_RET_INV_PARAM;
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API runs a block of accel samples through the step counter
+ */
+icm20948_return_code_t icm20948_pedometerProcess(icm20948_pedometer_t *ped, const icm20948_fblock_t *accel) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (ped == NULL) || (accel == NULL) || (accel->x == NULL) || (accel->y == NULL) || (accel->z == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    for( uint32_t i = 0; (ret == ICM20948_RET_OK) && (i < accel->len); i++ ) {
+        const float mag = sqrtf(accel->x[i] * accel->x[i] + accel->y[i] * accel->y[i] + accel->z[i] * accel->z[i]);
+        const float prev = ped->smooth;
+        float dyn;
+
+        if( !ped->primed ) {
+            ped->grav = mag;
+            ped->window_max = 0.0f;
+            ped->window_min = 0.0f;
+            ped->primed = true;
+        }
+
+        ped->grav += ped->grav_alpha * (mag - ped->grav);
+        dyn = mag - ped->grav;
+        ped->smooth += ped->smooth_alpha * (dyn - ped->smooth);
+
+        ped->epoch_sumsq += (double)dyn * dyn;
+        if( ++ped->epoch_count >= ped->epoch_len ) {
+            _pedometer_epoch(ped);
+        }
+
+        // A gap longer than the slowest step ends the walk
+        if( ped->since_step <= ped->max_interval ) {
+            ped->since_step++;
+        }
+        else {
+            ped->regular = false;
+            ped->pending = 0;
+            ped->status.cadence = 0.0f;
+        }
+
+        if( (prev > ped->threshold) && (ped->smooth <= ped->threshold) &&
+            (ped->peak_to_peak >= ped->cfg.min_peak_to_peak) && (ped->since_step >= ped->min_interval) ) {
+            _pedometer_step(ped);
+        }
+
+        ped->window_max = (ped->smooth > ped->window_max) ? ped->smooth : ped->window_max;
+        ped->window_min = (ped->smooth < ped->window_min) ? ped->smooth : ped->window_min;
+        if( ++ped->window_count >= ped->window_len ) {
+            ped->threshold = 0.5f * (ped->window_max + ped->window_min);
+            ped->peak_to_peak = ped->window_max - ped->window_min;
+            ped->window_max = ped->smooth;
+            ped->window_min = ped->smooth;
+            ped->window_count = 0;
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API retrieves the step count and activity level
+ */
+icm20948_return_code_t icm20948_pedometerGetStatus(const icm20948_pedometer_t *ped, icm20948_pedometer_status_t *status) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (ped == NULL) || (status == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        *status = ped->status;
+    }
+
+    return ret;
+}
@@ -0,0 +1,234 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+
+/*! @file icm20948_pingpong.c
+ * @brief Source file for the ICM20948 double buffered acquisition.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "icm20948_pingpong.h"
+#include "icm20948_atomic.h"
+
+/*!
+ * @brief This API passes the filling buffer to the consumer and moves on to the other one
+ *
+ * @param[in] pp: Pointer to the acquisition state
+ */
+static void _pingpong_handoff(icm20948_pingpong_t *pp) {
+    const uint32_t idx = pp->active;
+    const uint32_t len = pp->fill;
+
+    // The consumer may hand the buffer straight back from inside the callback
+    ICM20948_STORE_RELEASE(&pp->owned[idx], 1u);
+    pp->active = idx ^ 1u;
+    pp->fill = 0;
+    pp->handoffs++;
+
+    pp->ready(pp->ctx, pp->buf[idx], len, (pp->src == ICM20948_PINGPONG_FIFO) ? &pp->layout[idx] : NULL);
+}
+
+#if ICM20948_FEATURE_FIFO
+/*!
+ * @brief This API accounts for FIFO frames just drained into the filling buffer. Frames
+ * of a different layout than the ones already there move to the other buffer, after the
+ * filling one is handed off.
+ *
+ * @param[in] pp: Pointer to the acquisition state
+ * @param[in] data: Pointer to the frames, at the fill position of the filling buffer
+ * @param[in] len: Number of bytes drained
+ * @param[in] layout: Pointer to the layout of the frames drained
+ */
+static void _pingpong_append(icm20948_pingpong_t *pp, const uint8_t *data, uint32_t len, const icm20948_fifo_layout_t *layout) {
+    icm20948_fifo_layout_t *cur = &pp->layout[pp->active];
+    const uint32_t next = pp->active ^ 1u;
+
+    if( (pp->fill > 0) && ((cur->accel != layout->accel) || (cur->gyro != layout->gyro)) ) {
+        // Copy before the hand-off, the consumer owns the buffer as soon as it is called
+        if( ICM20948_LOAD_ACQUIRE(&pp->owned[next]) == 0 ) {
+            memcpy(pp->buf[next], data, len);
+        }
+        else {
+            pp->overruns++;
+            len = 0;
+        }
+
+        _pingpong_handoff(pp);
+    }
+
+    pp->layout[pp->active] = *layout;
+    pp->fill += len;
+}
+#endif
+
+/*!
+ * @brief This API initializes double buffered acquisition
+ */
+icm20948_return_code_t icm20948_pingpongInit(icm20948_pingpong_t *pp, icm20948_pingpong_src_t src, uint8_t *buf0, uint8_t *buf1,
+                                             uint32_t size, uint32_t watermark, icm20948_pingpong_ready_fptr_t ready, void *ctx) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (pp == NULL) || (buf0 == NULL) || (buf1 == NULL) || (ready == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (buf0 == buf1) || (size < ICM20948_BURST_SIZE) || (watermark > size) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+    else if( (src != ICM20948_PINGPONG_BURST) &&
+             ((src != ICM20948_PINGPONG_FIFO) || (ICM20948_FEATURE_FIFO == 0)) ) {
+        ret = ICM20948_RET_INV_CONFIG;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        pp->src = src;
+        pp->buf[0] = buf0;
+        pp->buf[1] = buf1;
+        pp->size = size;
+        pp->watermark = (watermark == 0) ? size : watermark;
+        pp->ready = ready;
+        pp->ctx = ctx;
+        pp->owned[0] = 0;
+        pp->owned[1] = 0;
+        pp->active = 0;
+        pp->fill = 0;
+        memset(pp->layout, 0, sizeof(pp->layout));
+        pp->handoffs = 0;
+        pp->overruns = 0;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API runs one acquisition step into the filling buffer
+ */
+icm20948_return_code_t icm20948_pingpongPoll(icm20948_pingpong_t *pp) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint8_t *dst = NULL;
+
+    if( pp == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( ICM20948_LOAD_ACQUIRE(&pp->owned[pp->active]) != 0 ) {
+        // The consumer hasn't handed this buffer back yet
+        pp->overruns++;
+    }
+    else {
+        dst = &pp->buf[pp->active][pp->fill];
+
+        if( pp->src == ICM20948_PINGPONG_BURST ) {
+            ret = icm20948_readBurst(dst);
+            if( ret == ICM20948_RET_OK ) {
+                pp->fill += ICM20948_BURST_SIZE;
+            }
+        }
+#if ICM20948_FEATURE_FIFO
+        else {
+            icm20948_fifo_layout_t layout;
+            uint32_t len = pp->size - pp->fill;
+
+            ret = icm20948_readFifoBytes(dst, &len, &layout);
+            if( (ret == ICM20948_RET_OK) && (len > 0) ) {
+                _pingpong_append(pp, dst, len, &layout);
+            }
+        }
+#endif
+
+        // A frame is never larger than a burst, so less room than that means full
+        if( (ret == ICM20948_RET_OK) &&
+            ((pp->fill >= pp->watermark) || ((pp->size - pp->fill) < ICM20948_BURST_SIZE)) ) {
+            _pingpong_handoff(pp);
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API hands off the filling buffer early
+ */
+icm20948_return_code_t icm20948_pingpongFlush(icm20948_pingpong_t *pp) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( pp == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( pp->fill > 0 ) {
+        _pingpong_handoff(pp);
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API hands a buffer back from the consumer
+ */
+icm20948_return_code_t icm20948_pingpongRelease(icm20948_pingpong_t *pp, const uint8_t *buf) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint32_t idx = 0;
+
+    if( (pp == NULL) || (buf == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( buf == pp->buf[0] ) {
+        idx = 0;
+    }
+    else if( buf == pp->buf[1] ) {
+        idx = 1;
+    }
+    else {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( (ret == ICM20948_RET_OK) && (ICM20948_LOAD_ACQUIRE(&pp->owned[idx]) == 0) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        // Publishes the consumer's last access to the buffer before the driver reuses it
+        ICM20948_STORE_RELEASE(&pp->owned[idx], 0u);
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API retrieves the hand-off and overrun counts
+ */
+icm20948_return_code_t icm20948_pingpongGetStats(const icm20948_pingpong_t *pp, uint32_t *handoffs, uint32_t *overruns) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (pp == NULL) || (handoffs == NULL) || (overruns == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        *handoffs = pp->handoffs;
+        *overruns = pp->overruns;
+    }
+
+    return ret;
+}
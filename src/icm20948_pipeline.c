@@ -0,0 +1,396 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_pipeline.c
+ * @brief Source file for the ICM20948 processing pipeline.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "icm20948_pipeline.h"
+#include "icm20948_log.h"
+#include "icm20948_health.h"
+
+/*!
+ * @brief This API initializes an arena over caller storage
+ */
+icm20948_return_code_t icm20948_arenaInit(icm20948_arena_t *arena, void *mem, uint32_t size) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (arena == NULL) || (mem == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        arena->base = (uint8_t *)mem;
+        arena->size = size;
+        arena->used = 0;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API takes memory from an arena
+ */
+void *icm20948_arenaAlloc(icm20948_arena_t *arena, uint32_t size, uint32_t align) {
+    void *mem = NULL;
+
+    if( (arena != NULL) && (align != 0) && ((align & (align - 1)) == 0) ) {
+        // Align the address rather than the offset, the base may be unaligned
+        const uintptr_t addr = (uintptr_t)&arena->base[arena->used];
+        const uint32_t pad = (uint32_t)(((addr + align - 1) & ~(uintptr_t)(align - 1)) - addr);
+
+        if( ((uint64_t)arena->used + pad + size) <= arena->size ) {
+            mem = &arena->base[arena->used + pad];
+            arena->used += pad + size;
+        }
+    }
+
+    return mem;
+}
+
+/*!
+ * @brief This API initializes a pipeline
+ */
+icm20948_return_code_t icm20948_pipelineInit(icm20948_pipeline_t *p, icm20948_arena_t *arena, uint32_t block_capacity, icm20948_pipe_clock_fptr_t clock) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (p == NULL) || (arena == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( block_capacity == 0 ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        memset(p, 0, sizeof(icm20948_pipeline_t));
+        p->arena = arena;
+        p->block_capacity = block_capacity;
+        p->clock = clock;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API declares a buffer and allocates its storage
+ */
+icm20948_return_code_t icm20948_pipelineAddBuffer(icm20948_pipeline_t *p, icm20948_pipe_type_t type, uint8_t *id) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    icm20948_pipe_buf_t *buf = NULL;
+    const uint32_t n = (p != NULL) ? p->block_capacity : 0;
+
+    if( (p == NULL) || (id == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( type > ICM20948_PIPE_FLOAT ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+    else if( p->n_bufs >= ICM20948_PIPELINE_MAX_BUFFERS ) {
+        ret = ICM20948_RET_INV_CONFIG;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        buf = &p->bufs[p->n_bufs];
+        memset(buf, 0, sizeof(icm20948_pipe_buf_t));
+        buf->type = type;
+        buf->capacity = n;
+
+        switch( type ) {
+            case ICM20948_PIPE_RAW3:
+                buf->u.raw.x = (int16_t *)icm20948_arenaAlloc(p->arena, n * sizeof(int16_t), sizeof(int16_t));
+                buf->u.raw.y = (int16_t *)icm20948_arenaAlloc(p->arena, n * sizeof(int16_t), sizeof(int16_t));
+                buf->u.raw.z = (int16_t *)icm20948_arenaAlloc(p->arena, n * sizeof(int16_t), sizeof(int16_t));
+                ret = ((buf->u.raw.x == NULL) || (buf->u.raw.y == NULL) || (buf->u.raw.z == NULL)) ? ICM20948_RET_INV_CONFIG : ret;
+                break;
+            case ICM20948_PIPE_FLOAT3:
+                buf->u.f3.x = (float *)icm20948_arenaAlloc(p->arena, n * sizeof(float), sizeof(float));
+                buf->u.f3.y = (float *)icm20948_arenaAlloc(p->arena, n * sizeof(float), sizeof(float));
+                buf->u.f3.z = (float *)icm20948_arenaAlloc(p->arena, n * sizeof(float), sizeof(float));
+                ret = ((buf->u.f3.x == NULL) || (buf->u.f3.y == NULL) || (buf->u.f3.z == NULL)) ? ICM20948_RET_INV_CONFIG : ret;
+                break;
+            case ICM20948_PIPE_QUAT:
+                buf->u.quat.data = (icm20948_quat_t *)icm20948_arenaAlloc(p->arena, n * sizeof(icm20948_quat_t), sizeof(float));
+                ret = (buf->u.quat.data == NULL) ? ICM20948_RET_INV_CONFIG : ret;
+                break;
+            default:
+                buf->u.scalar.data = (float *)icm20948_arenaAlloc(p->arena, n * sizeof(float), sizeof(float));
+                ret = (buf->u.scalar.data == NULL) ? ICM20948_RET_INV_CONFIG : ret;
+                break;
+        }
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        *id = p->n_bufs++;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API declares a stage, to run after all stages declared before it
+ */
+icm20948_return_code_t icm20948_pipelineAddStage(icm20948_pipeline_t *p, const char *name, icm20948_pipe_stage_fptr_t run, void *ctx,
+                                                 const uint8_t *in, uint8_t n_in, const uint8_t *out, uint8_t n_out) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    icm20948_pipe_stage_t *stage = NULL;
+
+    if( (p == NULL) || (run == NULL) || ((in == NULL) && (n_in != 0)) || ((out == NULL) && (n_out != 0)) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (n_in > ICM20948_PIPELINE_MAX_PORTS) || (n_out > ICM20948_PIPELINE_MAX_PORTS) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+    else if( p->n_stages >= ICM20948_PIPELINE_MAX_STAGES ) {
+        ret = ICM20948_RET_INV_CONFIG;
+    }
+
+    for( uint8_t i = 0; (ret == ICM20948_RET_OK) && (i < n_in); i++ ) {
+        ret = (in[i] < p->n_bufs) ? ret : ICM20948_RET_INV_PARAM;
+    }
+    for( uint8_t i = 0; (ret == ICM20948_RET_OK) && (i < n_out); i++ ) {
+        ret = (out[i] < p->n_bufs) ? ret : ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        stage = &p->stages[p->n_stages++];
+        memset(stage, 0, sizeof(icm20948_pipe_stage_t));
+        stage->name = name;
+        stage->run = run;
+        stage->ctx = ctx;
+        stage->n_in = n_in;
+        stage->n_out = n_out;
+        if( n_in != 0 ) {
+            memcpy(stage->in, in, n_in);
+        }
+        if( n_out != 0 ) {
+            memcpy(stage->out, out, n_out);
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API retrieves a buffer
+ */
+icm20948_pipe_buf_t *icm20948_pipelineBuffer(icm20948_pipeline_t *p, uint8_t id) {
+    return ((p != NULL) && (id < p->n_bufs)) ? &p->bufs[id] : NULL;
+}
+
+/*!
+ * @brief This API runs every stage once, in declaration order
+ */
+icm20948_return_code_t icm20948_pipelineRun(icm20948_pipeline_t *p) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( p == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    for( uint8_t s = 0; (ret == ICM20948_RET_OK) && (s < p->n_stages); s++ ) {
+        icm20948_pipe_stage_t *stage = &p->stages[s];
+        icm20948_pipe_buf_t *in[ICM20948_PIPELINE_MAX_PORTS] = { NULL };
+        icm20948_pipe_buf_t *out[ICM20948_PIPELINE_MAX_PORTS] = { NULL };
+        uint64_t start = 0;
+
+        for( uint8_t i = 0; i < stage->n_in; i++ ) {
+            in[i] = &p->bufs[stage->in[i]];
+        }
+        for( uint8_t i = 0; i < stage->n_out; i++ ) {
+            out[i] = &p->bufs[stage->out[i]];
+        }
+
+        if( p->clock != NULL ) {
+            start = p->clock();
+        }
+
+        ret = stage->run(stage->ctx, in, stage->n_in, out, stage->n_out);
+
+        if( p->clock != NULL ) {
+            const uint64_t ticks = p->clock() - start;
+
+            stage->timing.calls++;
+            stage->timing.total += ticks;
+            stage->timing.last = ticks;
+            stage->timing.max = (ticks > stage->timing.max) ? ticks : stage->timing.max;
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API retrieves a stage's timing
+ */
+icm20948_return_code_t icm20948_pipelineGetTiming(const icm20948_pipeline_t *p, uint8_t stage, icm20948_pipe_timing_t *timing) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (p == NULL) || (timing == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( stage >= p->n_stages ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        *timing = p->stages[stage].timing;
+    }
+
+    return ret;
+}
+
+#if ICM20948_FEATURE_FIFO
+/*!
+ * @brief Stage draining the FIFO
+ */
+icm20948_return_code_t icm20948_pipeStageReadFifo(void *ctx, icm20948_pipe_buf_t *const *in, uint8_t n_in, icm20948_pipe_buf_t *const *out, uint8_t n_out) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    (void)ctx;
+    (void)in;
+    (void)n_in;
+
+    if( n_out < 2 ) {
+        ret = ICM20948_RET_INV_CONFIG;
+    }
+    else if( (out[0]->type != ICM20948_PIPE_RAW3) || (out[1]->type != ICM20948_PIPE_RAW3) ) {
+        ret = ICM20948_RET_INV_CONFIG;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        out[0]->u.raw.len = out[0]->capacity;
+        out[1]->u.raw.len = out[1]->capacity;
+        ret = icm20948_readFifo(&out[0]->u.raw, &out[1]->u.raw);
+    }
+
+    return ret;
+}
+#endif
+
+/*!
+ * @brief Stage scaling raw samples
+ */
+icm20948_return_code_t icm20948_pipeStageConvert(void *ctx, icm20948_pipe_buf_t *const *in, uint8_t n_in, icm20948_pipe_buf_t *const *out, uint8_t n_out) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( ctx == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (n_in < 1) || (n_out < 1) ) {
+        ret = ICM20948_RET_INV_CONFIG;
+    }
+    else if( (in[0]->type != ICM20948_PIPE_RAW3) || (out[0]->type != ICM20948_PIPE_FLOAT3) ) {
+        ret = ICM20948_RET_INV_CONFIG;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        out[0]->u.f3.len = out[0]->capacity;
+        ret = icm20948_convertBlock(*(const icm20948_sensor_t *)ctx, &in[0]->u.raw, &out[0]->u.f3);
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief Stage appending to a binary log
+ */
+icm20948_return_code_t icm20948_pipeStageLog(void *ctx, icm20948_pipe_buf_t *const *in, uint8_t n_in, icm20948_pipe_buf_t *const *out, uint8_t n_out) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    icm20948_log_writer_t *w = (icm20948_log_writer_t *)ctx;
+    const icm20948_block_t *blocks[2] = { NULL, NULL };
+    const icm20948_pipe_buf_t *quat = NULL;
+    uint8_t port = 0;
+
+    (void)out;
+    (void)n_out;
+
+    if( w == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    for( uint8_t ch = 0; (ret == ICM20948_RET_OK) && (ch < 2); ch++ ) {
+        if( w->hdr.channels & (ICM20948_LOG_CH_ACCEL << ch) ) {
+            if( port >= n_in ) {
+                ret = ICM20948_RET_INV_CONFIG;
+            }
+            else {
+                ret = (in[port]->type == ICM20948_PIPE_RAW3) ? ret : ICM20948_RET_INV_CONFIG;
+                blocks[ch] = &in[port++]->u.raw;
+            }
+        }
+    }
+
+    if( (ret == ICM20948_RET_OK) && (w->hdr.channels & ICM20948_LOG_CH_QUAT) ) {
+        if( port >= n_in ) {
+            ret = ICM20948_RET_INV_CONFIG;
+        }
+        else if( in[port]->type != ICM20948_PIPE_QUAT ) {
+            ret = ICM20948_RET_INV_CONFIG;
+        }
+        else {
+            quat = in[port];
+
+            // One orientation per frame, the raw blocks set the frame count
+            if( ((blocks[0] != NULL) && (blocks[0]->len != quat->u.quat.len)) ||
+                ((blocks[1] != NULL) && (blocks[1]->len != quat->u.quat.len)) ) {
+                ret = ICM20948_RET_INV_PARAM;
+            }
+        }
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        ret = icm20948_logWriteFrames(w, blocks[0], blocks[1], (quat != NULL) ? quat->u.quat.data : NULL, (quat != NULL) ? quat->u.quat.len : 0);
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief Stage feeding the health monitor
+ */
+icm20948_return_code_t icm20948_pipeStageHealth(void *ctx, icm20948_pipe_buf_t *const *in, uint8_t n_in, icm20948_pipe_buf_t *const *out, uint8_t n_out) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    (void)out;
+    (void)n_out;
+
+    if( ctx == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( n_in < 1 ) {
+        ret = ICM20948_RET_INV_CONFIG;
+    }
+    else if( in[0]->type != ICM20948_PIPE_RAW3 ) {
+        ret = ICM20948_RET_INV_CONFIG;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        ret = icm20948_healthProcess((icm20948_health_t *)ctx, &in[0]->u.raw);
+    }
+
+    return ret;
+}
@@ -0,0 +1,291 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_pool.c
+ * @brief Source file for the ICM20948 fixed size block pool.
+ */
+
+#include <stddef.h>
+#include "icm20948_pool.h"
+#include "icm20948_atomic.h"
+
+#define ICM20948_POOL_EMPTY                 (0xFFFF)
+
+/*!
+ * @brief This API rounds a block size up to keep every block 4 byte aligned
+ *
+ * @param[in] block_size: Requested block size
+ *
+ * @return Returns the block size used
+ */
+static uint32_t _pool_block_size(uint32_t block_size) {
+    return (block_size + 3u) & ~3u;
+}
+
+/*!
+ * @brief This API finds the block a pointer falls in
+ *
+ * @param[in] pool: Pointer to the pool
+ * @param[in] ptr: Pointer into a block
+ * @param[out] idx: Pointer to where the block index should be placed
+ *
+ * @return Returns the status of the lookup
+ */
+static icm20948_return_code_t _pool_index(const icm20948_pool_t *pool, const void *ptr, uint32_t *idx) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    const uint8_t *p = (const uint8_t *)ptr;
+
+    if( (pool == NULL) || (ptr == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (p < pool->blocks) || (p >= &pool->blocks[(size_t)pool->count * pool->block_size]) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        *idx = (uint32_t)((size_t)(p - pool->blocks) / pool->block_size);
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API pushes a block onto the free stack
+ *
+ * @param[in] pool: Pointer to the pool
+ * @param[in] idx: Index of the block
+ */
+static void _pool_push(icm20948_pool_t *pool, uint32_t idx) {
+    uint32_t old = ICM20948_LOAD_ACQUIRE(&pool->head);
+    uint32_t next;
+
+    do {
+        ICM20948_STORE_RELAXED(&pool->next[idx], (uint16_t)(old & 0xFFFF));
+        next = ((old + 0x10000u) & 0xFFFF0000u) | idx;
+    } while( !ICM20948_CAS(&pool->head, &old, next) );
+}
+
+/*!
+ * @brief This API computes the storage a pool needs
+ */
+uint32_t icm20948_poolRequiredSize(uint32_t block_size, uint32_t count) {
+    // Blocks, then the 4 byte reference counts, then the 2 byte links
+    return (_pool_block_size(block_size) * count) + (count * (uint32_t)sizeof(uint32_t)) + (count * (uint32_t)sizeof(uint16_t));
+}
+
+/*!
+ * @brief This API initializes a pool over caller storage
+ */
+icm20948_return_code_t icm20948_poolInit(icm20948_pool_t *pool, void *mem, uint32_t block_size, uint32_t count) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (pool == NULL) || (mem == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (block_size == 0) || (count == 0) || (count >= ICM20948_POOL_MAX_BLOCKS) || (((uintptr_t)mem & 0x03) != 0) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        pool->block_size = _pool_block_size(block_size);
+        pool->count = count;
+        pool->blocks = (uint8_t *)mem;
+        pool->refs = (uint32_t *)&pool->blocks[pool->block_size * count];
+        pool->next = (uint16_t *)&pool->refs[count];
+        pool->in_use = 0;
+        pool->high_water = 0;
+        pool->failures = 0;
+
+        // Chain the blocks in address order
+        for( uint32_t i = 0; i < count; i++ ) {
+            pool->refs[i] = 0;
+            pool->next[i] = (uint16_t)(((i + 1) < count) ? (i + 1) : ICM20948_POOL_EMPTY);
+        }
+        ICM20948_STORE_RELEASE(&pool->head, 0u);
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API takes a block from the pool with a reference count of 1
+ */
+void *icm20948_poolAlloc(icm20948_pool_t *pool) {
+    void *block = NULL;
+    uint32_t old = 0;
+    uint32_t idx = ICM20948_POOL_EMPTY;
+
+    if( pool != NULL ) {
+        old = ICM20948_LOAD_ACQUIRE(&pool->head);
+
+        // A stale link read here is harmless, the tag makes the swap fail
+        do {
+            idx = old & 0xFFFF;
+        } while( (idx != ICM20948_POOL_EMPTY) &&
+                 !ICM20948_CAS(&pool->head, &old, ((old + 0x10000u) & 0xFFFF0000u) | ICM20948_LOAD_RELAXED(&pool->next[idx])) );
+
+        if( idx == ICM20948_POOL_EMPTY ) {
+            (void)ICM20948_FETCH_ADD(&pool->failures, 1u);
+        }
+        else {
+            uint32_t used = ICM20948_FETCH_ADD(&pool->in_use, 1u) + 1u;
+            uint32_t high = ICM20948_LOAD_RELAXED(&pool->high_water);
+
+            while( (used > high) && !ICM20948_CAS(&pool->high_water, &high, used) ) {
+            }
+
+            ICM20948_STORE_RELEASE(&pool->refs[idx], 1u);
+            block = &pool->blocks[idx * pool->block_size];
+        }
+    }
+
+    return block;
+}
+
+/*!
+ * @brief This API adds an owner to a block
+ */
+icm20948_return_code_t icm20948_poolRetain(icm20948_pool_t *pool, const void *block) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint32_t idx = 0;
+
+    ret = _pool_index(pool, block, &idx);
+
+    if( ret == ICM20948_RET_OK ) {
+        // Only an owner may add owners, so the count can't be 0 here
+        (void)ICM20948_FETCH_ADD(&pool->refs[idx], 1u);
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API drops an owner from a block, returning it to the pool with the last
+ */
+icm20948_return_code_t icm20948_poolRelease(icm20948_pool_t *pool, const void *block) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint32_t idx = 0;
+    uint32_t refs = 0;
+
+    ret = _pool_index(pool, block, &idx);
+
+    if( ret == ICM20948_RET_OK ) {
+        refs = ICM20948_FETCH_SUB(&pool->refs[idx], 1u);
+
+        if( refs == 0 ) {
+            // Released more often than it was owned, undo and report
+            (void)ICM20948_FETCH_ADD(&pool->refs[idx], 1u);
+            ret = ICM20948_RET_INV_PARAM;
+        }
+        else if( refs == 1 ) {
+            (void)ICM20948_FETCH_SUB(&pool->in_use, 1u);
+            _pool_push(pool, idx);
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API takes a block and lays a raw 3-axis sample block out in it
+ */
+icm20948_return_code_t icm20948_poolAllocRaw(icm20948_pool_t *pool, icm20948_block_t *block) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    int16_t *mem = NULL;
+    uint32_t n = 0;
+
+    if( (pool == NULL) || (block == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else {
+        n = pool->block_size / (3 * sizeof(int16_t));
+        ret = (n != 0) ? ret : ICM20948_RET_INV_CONFIG;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        mem = (int16_t *)icm20948_poolAlloc(pool);
+        ret = (mem != NULL) ? ret : ICM20948_RET_GEN_FAIL;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        block->x = mem;
+        block->y = &mem[n];
+        block->z = &mem[2 * n];
+        block->len = n;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API takes a block and lays a scaled 3-axis sample block out in it
+ */
+icm20948_return_code_t icm20948_poolAllocFloat(icm20948_pool_t *pool, icm20948_fblock_t *block) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    float *mem = NULL;
+    uint32_t n = 0;
+
+    if( (pool == NULL) || (block == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else {
+        n = pool->block_size / (3 * sizeof(float));
+        ret = (n != 0) ? ret : ICM20948_RET_INV_CONFIG;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        mem = (float *)icm20948_poolAlloc(pool);
+        ret = (mem != NULL) ? ret : ICM20948_RET_GEN_FAIL;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        block->x = mem;
+        block->y = &mem[n];
+        block->z = &mem[2 * n];
+        block->len = n;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API retrieves the pool usage counters
+ */
+icm20948_return_code_t icm20948_poolGetStats(const icm20948_pool_t *pool, icm20948_pool_stats_t *stats) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (pool == NULL) || (stats == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        stats->count = pool->count;
+        stats->in_use = ICM20948_LOAD_RELAXED(&pool->in_use);
+        stats->high_water = ICM20948_LOAD_RELAXED(&pool->high_water);
+        stats->failures = ICM20948_LOAD_RELAXED(&pool->failures);
+    }
+
+    return ret;
+}
@@ -0,0 +1,365 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_pyramid.c
+ * @brief Source file for the ICM20948 min/max/mean log pyramid.
+ */
+
+#include <string.h>
+#include "icm20948_pyramid.h"
+
+/*!
+ * @brief This API empties a bin
+ *
+ * @param[out] bin: Pointer to the bin
+ */
+static void _pyramid_reset(icm20948_pyramid_bin_t *bin) {
+    for( uint8_t i = 0; i < ICM20948_PYRAMID_LANES; i++ ) {
+        bin->min[i] = INT16_MAX;
+        bin->max[i] = INT16_MIN;
+        bin->sum[i] = 0;
+    }
+    bin->count = 0;
+}
+
+/*!
+ * @brief This API writes one int16 as little endian
+ *
+ * @param[out] dst: Pointer to the output bytes
+ * @param[in] v: Value to write
+ */
+static void _pyramid_put16(uint8_t *dst, int16_t v) {
+    dst[0] = (uint8_t)((uint16_t)v & 0xFF);
+    dst[1] = (uint8_t)((uint16_t)v >> 8);
+}
+
+/*!
+ * @brief This API reads one little endian int16
+ *
+ * @param[in] src: Pointer to the input bytes
+ *
+ * @return Returns the value
+ */
+static int16_t _pyramid_get16(const uint8_t *src) {
+    return (int16_t)(((uint16_t)src[1] << 8) | src[0]);
+}
+
+/*!
+ * @brief This API writes out a bin and folds it into the level above
+ *
+ * @param[in] pyr: Pointer to the builder
+ * @param[in] idx: Index of the bin, one below its level
+ *
+ * @return Returns the status of writing the record
+ */
+static icm20948_return_code_t _pyramid_emit(icm20948_pyramid_t *pyr, uint8_t idx) {
+    uint8_t record[ICM20948_PYRAMID_LANES * 6];
+    icm20948_pyramid_bin_t *bin = &pyr->bins[idx];
+    const int64_t count = (int64_t)bin->count;
+
+    for( uint8_t i = 0; i < pyr->lanes; i++ ) {
+        // Round half away from zero, the sum is exact
+        const int64_t mean = (bin->sum[i] >= 0) ? ((bin->sum[i] + count / 2) / count) : -((-bin->sum[i] + count / 2) / count);
+
+        _pyramid_put16(&record[i * 6], bin->min[i]);
+        _pyramid_put16(&record[i * 6 + 2], bin->max[i]);
+        _pyramid_put16(&record[i * 6 + 4], (int16_t)mean);
+    }
+
+    if( (idx + 1) < pyr->levels ) {
+        icm20948_pyramid_bin_t *up = &pyr->bins[idx + 1];
+
+        for( uint8_t i = 0; i < pyr->lanes; i++ ) {
+            up->min[i] = (bin->min[i] < up->min[i]) ? bin->min[i] : up->min[i];
+            up->max[i] = (bin->max[i] > up->max[i]) ? bin->max[i] : up->max[i];
+            up->sum[i] += bin->sum[i];
+        }
+        up->count += bin->count;
+    }
+
+    _pyramid_reset(bin);
+
+    return pyr->write(pyr->ctx, (uint8_t)(idx + 1), record, (uint32_t)pyr->lanes * 6);
+}
+
+/*!
+ * @brief This API accumulates a run of samples of one lane into the level 1 bin
+ *
+ * @param[in] bin: Pointer to the level 1 bin
+ * @param[in] lane: Lane index
+ * @param[in] data: Pointer to the samples
+ * @param[in] len: Number of samples
+ */
+static void _pyramid_sweep(icm20948_pyramid_bin_t *bin, uint8_t lane, const int16_t *data, uint32_t len) {
+    int16_t lo = bin->min[lane];
+    int16_t hi = bin->max[lane];
+    int32_t sum = 0;
+
+    // A run never exceeds 2^8 samples, so the sum fits 32 bits
+    for( uint32_t i = 0; i < len; i++ ) {
+        lo = (data[i] < lo) ? data[i] : lo;
+        hi = (data[i] > hi) ? data[i] : hi;
+        sum += data[i];
+    }
+
+    bin->min[lane] = lo;
+    bin->max[lane] = hi;
+    bin->sum[lane] += sum;
+}
+
+/*!
+ * @brief This API computes the size of one record for the given log header
+ */
+uint32_t icm20948_pyramidRecordSize(const icm20948_log_header_t *hdr) {
+    uint32_t size = 0;
+
+    if( hdr != NULL ) {
+        size += (hdr->channels & ICM20948_LOG_CH_ACCEL) ? 18 : 0;
+        size += (hdr->channels & ICM20948_LOG_CH_GYRO) ? 18 : 0;
+    }
+
+    return size;
+}
+
+/*!
+ * @brief This API initializes a pyramid builder and writes out each level's header
+ */
+icm20948_return_code_t icm20948_pyramidInit(icm20948_pyramid_t *pyr, const icm20948_log_header_t *hdr, uint8_t fanout_log2, uint8_t levels, icm20948_pyramid_write_fptr_t write, void *ctx) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint8_t buf[ICM20948_PYRAMID_HEADER_SIZE];
+
+    if( (pyr == NULL) || (hdr == NULL) || (write == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (icm20948_pyramidRecordSize(hdr) == 0) || (fanout_log2 == 0) || (fanout_log2 > 8) ||
+             (levels == 0) || (levels > ICM20948_PYRAMID_MAX_LEVELS) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        memcpy(&pyr->hdr, hdr, sizeof(icm20948_log_header_t));
+        pyr->hdr.channels &= (ICM20948_LOG_CH_ACCEL | ICM20948_LOG_CH_GYRO);
+        pyr->fanout_log2 = fanout_log2;
+        pyr->levels = levels;
+        pyr->lanes = (uint8_t)(icm20948_pyramidRecordSize(hdr) / 6);
+        pyr->write = write;
+        pyr->ctx = ctx;
+
+        for( uint8_t l = 0; l < ICM20948_PYRAMID_MAX_LEVELS; l++ ) {
+            _pyramid_reset(&pyr->bins[l]);
+            pyr->children[l] = 0;
+        }
+
+        memset(buf, 0x00, sizeof(buf));
+        buf[0] = (uint8_t)(ICM20948_PYRAMID_MAGIC & 0xFF);
+        buf[1] = (uint8_t)((ICM20948_PYRAMID_MAGIC >> 8) & 0xFF);
+        buf[2] = (uint8_t)((ICM20948_PYRAMID_MAGIC >> 16) & 0xFF);
+        buf[3] = (uint8_t)((ICM20948_PYRAMID_MAGIC >> 24) & 0xFF);
+        buf[4] = ICM20948_PYRAMID_VERSION;
+        buf[5] = pyr->hdr.channels;
+        buf[7] = fanout_log2;
+        buf[8] = (uint8_t)(hdr->sample_period_us & 0xFF);
+        buf[9] = (uint8_t)((hdr->sample_period_us >> 8) & 0xFF);
+        buf[10] = (uint8_t)((hdr->sample_period_us >> 16) & 0xFF);
+        buf[11] = (uint8_t)((hdr->sample_period_us >> 24) & 0xFF);
+        buf[12] = (uint8_t)hdr->accel_fs;
+        buf[13] = (uint8_t)hdr->gyro_fs;
+    }
+
+    for( uint8_t l = 1; (ret == ICM20948_RET_OK) && (l <= levels); l++ ) {
+        buf[6] = l;
+        ret = write(ctx, l, buf, sizeof(buf));
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API adds the raw sample blocks that were just logged
+ */
+icm20948_return_code_t icm20948_pyramidAdd(icm20948_pyramid_t *pyr, const icm20948_block_t *accel, const icm20948_block_t *gyro) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    const icm20948_block_t *blocks[2] = { NULL, NULL };
+    uint8_t nblocks = 0;
+    uint32_t count = 0;
+
+    if( pyr == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else {
+        if( pyr->hdr.channels & ICM20948_LOG_CH_ACCEL ) {
+            blocks[nblocks++] = accel;
+        }
+        if( pyr->hdr.channels & ICM20948_LOG_CH_GYRO ) {
+            blocks[nblocks++] = gyro;
+        }
+
+        for( uint8_t b = 0; (ret == ICM20948_RET_OK) && (b < nblocks); b++ ) {
+            if( blocks[b] == NULL ) {
+                ret = ICM20948_RET_NULL_PTR;
+            }
+            else if( blocks[b]->len != blocks[0]->len ) {
+                ret = ICM20948_RET_INV_PARAM;
+            }
+        }
+
+        if( ret == ICM20948_RET_OK ) {
+            count = blocks[0]->len;
+        }
+    }
+
+    for( uint32_t done = 0; (ret == ICM20948_RET_OK) && (done < count); ) {
+        // Sweep up to the next level 1 bin boundary one lane at a time
+        uint32_t run = (1u << pyr->fanout_log2) - pyr->children[0];
+        run = (run < (count - done)) ? run : (count - done);
+
+        for( uint8_t b = 0; b < nblocks; b++ ) {
+            _pyramid_sweep(&pyr->bins[0], (uint8_t)(b * 3), &blocks[b]->x[done], run);
+            _pyramid_sweep(&pyr->bins[0], (uint8_t)(b * 3 + 1), &blocks[b]->y[done], run);
+            _pyramid_sweep(&pyr->bins[0], (uint8_t)(b * 3 + 2), &blocks[b]->z[done], run);
+        }
+        pyr->bins[0].count += run;
+        pyr->children[0] += run;
+        done += run;
+
+        // Carry completed bins up the levels
+        for( uint8_t l = 0; (ret == ICM20948_RET_OK) && (l < pyr->levels) && (pyr->children[l] == (1u << pyr->fanout_log2)); l++ ) {
+            pyr->children[l] = 0;
+            if( (l + 1) < pyr->levels ) {
+                pyr->children[l + 1]++;
+            }
+            ret = _pyramid_emit(pyr, l);
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API writes out the partial bin of every level at the end of a recording
+ */
+icm20948_return_code_t icm20948_pyramidFlush(icm20948_pyramid_t *pyr) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( pyr == NULL ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    for( uint8_t l = 0; (ret == ICM20948_RET_OK) && (l < pyr->levels); l++ ) {
+        if( pyr->bins[l].count != 0 ) {
+            ret = _pyramid_emit(pyr, l);
+        }
+        pyr->children[l] = 0;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API parses and validates a level header
+ */
+icm20948_return_code_t icm20948_pyramidParseHeader(const uint8_t *buf, uint32_t len, icm20948_log_header_t *hdr, uint8_t *level, uint8_t *fanout_log2) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (buf == NULL) || (hdr == NULL) || (level == NULL) || (fanout_log2 == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( len < ICM20948_PYRAMID_HEADER_SIZE ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+    else {
+        uint32_t magic = (uint32_t)buf[0] | ((uint32_t)buf[1] << 8) | ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+
+        if( (magic != ICM20948_PYRAMID_MAGIC) || (buf[4] != ICM20948_PYRAMID_VERSION) ) {
+            ret = ICM20948_RET_INV_PARAM;
+        }
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        memset(hdr, 0x00, sizeof(icm20948_log_header_t));
+        hdr->channels = buf[5];
+        hdr->sample_period_us = (uint32_t)buf[8] | ((uint32_t)buf[9] << 8) | ((uint32_t)buf[10] << 16) | ((uint32_t)buf[11] << 24);
+        hdr->accel_fs = (icm20948_accel_full_scale_select_t)buf[12];
+        hdr->gyro_fs = (icm20948_gyro_full_scale_select_t)buf[13];
+        *level = buf[6];
+        *fanout_log2 = buf[7];
+
+        if( (icm20948_pyramidRecordSize(hdr) == 0) || (buf[6] == 0) || (buf[7] == 0) || (buf[7] > 8) ) {
+            ret = ICM20948_RET_INV_PARAM;
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API unpacks one record
+ */
+icm20948_return_code_t icm20948_pyramidUnpack(const icm20948_log_header_t *hdr, const uint8_t *record, icm20948_pyramid_summary_t *accel, icm20948_pyramid_summary_t *gyro) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    icm20948_pyramid_summary_t *out[2] = { NULL, NULL };
+    uint8_t nout = 0;
+
+    if( (hdr == NULL) || (record == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else {
+        if( hdr->channels & ICM20948_LOG_CH_ACCEL ) {
+            out[nout++] = accel;
+        }
+        if( hdr->channels & ICM20948_LOG_CH_GYRO ) {
+            out[nout++] = gyro;
+        }
+    }
+
+    for( uint8_t c = 0; (ret == ICM20948_RET_OK) && (c < nout); c++ ) {
+        if( out[c] != NULL ) {
+            for( uint8_t a = 0; a < 3; a++ ) {
+                const uint8_t *src = &record[c * 18 + a * 6];
+
+                out[c]->min[a] = _pyramid_get16(&src[0]);
+                out[c]->max[a] = _pyramid_get16(&src[2]);
+                out[c]->mean[a] = _pyramid_get16(&src[4]);
+            }
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API picks the finest level that covers a span in no more than max_points records
+ */
+uint8_t icm20948_pyramidSelectLevel(uint8_t fanout_log2, uint8_t levels, uint64_t span, uint32_t max_points) {
+    uint8_t level = 0;
+
+    while( (level < levels) && (span > max_points) ) {
+        // Records needed at the next level up, rounding up for a partly covered bin
+        span = (span + (1u << fanout_log2) - 1) >> fanout_log2;
+        level++;
+    }
+
+    return level;
+}
@@ -0,0 +1,338 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_quatenc.c
+ * @brief Source file for the ICM20948 compact quaternion encodings.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include "icm20948_quatenc.h"
+
+#define ICM20948_QUATENC_SQRT2              (1.41421356f)
+
+/*!
+ * @brief This API reads a float's bit pattern
+ *
+ * @param[in] f: Value
+ *
+ * @return Returns the IEEE 754 binary32 bit pattern
+ */
+static uint32_t _quatenc_bits(float f) {
+    uint32_t x;
+
+    memcpy(&x, &f, sizeof(x));
+
+    return x;
+}
+
+/*!
+ * @brief This API builds a float from its bit pattern
+ *
+ * @param[in] x: IEEE 754 binary32 bit pattern
+ *
+ * @return Returns the value
+ */
+static float _quatenc_float(uint32_t x) {
+    float f;
+
+    memcpy(&f, &x, sizeof(f));
+
+    return f;
+}
+
+/*!
+ * @brief This API writes a little endian value of up to 8 bytes
+ *
+ * @param[out] dst: Pointer to the output bytes
+ * @param[in] v: Value to write
+ * @param[in] len: Number of bytes
+ */
+static void _quatenc_put(uint8_t *dst, uint64_t v, uint8_t len) {
+    for( uint8_t i = 0; i < len; i++ ) {
+        dst[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+/*!
+ * @brief This API reads a little endian value of up to 8 bytes
+ *
+ * @param[in] src: Pointer to the input bytes
+ * @param[in] len: Number of bytes
+ *
+ * @return Returns the value
+ */
+static uint64_t _quatenc_get(const uint8_t *src, uint8_t len) {
+    uint64_t v = 0;
+
+    for( uint8_t i = 0; i < len; i++ ) {
+        v |= (uint64_t)src[i] << (8 * i);
+    }
+
+    return v;
+}
+
+/*!
+ * @brief This API packs a quaternion as the index of its largest component and the
+ * other three quantized to bits each
+ *
+ * @param[in] q: Pointer to the quaternion
+ * @param[in] bits: Bits per stored component
+ *
+ * @return Returns the packed value, index in the top 2 bits above 3 * bits
+ */
+static uint64_t _quatenc_smallest3(const icm20948_quat_t *q, uint8_t bits) {
+    const float c[4] = { q->w, q->x, q->y, q->z };
+    const float scale = (float)((1u << bits) - 1u) * 0.5f;
+    uint64_t packed = 0;
+    uint8_t largest = 0;
+    float sign;
+
+    for( uint8_t i = 1; i < 4; i++ ) {
+        if( fabsf(c[i]) > fabsf(c[largest]) ) {
+            largest = i;
+        }
+    }
+
+    // q and -q are the same rotation, pick the one with a positive largest component
+    sign = (c[largest] < 0.0f) ? -1.0f : 1.0f;
+    packed = largest;
+
+    for( uint8_t i = 0; i < 4; i++ ) {
+        if( i != largest ) {
+            float u = (sign * c[i] * ICM20948_QUATENC_SQRT2 + 1.0f) * scale + 0.5f;
+            u = (u < 0.0f) ? 0.0f : u;
+            u = (u > 2.0f * scale) ? 2.0f * scale : u;
+            packed = (packed << bits) | (uint64_t)u;
+        }
+    }
+
+    return packed;
+}
+
+/*!
+ * @brief This API rebuilds a quaternion from its smallest-three packing
+ *
+ * @param[in] packed: Packed value
+ * @param[in] bits: Bits per stored component
+ * @param[out] q: Pointer to the decoded quaternion
+ */
+static void _quatenc_largest(uint64_t packed, uint8_t bits, icm20948_quat_t *q) {
+    const uint8_t largest = (uint8_t)((packed >> (3 * bits)) & 0x03);
+    const uint32_t mask = (1u << bits) - 1u;
+    const float inv_scale = 2.0f / (float)mask;
+    float c[4];
+    float sum = 0.0f;
+    uint8_t shift = (uint8_t)(3 * bits);
+
+    for( uint8_t i = 0; i < 4; i++ ) {
+        if( i != largest ) {
+            shift = (uint8_t)(shift - bits);
+            c[i] = ((float)((packed >> shift) & mask) * inv_scale - 1.0f) / ICM20948_QUATENC_SQRT2;
+            sum += c[i] * c[i];
+        }
+    }
+    c[largest] = (sum < 1.0f) ? sqrtf(1.0f - sum) : 0.0f;
+
+    q->w = c[0];
+    q->x = c[1];
+    q->y = c[2];
+    q->z = c[3];
+}
+
+/*!
+ * @brief This API converts a float to IEEE 754 binary16, rounding to nearest even
+ */
+uint16_t icm20948_floatToHalf(float f) {
+    const uint32_t bits = _quatenc_bits(f);
+    const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    const uint32_t x = bits & 0x7FFFFFFF;
+    uint32_t h = 0;
+    uint32_t rem = 0;
+    uint32_t half = 0;
+
+    if( x >= 0x7F800000 ) {
+        // Infinity stays infinity, NaN stays a quiet NaN
+        h = (x > 0x7F800000) ? 0x7E00 : 0x7C00;
+    }
+    else if( x >= 0x477FF000 ) {
+        // 65520 and above round past the largest half
+        h = 0x7C00;
+    }
+    else if( x >= 0x38800000 ) {
+        // Normal, rebias the exponent and round off 13 mantissa bits
+        h = (x - 0x38000000) >> 13;
+        rem = x & 0x1FFF;
+        h += ((rem > 0x1000) || ((rem == 0x1000) && (h & 0x01))) ? 1 : 0;
+    }
+    else if( x > 0x33000000 ) {
+        // Subnormal, shift the mantissa with its implicit bit into place
+        const uint32_t shift = 126 - (x >> 23);
+        const uint32_t m = (x & 0x7FFFFF) | 0x800000;
+
+        h = m >> shift;
+        rem = m & ((1u << shift) - 1u);
+        half = 1u << (shift - 1u);
+        h += ((rem > half) || ((rem == half) && (h & 0x01))) ? 1 : 0;
+    }
+
+    return (uint16_t)(sign | h);
+}
+
+/*!
+ * @brief This API converts an IEEE 754 binary16 value to a float
+ */
+float icm20948_halfToFloat(uint16_t h) {
+    const uint32_t sign = ((uint32_t)h & 0x8000) << 16;
+    const uint32_t e = ((uint32_t)h >> 10) & 0x1F;
+    const uint32_t m = (uint32_t)h & 0x3FF;
+    float f;
+
+    if( e == 0 ) {
+        // Zero or subnormal, m * 2^-24 is exact in a float
+        f = (float)m * 5.9604644775390625e-8f;
+        f = sign ? -f : f;
+    }
+    else if( e == 0x1F ) {
+        f = _quatenc_float(sign | 0x7F800000 | (m << 13));
+    }
+    else {
+        f = _quatenc_float(sign | ((e + 112) << 23) | (m << 13));
+    }
+
+    return f;
+}
+
+/*!
+ * @brief This API retrieves the encoded size of one quaternion
+ */
+uint32_t icm20948_quatEncodedSize(icm20948_quat_enc_t enc) {
+    uint32_t size = 0;
+
+    switch( enc ) {
+        case ICM20948_QUAT_ENC_F32:
+            size = 16;
+            break;
+        case ICM20948_QUAT_ENC_HALF:
+            size = 8;
+            break;
+        case ICM20948_QUAT_ENC_SMALLEST3_48:
+            size = 6;
+            break;
+        case ICM20948_QUAT_ENC_SMALLEST3_32:
+            size = 4;
+            break;
+        default:
+            size = 0;
+            break;
+    }
+
+    return size;
+}
+
+/*!
+ * @brief This API encodes a run of quaternions
+ */
+icm20948_return_code_t icm20948_quatEncode(icm20948_quat_enc_t enc, const icm20948_quat_t *q, uint32_t count, uint8_t *buf) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    const uint32_t size = icm20948_quatEncodedSize(enc);
+
+    if( (q == NULL) || (buf == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( size == 0 ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    for( uint32_t i = 0; (ret == ICM20948_RET_OK) && (i < count); i++ ) {
+        uint8_t *dst = &buf[i * size];
+
+        switch( enc ) {
+            case ICM20948_QUAT_ENC_F32:
+                _quatenc_put(&dst[0], _quatenc_bits(q[i].w), 4);
+                _quatenc_put(&dst[4], _quatenc_bits(q[i].x), 4);
+                _quatenc_put(&dst[8], _quatenc_bits(q[i].y), 4);
+                _quatenc_put(&dst[12], _quatenc_bits(q[i].z), 4);
+                break;
+            case ICM20948_QUAT_ENC_HALF:
+                _quatenc_put(&dst[0], icm20948_floatToHalf(q[i].w), 2);
+                _quatenc_put(&dst[2], icm20948_floatToHalf(q[i].x), 2);
+                _quatenc_put(&dst[4], icm20948_floatToHalf(q[i].y), 2);
+                _quatenc_put(&dst[6], icm20948_floatToHalf(q[i].z), 2);
+                break;
+            case ICM20948_QUAT_ENC_SMALLEST3_48:
+                _quatenc_put(dst, _quatenc_smallest3(&q[i], 15), 6);
+                break;
+            default:
+                _quatenc_put(dst, _quatenc_smallest3(&q[i], 10), 4);
+                break;
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API decodes a run of quaternions
+ */
+icm20948_return_code_t icm20948_quatDecode(icm20948_quat_enc_t enc, const uint8_t *buf, uint32_t count, icm20948_quat_t *q) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    const uint32_t size = icm20948_quatEncodedSize(enc);
+
+    if( (q == NULL) || (buf == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( size == 0 ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    for( uint32_t i = 0; (ret == ICM20948_RET_OK) && (i < count); i++ ) {
+        const uint8_t *src = &buf[i * size];
+
+        switch( enc ) {
+            case ICM20948_QUAT_ENC_F32:
+                q[i].w = _quatenc_float((uint32_t)_quatenc_get(&src[0], 4));
+                q[i].x = _quatenc_float((uint32_t)_quatenc_get(&src[4], 4));
+                q[i].y = _quatenc_float((uint32_t)_quatenc_get(&src[8], 4));
+                q[i].z = _quatenc_float((uint32_t)_quatenc_get(&src[12], 4));
+                break;
+            case ICM20948_QUAT_ENC_HALF:
+                q[i].w = icm20948_halfToFloat((uint16_t)_quatenc_get(&src[0], 2));
+                q[i].x = icm20948_halfToFloat((uint16_t)_quatenc_get(&src[2], 2));
+                q[i].y = icm20948_halfToFloat((uint16_t)_quatenc_get(&src[4], 2));
+                q[i].z = icm20948_halfToFloat((uint16_t)_quatenc_get(&src[6], 2));
+                break;
+            case ICM20948_QUAT_ENC_SMALLEST3_48:
+                _quatenc_largest(_quatenc_get(src, 6), 15, &q[i]);
+                break;
+            default:
+                _quatenc_largest(_quatenc_get(src, 4), 10, &q[i]);
+                break;
+        }
+    }
+
+    return ret;
+}
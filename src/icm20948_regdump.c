@@ -0,0 +1,456 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+
+/*! @file icm20948_regdump.c
+ * @brief Source file for the ICM20948 register dump and diff diagnostic.
+ */
+
+#include <stddef.h>
+#include "icm20948_regdump.h"
+#include "icm20948.h"
+
+#if ICM20948_FEATURE_REGDUMP
+
+// The descriptors index arr[] by member offset, so each bank's named registers must
+// fill its arr[] exactly
+typedef char icm20948_bank0_size_check_t[(sizeof(((icm20948_reg_bank_0_t *)0)->bytes) == ICM20948_BANK0_REG_COUNT) ? 1 : -1];
+typedef char icm20948_bank1_size_check_t[(sizeof(((icm20948_reg_bank_1_t *)0)->bytes) == ICM20948_BANK1_REG_COUNT) ? 1 : -1];
+typedef char icm20948_bank2_size_check_t[(sizeof(((icm20948_reg_bank_2_t *)0)->bytes) == ICM20948_BANK2_REG_COUNT) ? 1 : -1];
+typedef char icm20948_bank3_size_check_t[(sizeof(((icm20948_reg_bank_3_t *)0)->bytes) == ICM20948_BANK3_REG_COUNT) ? 1 : -1];
+
+/*! @brief One register, or run of registers, of a bank */
+typedef struct {
+    uint8_t addr;
+    uint8_t pos;                // Index into the bank's arr[], from the member offset
+    uint8_t count;              // Registers in the member, more than 1 for arrays
+    const char *name;
+    const char *fields;         // Bitfields from bit 0 up as NAME:width, NULL for a plain byte
+} icm20948_regdump_reg_t;
+
+#define ICM20948_REGDUMP_REG(bank_t, member, addr, fields) \
+    { (addr), (uint8_t)offsetof(bank_t, bytes.member), 1, #member, (fields) }
+
+#define REG0(member, addr, fields)          ICM20948_REGDUMP_REG(icm20948_reg_bank_0_t, member, addr, fields)
+#define REG1(member, addr, fields)          ICM20948_REGDUMP_REG(icm20948_reg_bank_1_t, member, addr, fields)
+#define REG2(member, addr, fields)          ICM20948_REGDUMP_REG(icm20948_reg_bank_2_t, member, addr, fields)
+#define REG3(member, addr, fields)          ICM20948_REGDUMP_REG(icm20948_reg_bank_3_t, member, addr, fields)
+
+#define BANK_SEL_FIELDS                     "RSVD0:4 USER_BANK:2 RSVD1:2"
+
+// Register tables in address order, field names as in the bank structures of icm20948.h
+static const icm20948_regdump_reg_t bank0_regs[] = {
+    REG0(WHO_AM_I, 0x00, NULL),
+    REG0(USER_CTRL, 0x03, "RSVD:1 I2C_MST_RST:1 SRAM_RST:1 DMP_RST:1 I2C_IF_DS:1 I2C_MST_EN:1 FIFO_EN:1 DMP_EN:1"),
+    REG0(LP_CONFIG, 0x05, "RSVD0:4 GYRO_CYCLE:1 ACCEL_CYCLE:1 I2C_MST_CYCLE:1 RSVD1:1"),
+    REG0(PWR_MGMT_1, 0x06, "CLKSEL:3 TEMP_DIS:1 RSVD:1 LP_EN:1 SLEEP:1 DEVICE_RESET:1"),
+    REG0(PWR_MGMT_2, 0x07, "DISABLE_GYRO:3 DISABLE_ACCEL:3 RSVD:2"),
+    REG0(INT_PIN_CFG, 0x0F, "RSVD:1 BYPASS_EN:1 FSYNC_INT_MODE_EN:1 ACTL_FSYNC:1 INT_ANYRD_2CLEAR:1 INT1_LATCH__EN:1 INT1_OPEN:1 INT1_ACTL:1"),
+    REG0(INT_ENABLE, 0x10, "I2C_MST_INT_EN:1 DMP_INT1_EN:1 PLL_RDY_EN:1 WOM_INT_EN:1 RSVD:3 REG_WOF_EN:1"),
+    REG0(INT_ENABLE_1, 0x11, "RAW_DATA_0_RDY_EN:1 RSVD:7"),
+    REG0(INT_ENABLE_2, 0x12, "FIFO_OVERFLOW_EN:5 RSVD:3"),
+    REG0(INT_ENABLE_3, 0x13, "FIFO_W_EN:5 RSVD:3"),
+    REG0(I2C_MST_STATUS, 0x17, "I2C_SLV0_NACK:1 I2C_SLV1_NACK:1 I2C_SLV2_NACK:1 I2C_SLV3_NACK:1 I2C_SLV4_NACK:1 I2C_LOST_ARB:1 I2C_SLV4_DONE:1 PASS_THROUGH:1"),
+    REG0(INT_STATUS, 0x19, "I2C_MST_INT:1 DMP_INT1:1 PLL_RDY_INT:1 WOM_INT:1 RSVD:4"),
+    REG0(INT_STATUS_1, 0x1A, "RAW_DATA_0_RDY_INT:1 RSVD:7"),
+    REG0(INT_STATUS_2, 0x1B, "FIFO_OVERFLOW_INT:5 RSVD:3"),
+    REG0(INT_STATUS_3, 0x1C, "FIFO_WM_INT:5 RSVD:3"),
+    REG0(DELAY_TIMEH, 0x28, NULL),
+    REG0(DELAY_TIMEL, 0x29, NULL),
+    REG0(ACCEL_XOUT_H, 0x2D, NULL),
+    REG0(ACCEL_XOUT_L, 0x2E, NULL),
+    REG0(ACCEL_YOUT_H, 0x2F, NULL),
+    REG0(ACCEL_YOUT_L, 0x30, NULL),
+    REG0(ACCEL_ZOUT_H, 0x31, NULL),
+    REG0(ACCEL_ZOUT_L, 0x32, NULL),
+    REG0(GYRO_XOUT_H, 0x33, NULL),
+    REG0(GYRO_XOUT_L, 0x34, NULL),
+    REG0(GYRO_YOUT_H, 0x35, NULL),
+    REG0(GYRO_YOUT_L, 0x36, NULL),
+    REG0(GYRO_ZOUT_H, 0x37, NULL),
+    REG0(GYRO_ZOUT_L, 0x38, NULL),
+    REG0(TEMP_OUT_H, 0x39, NULL),
+    REG0(TEMP_OUT_L, 0x3A, NULL),
+    { 0x3B, (uint8_t)offsetof(icm20948_reg_bank_0_t, bytes.EXT_SLV_SENS_DATA), ICM20948_EXT_SLV_SENS_DATA_COUNT, "EXT_SLV_SENS_DATA", NULL },
+    REG0(FIFO_EN_1, 0x66, "SLV_0_FIFO_EN:1 SLV_1_FIFO_EN:1 SLV_2_FIFO_EN:1 SLV_3_FIFO_EN:1 RSVD:4"),
+    REG0(FIFO_EN_2, 0x67, "TEMP_FIFO_EN:1 GYRO_X_FIFO_EN:1 GYRO_Y_FIFO_EN:1 GYRO_Z_FIFO_EN:1 ACCEL_FIFO_EN:1 RSVD:3"),
+    REG0(FIFO_RST, 0x68, "FIFO_RESET:5 RSVD:3"),
+    REG0(FIFO_MODE, 0x69, "FIFO_MODE:5 RSVD:3"),
+    REG0(FIFO_COUNTH, 0x70, "FIFO_COUNTH:5 RSVD:3"),
+    REG0(FIFO_COUNTL, 0x71, NULL),
+    REG0(FIFO_R_W, 0x72, NULL),
+    REG0(DATA_RDY_STATUS, 0x74, NULL),
+    REG0(FIFO_CFG, 0x76, NULL),
+    REG0(REG_BANK_SEL, 0x7F, BANK_SEL_FIELDS),
+};
+
+static const icm20948_regdump_reg_t bank1_regs[] = {
+    REG1(SELF_TEST_X_GYRO, 0x02, NULL),
+    REG1(SELF_TEST_Y_GYRO, 0x03, NULL),
+    REG1(SELF_TEST_Z_GYRO, 0x04, NULL),
+    REG1(SELF_TEST_X_ACCEL, 0x0E, NULL),
+    REG1(SELF_TEST_Y_ACCEL, 0x0F, NULL),
+    REG1(SELF_TEST_Z_ACCEL, 0x10, NULL),
+    REG1(XA_OFFS_H, 0x14, NULL),
+    REG1(XA_OFFS_L, 0x15, "RSVD:1 XA_OFFS:7"),
+    REG1(YA_OFFS_H, 0x17, NULL),
+    REG1(YA_OFFS_L, 0x18, "RSVD:1 YA_OFFS:7"),
+    REG1(ZA_OFFS_H, 0x1A, NULL),
+    REG1(ZA_OFFS_L, 0x1B, "RSVD:1 ZA_OFFS:7"),
+    REG1(TIMEBASE_CORRECTION_PLL, 0x28, NULL),
+    REG1(REG_BANK_SEL, 0x7F, BANK_SEL_FIELDS),
+};
+
+static const icm20948_regdump_reg_t bank2_regs[] = {
+    REG2(GYRO_SMPLRT_DIV, 0x00, NULL),
+    REG2(GYRO_CONFIG_1, 0x01, "GYRO_FCHOICE:1 GYRO_FS_SEL:2 GYRO_DLPFCFG:3 RSVD:2"),
+    REG2(GYRO_CONFIG_2, 0x02, "GYRO_AVGCFG:3 ZGYRO_CTEN:1 YGYRO_CTEN:1 XGYRO_CTEN:1 RSVD:2"),
+    REG2(XG_OFFS_USRH, 0x03, NULL),
+    REG2(XG_OFFS_USRL, 0x04, NULL),
+    REG2(YG_OFFS_USRH, 0x05, NULL),
+    REG2(YG_OFFS_USRL, 0x06, NULL),
+    REG2(ZG_OFFS_USRH, 0x07, NULL),
+    REG2(ZG_OFFS_USRL, 0x08, NULL),
+    REG2(ODR_ALIGN_EN, 0x09, "ODR_ALIGN_EN:1 RSVD:7"),
+    REG2(ACCEL_SMPLRT_DIV_1, 0x10, "ACCEL_SMPLRT_DIV:4 RSVD:4"),
+    REG2(ACCEL_SMPLRT_DIV_2, 0x11, NULL),
+    REG2(ACCEL_INTEL_CTRL, 0x12, "ACCEL_INTEL_MODE_INT:1 ACCEL_INTEL_EN:1 RSVD:6"),
+    REG2(ACCEL_WOM_THR, 0x13, NULL),
+    REG2(ACCEL_CONFIG, 0x14, "ACCEL_FCHOICE:1 ACCEL_FS_SEL:2 ACCEL_DLPFCFG:3 RSVD:2"),
+    REG2(ACCEL_CONFIG_2, 0x15, "DEC3_CFG:2 AZ_ST_EN_REG:1 AY_ST_EN_REG:1 AX_ST_EN_REG:1 RSVD:3"),
+    REG2(FSYNC_CONFIG, 0x52, "EXT_SYNC_SET:4 WOF_EDGE_INT:1 WOF_DEGLITCH_EN:1 RSVD:1 DELAY_TIME_EN:1"),
+    REG2(TEMP_CONFIG, 0x53, "TEMP_DLPFCFG:3 RSVD:5"),
+    REG2(MOD_CTRL_USR, 0x54, "REG_LP_DMP_EN:1 RSVD:7"),
+    REG2(REG_BANK_SEL, 0x7F, BANK_SEL_FIELDS),
+};
+
+static const icm20948_regdump_reg_t bank3_regs[] = {
+    REG3(I2C_MST_ODR_CONFIG, 0x00, "I2C_MST_ODR_CONFIG:4 RSVD:4"),
+    REG3(I2C_MST_CTRL, 0x01, "I2C_MST_CLK:4 I2C_MST_P_NSR:1 RSVD:2 MULT_MST_EN:1"),
+    REG3(I2C_MST_DELAY_CTRL, 0x02, "I2C_SLV0_DELAY_EN:1 I2C_SLV1_DELAY_EN:1 I2C_SLV2_DELAY_EN:1 I2C_SLV3_DELAY_EN:1 I2C_SLV4_DELAY_EN:1 RSVD:2 DELAY_ES_SHADOW:1"),
+    REG3(I2C_SLV0_ADDR, 0x03, "I2C_ID_0:7 I2C_SLV0_RNW:1"),
+    REG3(I2C_SLV0_REG, 0x04, NULL),
+    REG3(I2C_SLV0_CTRL, 0x05, "I2C_SLV0_LENG:4 I2C_SLV0_GRP:1 I2C_SLV0_REG_DIS:1 I2C_SLV0_BYTE_SW:1 I2C_SLV0_EN:1"),
+    REG3(I2C_SLV0_DO, 0x06, NULL),
+    REG3(I2C_SLV1_ADDR, 0x07, "I2C_ID_1:7 I2C_SLV1_RNW:1"),
+    REG3(I2C_SLV1_REG, 0x08, NULL),
+    REG3(I2C_SLV1_CTRL, 0x09, "I2C_SLV1_LENG:4 I2C_SLV1_GRP:1 I2C_SLV1_REG_DIS:1 I2C_SLV1_BYTE_SW:1 I2C_SLV1_EN:1"),
+    REG3(I2C_SLV1_DO, 0x0A, NULL),
+    REG3(I2C_SLV2_ADDR, 0x0B, "I2C_ID_2:7 I2C_SLV2_RNW:1"),
+    REG3(I2C_SLV2_REG, 0x0C, NULL),
+    REG3(I2C_SLV2_CTRL, 0x0D, "I2C_SLV2_LENG:4 I2C_SLV2_GRP:1 I2C_SLV2_REG_DIS:1 I2C_SLV2_BYTE_SW:1 I2C_SLV2_EN:1"),
+    REG3(I2C_SLV2_DO, 0x0E, NULL),
+    REG3(I2C_SLV3_ADDR, 0x0F, "I2C_ID_3:7 I2C_SLV3_RNW:1"),
+    REG3(I2C_SLV3_REG, 0x10, NULL),
+    REG3(I2C_SLV3_CTRL, 0x11, "I2C_SLV3_LENG:4 I2C_SLV3_GRP:1 I2C_SLV3_REG_DIS:1 I2C_SLV3_BYTE_SW:1 I2C_SLV3_EN:1"),
+    REG3(I2C_SLV3_DO, 0x12, NULL),
+    REG3(I2C_SLV4_ADDR, 0x13, "I2C_ID_4:7 I2C_SLV4_RNW:1"),
+    REG3(I2C_SLV4_REG, 0x14, NULL),
+    REG3(I2C_SLV4_CTRL, 0x15, "I2C_SLV4_DLY:5 I2C_SLV4_REG_DIS:1 I2C_SLV4_INT_EN:1 I2C_SLV4_EN:1"),
+    REG3(I2C_SLV4_DO, 0x16, NULL),
+    REG3(I2C_SLV4_DI, 0x17, NULL),
+    REG3(REG_BANK_SEL, 0x7F, BANK_SEL_FIELDS),
+};
+
+static const struct {
+    const icm20948_regdump_reg_t *regs;
+    uint8_t count;
+} banks[4] = {
+    { bank0_regs, sizeof(bank0_regs) / sizeof(bank0_regs[0]) },
+    { bank1_regs, sizeof(bank1_regs) / sizeof(bank1_regs[0]) },
+    { bank2_regs, sizeof(bank2_regs) / sizeof(bank2_regs[0]) },
+    { bank3_regs, sizeof(bank3_regs) / sizeof(bank3_regs[0]) },
+};
+
+/*! @brief Line being built for the print callback */
+typedef struct {
+    char buf[ICM20948_REGDUMP_LINE_MAX];
+    uint32_t len;
+} icm20948_regdump_line_t;
+
+/*!
+ * @brief This API checks whether reading a register is free of side effects
+ *
+ * @param[in] bank: User register bank
+ * @param[in] addr: Register address
+ *
+ * @return Returns true if the register can be read by the dump
+ */
+static bool _readable(uint8_t bank, uint8_t addr) {
+    return !_icm20948_read_has_side_effects(bank, addr);
+}
+
+/*!
+ * @brief This API appends a string to a line, truncating at the line capacity
+ *
+ * @param[in,out] line: Pointer to the line
+ * @param[in] str: String to append
+ */
+static void _put_str(icm20948_regdump_line_t *line, const char *str) {
+    while( (*str != '\0') && (line->len < (ICM20948_REGDUMP_LINE_MAX - 1)) ) {
+        line->buf[line->len++] = *str++;
+    }
+    line->buf[line->len] = '\0';
+}
+
+/*!
+ * @brief This API appends a number to a line, as 0x-prefixed hex or as decimal
+ *
+ * @param[in,out] line: Pointer to the line
+ * @param[in] v: Value to append
+ * @param[in] hex: Append as two hex digits rather than decimal
+ */
+static void _put_num(icm20948_regdump_line_t *line, uint8_t v, bool hex) {
+    const char digits[] = "0123456789ABCDEF";
+    char str[5];
+    uint8_t n = 0;
+
+    if( hex ) {
+        str[n++] = '0';
+        str[n++] = 'x';
+        str[n++] = digits[v >> 4];
+        str[n++] = digits[v & 0x0F];
+    }
+    else {
+        if( v >= 100 ) {
+            str[n++] = digits[v / 100];
+        }
+        if( v >= 10 ) {
+            str[n++] = digits[(v / 10) % 10];
+        }
+        str[n++] = digits[v % 10];
+    }
+    str[n] = '\0';
+
+    _put_str(line, str);
+}
+
+/*!
+ * @brief This API pads a line with spaces up to a column
+ *
+ * @param[in,out] line: Pointer to the line
+ * @param[in] col: Column to pad to
+ */
+static void _put_pad(icm20948_regdump_line_t *line, uint32_t col) {
+    while( (line->len < col) && (line->len < (ICM20948_REGDUMP_LINE_MAX - 1)) ) {
+        _put_str(line, " ");
+    }
+}
+
+/*!
+ * @brief This API appends the named bitfields of a register, marking the fields that
+ * differ from the expected value
+ *
+ * @param[in,out] line: Pointer to the line
+ * @param[in] fields: Field list from bit 0 up as NAME:width
+ * @param[in] value: Register value read from the chip
+ * @param[in] expect: Expected register value
+ * @param[in] checked: The expected value is known
+ */
+static void _put_fields(icm20948_regdump_line_t *line, const char *fields, uint8_t value, uint8_t expect, bool checked) {
+    uint8_t shift = 0;
+
+    while( *fields != '\0' ) {
+        const char *name = fields;
+        uint8_t name_len = 0;
+        uint8_t width = 0;
+        uint8_t mask = 0;
+
+        while( (*fields != ':') && (*fields != '\0') ) {
+            fields++;
+            name_len++;
+        }
+
+        if( *fields == ':' ) {
+            fields++;
+        }
+
+        while( (*fields >= '0') && (*fields <= '9') ) {
+            width = (uint8_t)((width * 10) + (*fields++ - '0'));
+        }
+
+        while( *fields == ' ' ) {
+            fields++;
+        }
+
+        mask = (uint8_t)((0x01 << width) - 1);
+
+        // Reserved fields carry no information
+        if( (name_len < 4) || (name[0] != 'R') || (name[1] != 'S') || (name[2] != 'V') || (name[3] != 'D') ) {
+            _put_str(line, " ");
+            for( uint8_t i = 0; i < name_len; i++ ) {
+                char c[2] = { name[i], '\0' };
+                _put_str(line, c);
+            }
+            _put_str(line, "=");
+            _put_num(line, (uint8_t)((value >> shift) & mask), false);
+
+            if( checked && (((value ^ expect) >> shift) & mask) ) {
+                _put_str(line, "(");
+                _put_num(line, (uint8_t)((expect >> shift) & mask), false);
+                _put_str(line, ")");
+            }
+        }
+
+        shift = (uint8_t)(shift + width);
+    }
+}
+
+/*!
+ * @brief This API reads one bank into its arr[] union in as few bursts as possible.
+ * Consecutive registers share a burst unless a register with read side effects lies
+ * between them.
+ *
+ * @param[in] bank: User register bank
+ * @param[out] arr: Pointer to the arr[] of the bank's union
+ * @param[out] read: Pointer to a flag per table entry, set once the entry is read
+ * @param[in,out] summary: Pointer to the counts
+ *
+ * @return Returns the status of reading the bank
+ */
+static icm20948_return_code_t _read_bank(uint8_t bank, uint8_t *arr, bool *read, icm20948_regdump_summary_t *summary) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    const icm20948_regdump_reg_t *regs = banks[bank].regs;
+    uint8_t raw[128];
+    uint8_t i = 0;
+
+    while( (i < banks[bank].count) && (ret == ICM20948_RET_OK) ) {
+        uint8_t first = i;
+        uint8_t lo = regs[i].addr;
+        uint8_t hi = (uint8_t)(regs[i].addr + regs[i].count - 1);
+        bool extend = _readable(bank, lo);
+
+        if( extend == false ) {
+            read[i++] = false;
+            summary->unread++;
+        }
+        else {
+            i++;
+
+            while( extend && (i < banks[bank].count) ) {
+                for( uint8_t a = (uint8_t)(hi + 1); a <= regs[i].addr; a++ ) {
+                    extend = extend && _readable(bank, a);
+                }
+
+                if( extend ) {
+                    hi = (uint8_t)(regs[i].addr + regs[i].count - 1);
+                    i++;
+                }
+            }
+
+            ret = icm20948_readRegisters(bank, lo, &raw[lo], (uint32_t)(hi - lo) + 1);
+            summary->bursts++;
+
+            // Scatter the burst into the union by member position
+            for( uint8_t n = first; (n < i) && (ret == ICM20948_RET_OK); n++ ) {
+                for( uint8_t k = 0; k < regs[n].count; k++ ) {
+                    arr[regs[n].pos + k] = raw[regs[n].addr + k];
+                }
+                read[n] = true;
+                summary->regs = (uint16_t)(summary->regs + regs[n].count);
+            }
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API reads all four register banks, decodes them and diffs the
+ * configuration registers against the driver's shadow
+ */
+icm20948_return_code_t icm20948_regDump(icm20948_regdump_mode_t mode, icm20948_regdump_print_fptr_t print, void *ctx, icm20948_regdump_summary_t *summary) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    icm20948_regdump_summary_t counts = { 0, 0, 0, 0, 0 };
+    icm20948_reg_bank_0_t b0;
+    icm20948_reg_bank_1_t b1;
+    icm20948_reg_bank_2_t b2;
+    icm20948_reg_bank_3_t b3;
+    uint8_t *arr[4] = { b0.arr, b1.arr, b2.arr, b3.arr };
+    bool read[64];
+
+    for( uint8_t bank = 0; (bank < 4) && (ret == ICM20948_RET_OK); bank++ ) {
+        const icm20948_regdump_reg_t *regs = banks[bank].regs;
+
+        ret = _read_bank(bank, arr[bank], read, &counts);
+
+        for( uint8_t i = 0; (i < banks[bank].count) && (ret == ICM20948_RET_OK); i++ ) {
+            for( uint8_t k = 0; k < regs[i].count; k++ ) {
+                icm20948_regdump_line_t line = { { '\0' }, 0 };
+                uint8_t value = arr[bank][regs[i].pos + k];
+                uint8_t expect = 0;
+                bool checked = false;
+                bool mismatch = false;
+
+                if( read[i] && (regs[i].count == 1) && (icm20948_getShadowRegister(bank, regs[i].addr, &expect) == ICM20948_RET_OK) ) {
+                    checked = true;
+                    mismatch = (value != expect);
+                    counts.checked++;
+                    counts.mismatches = (uint16_t)(counts.mismatches + (mismatch ? 1 : 0));
+                }
+
+                if( (print != NULL) && ((mode == ICM20948_REGDUMP_ALL) || mismatch) ) {
+                    _put_str(&line, "B");
+                    _put_num(&line, bank, false);
+                    _put_str(&line, " ");
+                    _put_num(&line, (uint8_t)(regs[i].addr + k), true);
+                    _put_str(&line, " ");
+                    _put_str(&line, regs[i].name);
+                    if( regs[i].count > 1 ) {
+                        _put_str(&line, "_");
+                        _put_num(&line, k, false);
+                    }
+                    _put_pad(&line, 32);
+
+                    if( read[i] == false ) {
+                        _put_str(&line, "--   not read, read has side effects");
+                    }
+                    else {
+                        _put_num(&line, value, true);
+
+                        if( regs[i].fields != NULL ) {
+                            _put_fields(&line, regs[i].fields, value, expect, checked);
+                        }
+
+                        if( mismatch ) {
+                            _put_str(&line, " != ");
+                            _put_num(&line, expect, true);
+                        }
+                    }
+
+                    print(ctx, line.buf);
+                }
+            }
+        }
+    }
+
+    if( summary != NULL ) {
+        *summary = counts;
+    }
+
+    return ret;
+}
+
+#endif
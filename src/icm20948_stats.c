@@ -0,0 +1,265 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_stats.c
+ * @brief Source file for the ICM20948 streaming statistics accumulator.
+ */
+
+#include <string.h>
+#include "icm20948_stats.h"
+
+/*! @brief Largest sweep for which n * sum(x^2) and sum(x)^2 of int16 samples fit in an int64 */
+#define ICM20948_STATS_MAX_SWEEP            (65535)
+
+/*!
+ * @brief This API folds the moments of one axis of a partial result into an accumulator
+ *
+ * @param[in] st: Pointer to the accumulator
+ * @param[in] axis: Axis index being folded
+ * @param[in] n: Number of samples in the partial result
+ * @param[in] mean: Mean of the partial result
+ * @param[in] m2: Sum of squared deviations of the partial result
+ */
+static void _stats_fold(icm20948_stats_t *st, uint8_t axis, uint64_t n, double mean, double m2) {
+    const double na = (double)st->n;
+    const double nb = (double)n;
+    const double delta = mean - st->mean[axis];
+
+    st->mean[axis] += delta * (nb / (na + nb));
+    st->m2[axis] += m2 + (delta * delta) * ((na * nb) / (na + nb));
+}
+
+/*!
+ * @brief This API sweeps one axis of a sub-block and folds the result into the accumulator
+ *
+ * @param[in] st: Pointer to the accumulator
+ * @param[in] axis: Axis index being swept
+ * @param[in] data: Pointer to the axis samples
+ * @param[in] len: Number of samples, no more than ICM20948_STATS_MAX_SWEEP
+ */
+static void _stats_sweep(icm20948_stats_t *st, uint8_t axis, const int16_t *data, uint32_t len) {
+    int64_t sum = 0;
+    int64_t sum_sq = 0;
+    int16_t min = data[0];
+    int16_t max = data[0];
+
+    // Plain reductions with no branches, left for the compiler to vectorize
+    for( uint32_t i = 0; i < len; i++ ) {
+        const int32_t v = data[i];
+        sum += v;
+        sum_sq += (int64_t)(v * v);
+        min = (data[i] < min) ? data[i] : min;
+        max = (data[i] > max) ? data[i] : max;
+    }
+
+    // n * M2 is exact in integers, so the sub-block moments carry no rounding error
+    const double m2 = (double)(((int64_t)len * sum_sq) - (sum * sum)) / len;
+
+    if( st->n == 0 ) {
+        st->min[axis] = min;
+        st->max[axis] = max;
+    }
+    else {
+        st->min[axis] = (min < st->min[axis]) ? min : st->min[axis];
+        st->max[axis] = (max > st->max[axis]) ? max : st->max[axis];
+    }
+
+    _stats_fold(st, axis, len, (double)sum / len, m2);
+}
+
+/*!
+ * @brief This API clears a statistics accumulator
+ */
+void icm20948_statsReset(icm20948_stats_t *st) {
+    if( st != NULL ) {
+        memset(st, 0x00, sizeof(icm20948_stats_t));
+    }
+}
+
+/*!
+ * @brief This API adds a block of raw samples to the accumulator
+ */
+icm20948_return_code_t icm20948_statsAddBlock(icm20948_stats_t *st, const icm20948_block_t *block) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint32_t offset = 0;
+
+    if( (st == NULL) || (block == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (block->len != 0) && ((block->x == NULL) || (block->y == NULL) || (block->z == NULL)) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    while( (ret == ICM20948_RET_OK) && (offset < block->len) ) {
+        uint32_t chunk = block->len - offset;
+        if( chunk > ICM20948_STATS_MAX_SWEEP ) {
+            chunk = ICM20948_STATS_MAX_SWEEP;
+        }
+
+        _stats_sweep(st, 0, &block->x[offset], chunk);
+        _stats_sweep(st, 1, &block->y[offset], chunk);
+        _stats_sweep(st, 2, &block->z[offset], chunk);
+        st->n += chunk;
+        offset += chunk;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API merges a partial result into an accumulator
+ */
+icm20948_return_code_t icm20948_statsMerge(icm20948_stats_t *dst, const icm20948_stats_t *src) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (dst == NULL) || (src == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( src->n == 0 ) {
+        // Nothing to merge
+    }
+    else if( dst->n == 0 ) {
+        memcpy(dst, src, sizeof(icm20948_stats_t));
+    }
+    else {
+        for( uint8_t axis = 0; axis < ICM20948_STATS_AXIS_COUNT; axis++ ) {
+            dst->min[axis] = (src->min[axis] < dst->min[axis]) ? src->min[axis] : dst->min[axis];
+            dst->max[axis] = (src->max[axis] > dst->max[axis]) ? src->max[axis] : dst->max[axis];
+            _stats_fold(dst, axis, src->n, src->mean[axis], src->m2[axis]);
+        }
+        dst->n += src->n;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API retrieves the mean of an axis
+ */
+double icm20948_statsMean(const icm20948_stats_t *st, uint8_t axis) {
+    double mean = 0.0;
+
+    if( (st != NULL) && (axis < ICM20948_STATS_AXIS_COUNT) && (st->n != 0) ) {
+        mean = st->mean[axis];
+    }
+
+    return mean;
+}
+
+/*!
+ * @brief This API retrieves the population variance of an axis
+ */
+double icm20948_statsVariance(const icm20948_stats_t *st, uint8_t axis) {
+    double var = 0.0;
+
+    if( (st != NULL) && (axis < ICM20948_STATS_AXIS_COUNT) && (st->n != 0) ) {
+        var = st->m2[axis] / (double)st->n;
+    }
+
+    return var;
+}
+
+/*!
+ * @brief This API initializes a sliding window built from a ring of partial accumulators
+ */
+icm20948_return_code_t icm20948_statsWindowInit(icm20948_stats_window_t *win, icm20948_stats_t *slots, uint8_t slot_count, uint32_t slot_len) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (win == NULL) || (slots == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (slot_count == 0) || (slot_len == 0) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        win->slots = slots;
+        win->slot_count = slot_count;
+        win->slot_len = slot_len;
+        win->head = 0;
+        memset(slots, 0x00, sizeof(icm20948_stats_t) * slot_count);
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API adds a block of raw samples to the sliding window
+ */
+icm20948_return_code_t icm20948_statsWindowAdd(icm20948_stats_window_t *win, const icm20948_block_t *block) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint32_t offset = 0;
+
+    if( (win == NULL) || (block == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    while( (ret == ICM20948_RET_OK) && (offset < block->len) ) {
+        icm20948_stats_t *slot = &win->slots[win->head];
+
+        if( slot->n == win->slot_len ) {
+            // The newest slot is full, so recycle the oldest one in its place
+            win->head = (uint8_t)((win->head + 1) % win->slot_count);
+            slot = &win->slots[win->head];
+            icm20948_statsReset(slot);
+        }
+
+        uint32_t chunk = block->len - offset;
+        if( chunk > (win->slot_len - (uint32_t)slot->n) ) {
+            chunk = win->slot_len - (uint32_t)slot->n;
+        }
+
+        icm20948_block_t sub = {
+            .x = &block->x[offset],
+            .y = &block->y[offset],
+            .z = &block->z[offset],
+            .len = chunk
+        };
+        ret = icm20948_statsAddBlock(slot, &sub);
+        offset += chunk;
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API retrieves the statistics over the whole sliding window
+ */
+icm20948_return_code_t icm20948_statsWindowGet(const icm20948_stats_window_t *win, icm20948_stats_t *st) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (win == NULL) || (st == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        icm20948_statsReset(st);
+        for( uint8_t i = 0; (i < win->slot_count) && (ret == ICM20948_RET_OK); i++ ) {
+            ret = icm20948_statsMerge(st, &win->slots[i]);
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,178 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_strapdown.c
+ * @brief Source file for the ICM20948 strapdown inertial integrator.
+ */
+
+#include <string.h>
+#include "icm20948_strapdown.h"
+#include "icm20948_math.h"
+
+/*!
+ * @brief This API closes the current update, applying the coning and sculling
+ * corrections and stepping the navigation state
+ *
+ * @param[in] sd: Pointer to the integrator
+ * @param[out] out: Pointer to where the navigation update should be placed
+ */
+static void _strapdown_update(icm20948_strapdown_t *sd, icm20948_strapdown_out_t *out) {
+    const float t = sd->cfg.sample_period * (float)sd->n;
+    float phi[3];
+    float rot[3];
+    float dv_body[3];
+    float dv[3];
+
+    // Rotation vector with the coning correction
+    phi[0] = sd->alpha[0] + sd->beta[0];
+    phi[1] = sd->alpha[1] + sd->beta[1];
+    phi[2] = sd->alpha[2] + sd->beta[2];
+
+    // Velocity increment with the rotation and sculling corrections, in the body
+    // frame at the start of the update
+    _vec_cross(sd->alpha, sd->nu, rot);
+    dv_body[0] = sd->nu[0] + (0.5f * rot[0]) + sd->scul[0];
+    dv_body[1] = sd->nu[1] + (0.5f * rot[1]) + sd->scul[1];
+    dv_body[2] = sd->nu[2] + (0.5f * rot[2]) + sd->scul[2];
+
+    // Specific force into the world frame, then add back gravity
+    _quat_rotate(sd->q, dv_body, dv);
+    dv[2] -= sd->cfg.gravity * t;
+
+    out->dq = _quat_from_rotvec(phi);
+    for( uint8_t i = 0; i < 3; i++ ) {
+        out->dv[i] = dv[i];
+        // Trapezoidal position step
+        out->dp[i] = (sd->v[i] + (0.5f * dv[i])) * t;
+        sd->v[i] += dv[i];
+        sd->p[i] += out->dp[i];
+    }
+    sd->q = _quat_normalize(_quat_mul(sd->q, out->dq));
+
+    memset(sd->alpha, 0x00, sizeof(sd->alpha));
+    memset(sd->nu, 0x00, sizeof(sd->nu));
+    memset(sd->beta, 0x00, sizeof(sd->beta));
+    memset(sd->scul, 0x00, sizeof(sd->scul));
+    sd->n = 0;
+}
+
+/*!
+ * @brief This API initializes a strapdown integrator at rest at the origin
+ */
+icm20948_return_code_t icm20948_strapdownInit(icm20948_strapdown_t *sd, const icm20948_strapdown_cfg_t *cfg) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+
+    if( (sd == NULL) || (cfg == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( (cfg->sample_period <= 0.0f) || (cfg->decim == 0) ||
+             (icm20948_gyroSensitivity(cfg->gyro_fs) == 0.0f) || (icm20948_accelSensitivity(cfg->accel_fs) == 0.0f) ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+
+    if( ret == ICM20948_RET_OK ) {
+        memset(sd, 0x00, sizeof(icm20948_strapdown_t));
+        memcpy(&sd->cfg, cfg, sizeof(icm20948_strapdown_cfg_t));
+
+        // Raw counts straight to angle (rad) and velocity (m/s) increments
+        sd->gyro_scale = (ICM20948_DEG_TO_RAD / icm20948_gyroSensitivity(cfg->gyro_fs)) * cfg->sample_period;
+        sd->accel_scale = (ICM20948_STANDARD_GRAVITY / icm20948_accelSensitivity(cfg->accel_fs)) * cfg->sample_period;
+        sd->q = _quat_normalize(cfg->q0);
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief This API integrates blocks of raw accel and gyro samples
+ */
+icm20948_return_code_t icm20948_strapdownProcess(icm20948_strapdown_t *sd, const icm20948_block_t *accel, const icm20948_block_t *gyro, icm20948_strapdown_out_t *out, uint32_t *count) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint32_t produced = 0;
+
+    if( (sd == NULL) || (accel == NULL) || (gyro == NULL) || (count == NULL) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+    else if( accel->len != gyro->len ) {
+        ret = ICM20948_RET_INV_PARAM;
+    }
+    else if( ((sd->n + accel->len) / sd->cfg.decim) > *count ) {
+        // Not enough room for every update this block will produce
+        ret = ICM20948_RET_INV_PARAM;
+    }
+    else if( (out == NULL) && (((sd->n + accel->len) / sd->cfg.decim) != 0) ) {
+        ret = ICM20948_RET_NULL_PTR;
+    }
+
+    for( uint32_t i = 0; (ret == ICM20948_RET_OK) && (i < accel->len); i++ ) {
+        const float dtheta[3] = {
+            (float)gyro->x[i] * sd->gyro_scale,
+            (float)gyro->y[i] * sd->gyro_scale,
+            (float)gyro->z[i] * sd->gyro_scale
+        };
+        const float dv[3] = {
+            (float)accel->x[i] * sd->accel_scale,
+            (float)accel->y[i] * sd->accel_scale,
+            (float)accel->z[i] * sd->accel_scale
+        };
+        float a[3];
+        float u[3];
+        float c0[3];
+        float c1[3];
+
+        // Savage's recursive coning and sculling terms, using the previous
+        // increment extrapolated to second order
+        for( uint8_t k = 0; k < 3; k++ ) {
+            a[k] = sd->alpha[k] + (sd->dtheta_prev[k] / 6.0f);
+            u[k] = sd->nu[k] + (sd->dv_prev[k] / 6.0f);
+        }
+
+        _vec_cross(a, dtheta, c0);
+        for( uint8_t k = 0; k < 3; k++ ) {
+            sd->beta[k] += 0.5f * c0[k];
+        }
+
+        _vec_cross(a, dv, c0);
+        _vec_cross(u, dtheta, c1);
+        for( uint8_t k = 0; k < 3; k++ ) {
+            sd->scul[k] += 0.5f * (c0[k] + c1[k]);
+            sd->alpha[k] += dtheta[k];
+            sd->nu[k] += dv[k];
+            sd->dtheta_prev[k] = dtheta[k];
+            sd->dv_prev[k] = dv[k];
+        }
+
+        if( ++sd->n == sd->cfg.decim ) {
+            _strapdown_update(sd, &out[produced]);
+            produced++;
+        }
+    }
+
+    if( count != NULL ) {
+        *count = produced;
+    }
+
+    return ret;
+}
@@ -59,7 +59,8 @@ void usr_delay_us(uint32_t period) {
 
 int main(void) {
     icm20948_return_code_t ret = ICM20948_RET_OK;
-    icm20948_settings_t settings;
+    // Zeroed settings leave everything at its default, including no axis remap
+    icm20948_settings_t settings = {};
     icm20948_gyro_t gyro_data;
     icm20948_accel_t accel_data;
 
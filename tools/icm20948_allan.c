@@ -0,0 +1,372 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+/*! @file icm20948_allan.c
+ * @brief Host tool computing Allan deviation and noise coefficients from binary logs.
+ *
+ * Usage: icm20948_allan [-t taus] [-c] log.bin [log.bin ...]
+ *
+ * Every axis of every log is handled by its own thread, streaming straight out of the
+ * memory mapped file, so hours of recordings need no more memory than the cumulative
+ * sum history of each estimator. Up to 8 logs are in flight at once and results are
+ * printed in command line order. The number of taus is capped per log so the longest
+ * cluster still fits twice in the recording, which also bounds that history to the
+ * length of the log.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "icm20948_log.h"
+#include "icm20948_allan.h"
+
+#define ALLAN_DEFAULT_TAUS                  (20)
+#define ALLAN_CHUNK_SAMPLES                 (4096)
+#define ALLAN_MAX_JOBS                      (6)
+#define ALLAN_MAX_OPEN_LOGS                 (8)
+
+static const char *axis_names[3] = { "x", "y", "z" };
+
+typedef struct {
+    const uint8_t *frames;
+    uint64_t count;
+    uint32_t frame_size;
+    uint32_t offset;
+    uint8_t taus;
+    icm20948_allan_t est;
+    int64_t *hist;
+    icm20948_return_code_t ret;
+} allan_job_t;
+
+typedef struct {
+    const char *path;
+    const uint8_t *map;
+    size_t size;
+    icm20948_log_header_t hdr;
+    allan_job_t jobs[ALLAN_MAX_JOBS];
+    pthread_t threads[ALLAN_MAX_JOBS];
+    const char *channels[ALLAN_MAX_JOBS];
+    double scales[ALLAN_MAX_JOBS];
+    uint8_t njobs;
+} allan_log_t;
+
+/*!
+ * @brief Thread entry streaming one axis of a log through its estimator
+ *
+ * @param[in] arg: Pointer to the allan_job_t describing the axis
+ *
+ * @return Returns NULL
+ */
+static void *allan_worker(void *arg) {
+    allan_job_t *job = (allan_job_t *)arg;
+    int16_t buf[ALLAN_CHUNK_SAMPLES];
+    uint64_t done = 0;
+
+    job->ret = icm20948_allanInit(&job->est, job->hist, job->taus);
+
+    while( (job->ret == ICM20948_RET_OK) && (done < job->count) ) {
+        uint32_t chunk = ALLAN_CHUNK_SAMPLES;
+        if( (job->count - done) < chunk ) {
+            chunk = (uint32_t)(job->count - done);
+        }
+
+        // Gather this axis out of the interleaved frames
+        const uint8_t *p = &job->frames[(done * job->frame_size) + job->offset];
+        for( uint32_t i = 0; i < chunk; i++ ) {
+            buf[i] = (int16_t)(((uint16_t)p[1] << 8) | p[0]);
+            p += job->frame_size;
+        }
+
+        job->ret = icm20948_allanAdd(&job->est, buf, chunk);
+        done += chunk;
+    }
+
+    return NULL;
+}
+
+/*!
+ * @brief Prints the curve and noise coefficients of one axis
+ *
+ * @param[in] name: Name of the log file
+ * @param[in] channel: Name of the channel
+ * @param[in] axis: Axis index
+ * @param[in] job: Pointer to the finished job
+ * @param[in] period: Sample period in s
+ * @param[in] scale: Units per LSB
+ * @param[in] csv: Print machine readable output
+ */
+static void allan_report(const char *name, const char *channel, uint8_t axis, const allan_job_t *job, double period, double scale, int csv) {
+    double tau[ICM20948_ALLAN_MAX_TAUS];
+    double adev[ICM20948_ALLAN_MAX_TAUS];
+    uint8_t count = 0;
+    icm20948_allan_coeff_t coeff;
+    const int gyro = (strcmp(channel, "gyro") == 0);
+
+    for( uint8_t j = 0; j < job->taus; j++ ) {
+        double a = icm20948_allanDeviation(&job->est, j);
+        if( a <= 0.0 ) {
+            break;
+        }
+        tau[count] = period * (double)((uint64_t)1 << j);
+        adev[count] = a * scale;
+        count++;
+    }
+
+    if( icm20948_allanCoefficients(tau, adev, count, &coeff) != ICM20948_RET_OK ) {
+        fprintf(stderr, "%s: %s %s: recording too short\n", name, channel, axis_names[axis]);
+        return;
+    }
+
+    if( csv ) {
+        for( uint8_t j = 0; j < count; j++ ) {
+            printf("%s,%s,%s,curve,%.9g,%.9g\n", name, channel, axis_names[axis], tau[j], adev[j]);
+        }
+        printf("%s,%s,%s,coeff,%.9g,%.9g,%.9g,%.9g\n", name, channel, axis_names[axis],
+               coeff.arw, coeff.bias_instability, coeff.tau_bias, coeff.rrw);
+    }
+    else {
+        printf("%s %s %s\n", name, channel, axis_names[axis]);
+        for( uint8_t j = 0; j < count; j++ ) {
+            printf("  tau %12.6f s  adev %.6e %s\n", tau[j], adev[j], gyro ? "dps" : "g");
+        }
+        if( gyro ) {
+            printf("  angle random walk  %.6e dps/sqrt(Hz)  (%.4f deg/sqrt(h))\n", coeff.arw, coeff.arw * 60.0);
+            printf("  bias instability   %.6e dps  (%.4f deg/h) at tau %.3f s\n", coeff.bias_instability, coeff.bias_instability * 3600.0, coeff.tau_bias);
+            printf("  rate random walk   %.6e dps*sqrt(Hz)\n", coeff.rrw);
+        }
+        else {
+            printf("  velocity random walk  %.6e g/sqrt(Hz)  (%.4f m/s/sqrt(h))\n", coeff.arw, coeff.arw * 9.80665 * 60.0);
+            printf("  bias instability      %.6e g  (%.2f ug) at tau %.3f s\n", coeff.bias_instability, coeff.bias_instability * 1e6, coeff.tau_bias);
+            printf("  accel random walk     %.6e g*sqrt(Hz)\n", coeff.rrw);
+        }
+    }
+}
+
+/*!
+ * @brief Maps a log file and starts a thread for every axis in it
+ *
+ * @param[out] log: Pointer to the log state, left holding nothing on failure
+ * @param[in] path: Path of the log file
+ * @param[in] taus: Number of octave cluster sizes to estimate
+ *
+ * @return Returns 0 on success
+ */
+static int allan_start(allan_log_t *log, const char *path, uint8_t taus) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    const uint8_t *map = NULL;
+
+    memset(log, 0x00, sizeof(allan_log_t));
+    log->path = path;
+
+    if( (fd < 0) || (fstat(fd, &st) != 0) ) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        if( fd >= 0 ) {
+            close(fd);
+        }
+        return 1;
+    }
+
+    if( st.st_size > 0 ) {
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+
+    if( (map == NULL) || (map == MAP_FAILED) ||
+        (icm20948_logParseHeader(map, (uint32_t)((st.st_size < ICM20948_LOG_HEADER_SIZE) ? st.st_size : ICM20948_LOG_HEADER_SIZE), &log->hdr) != ICM20948_RET_OK) ) {
+        fprintf(stderr, "%s: not an ICM20948 log\n", path);
+        if( (map != NULL) && (map != MAP_FAILED) ) {
+            munmap((void *)map, (size_t)st.st_size);
+        }
+        return 1;
+    }
+
+    const uint32_t frame_size = icm20948_logFrameSize(&log->hdr);
+
+    if( (frame_size == 0) || (log->hdr.sample_period_us == 0) ) {
+        fprintf(stderr, "%s: log has no channels or no sample period\n", path);
+        munmap((void *)map, (size_t)st.st_size);
+        return 1;
+    }
+
+    if( (log->hdr.channels & (ICM20948_LOG_CH_ACCEL | ICM20948_LOG_CH_GYRO)) == 0 ) {
+        fprintf(stderr, "%s: log has no accel or gyro channel\n", path);
+        munmap((void *)map, (size_t)st.st_size);
+        return 1;
+    }
+
+    const uint64_t count = ((uint64_t)st.st_size - ICM20948_LOG_HEADER_SIZE) / frame_size;
+    uint8_t max_taus = 0;
+    uint32_t offset = 0;
+
+    // A cluster of 2^j samples needs at least two clusters in the log
+    while( (max_taus < taus) && (((uint64_t)2 << max_taus) <= count) ) {
+        max_taus++;
+    }
+
+    if( max_taus == 0 ) {
+        fprintf(stderr, "%s: recording too short\n", path);
+        munmap((void *)map, (size_t)st.st_size);
+        return 1;
+    }
+    taus = max_taus;
+
+    log->map = map;
+    log->size = (size_t)st.st_size;
+
+    for( uint8_t ch = 0; ch < 2; ch++ ) {
+        const uint8_t mask = (ch == 0) ? ICM20948_LOG_CH_ACCEL : ICM20948_LOG_CH_GYRO;
+        if( (log->hdr.channels & mask) == 0 ) {
+            continue;
+        }
+
+        for( uint8_t axis = 0; axis < 3; axis++ ) {
+            allan_job_t *job = &log->jobs[log->njobs];
+            job->frames = &map[ICM20948_LOG_HEADER_SIZE];
+            job->count = count;
+            job->frame_size = frame_size;
+            job->offset = offset + (axis * 2);
+            job->taus = taus;
+            job->hist = malloc(sizeof(int64_t) << taus);
+            log->channels[log->njobs] = (ch == 0) ? "accel" : "gyro";
+            log->scales[log->njobs] = (ch == 0) ? (1.0 / icm20948_accelSensitivity(log->hdr.accel_fs)) : (1.0 / icm20948_gyroSensitivity(log->hdr.gyro_fs));
+            log->njobs++;
+        }
+        offset += 6;
+    }
+
+    for( uint8_t i = 0; i < log->njobs; i++ ) {
+        if( (log->jobs[i].hist == NULL) || (pthread_create(&log->threads[i], NULL, allan_worker, &log->jobs[i]) != 0) ) {
+            // Fall back to running the axis on this thread
+            if( log->jobs[i].hist == NULL ) {
+                log->jobs[i].ret = ICM20948_RET_NULL_PTR;
+            }
+            else {
+                allan_worker(&log->jobs[i]);
+            }
+            log->threads[i] = pthread_self();
+        }
+    }
+
+    return 0;
+}
+
+/*!
+ * @brief Waits for every axis of a started log, reports them and releases the log
+ *
+ * @param[in,out] log: Pointer to the log state
+ * @param[in] csv: Print machine readable output
+ *
+ * @return Returns 0 on success
+ */
+static int allan_finish(allan_log_t *log, int csv) {
+    int rc = 0;
+
+    for( uint8_t i = 0; i < log->njobs; i++ ) {
+        if( !pthread_equal(log->threads[i], pthread_self()) ) {
+            pthread_join(log->threads[i], NULL);
+        }
+
+        if( log->jobs[i].ret == ICM20948_RET_OK ) {
+            allan_report(log->path, log->channels[i], (uint8_t)(i % 3), &log->jobs[i], log->hdr.sample_period_us * 1e-6, log->scales[i], csv);
+        }
+        else {
+            fprintf(stderr, "%s: %s %s failed (%d)\n", log->path, log->channels[i], axis_names[i % 3], log->jobs[i].ret);
+            rc = 1;
+        }
+        free(log->jobs[i].hist);
+    }
+
+    if( log->map != NULL ) {
+        munmap((void *)log->map, log->size);
+    }
+    memset(log, 0x00, sizeof(allan_log_t));
+
+    return rc;
+}
+
+int main(int argc, char **argv) {
+    static allan_log_t logs[ALLAN_MAX_OPEN_LOGS];
+    uint8_t taus = ALLAN_DEFAULT_TAUS;
+    int csv = 0;
+    int rc = 0;
+    int opt;
+    char *end;
+    unsigned long value;
+
+    while( (opt = getopt(argc, argv, "t:c")) != -1 ) {
+        switch( opt ) {
+            case 't':
+                errno = 0;
+                value = strtoul(optarg, &end, 10);
+                if( (errno != 0) || (end == optarg) || (*end != '\0') || (value == 0) || (value > ICM20948_ALLAN_MAX_TAUS) ) {
+                    fprintf(stderr, "%s: -t takes 1 to %d\n", argv[0], ICM20948_ALLAN_MAX_TAUS);
+                    return 2;
+                }
+                taus = (uint8_t)value;
+                break;
+
+            case 'c':
+                csv = 1;
+                break;
+
+            default:
+                fprintf(stderr, "usage: %s [-t taus] [-c] log.bin [log.bin ...]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    if( optind >= argc ) {
+        fprintf(stderr, "usage: %s [-t taus] [-c] log.bin [log.bin ...]\n", argv[0]);
+        return 2;
+    }
+
+    if( csv ) {
+        printf("file,channel,axis,kind,tau_or_arw,adev_or_bias,tau_bias,rrw\n");
+    }
+
+    // Keep a window of logs in flight, reporting them in command line order
+    for( int i = optind; i < argc; i++ ) {
+        allan_log_t *log = &logs[(i - optind) % ALLAN_MAX_OPEN_LOGS];
+
+        if( (i - optind) >= ALLAN_MAX_OPEN_LOGS ) {
+            rc |= allan_finish(log, csv);
+        }
+        rc |= allan_start(log, argv[i], taus);
+    }
+
+    for( int i = (argc > (optind + ALLAN_MAX_OPEN_LOGS)) ? (argc - ALLAN_MAX_OPEN_LOGS) : optind; i < argc; i++ ) {
+        rc |= allan_finish(&logs[(i - optind) % ALLAN_MAX_OPEN_LOGS], csv);
+    }
+
+    return rc;
+}
@@ -0,0 +1,481 @@
+/****************************************************************************
+    ICM-20948 9-Axis MEMS Motion Tracking Device Driver
+
+    Copyright (C) 2020 Stephen Murphy - github.com/stephendpmurphy
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+****************************************************************************/
+
+
+
+/*! @file icm20948_bench.c
+ * @brief Host tool benchmarking the driver hot paths against an emulated device.
+ *
+ * Usage: icm20948_bench [-n samples] [-r repeats] [-c | -j]
+ *
+ * The emulator stands in for the developers read/write functions and counts every bus
+ * transaction and the bytes it would clock on the wire, address byte included. Each
+ * benchmark is repeated and the fastest run is reported as ns/sample next to the
+ * transactions/sample and bytes/sample, as a table, CSV (-c) or JSON (-j) for tracking
+ * regressions between builds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "icm20948_api.h"
+#include "icm20948_decim.h"
+#include "icm20948_strapdown.h"
+
+#define BENCH_DEFAULT_SAMPLES               (100000)
+#define BENCH_DEFAULT_REPEATS               (5)
+#define BENCH_BLOCK                         (256)
+#define BENCH_PATTERN_SIZE                  (4096)
+
+#define EMU_WHO_AM_I                        (0xEA)
+#define EMU_ADDR_BANK_SEL                   (0x7F)
+#define EMU_ADDR_FIFO_COUNTH                (0x70)
+#define EMU_ADDR_FIFO_R_W                   (0x72)
+#define EMU_FRAME_SIZE                      (12)
+
+typedef enum {
+    BENCH_FMT_TABLE = 0,
+    BENCH_FMT_CSV,
+    BENCH_FMT_JSON
+} bench_fmt_t;
+
+typedef struct {
+    uint8_t regs[4][128];
+    uint8_t bank;
+    uint8_t pattern[BENCH_PATTERN_SIZE];
+    uint32_t pattern_pos;
+    uint32_t fifo_level;        // Bytes the emulated FIFO reports as available
+    uint64_t xfers;
+    uint64_t bytes;
+} bench_emu_t;
+
+typedef struct {
+    const char *name;
+    uint64_t samples;
+    double ns;
+    double xfers;
+    double bytes;
+} bench_result_t;
+
+typedef struct {
+    int16_t x[BENCH_BLOCK];
+    int16_t y[BENCH_BLOCK];
+    int16_t z[BENCH_BLOCK];
+    icm20948_block_t blk;
+} bench_raw_t;
+
+typedef struct {
+    float x[BENCH_BLOCK];
+    float y[BENCH_BLOCK];
+    float z[BENCH_BLOCK];
+    icm20948_fblock_t blk;
+} bench_float_t;
+
+static bench_emu_t emu;
+static bench_raw_t raw_accel;
+static bench_raw_t raw_gyro;
+
+/*!
+ * @brief Emulated read function counting the transaction
+ */
+static int8_t emu_read(const uint8_t addr, uint8_t *data, const uint32_t len) {
+    const uint8_t reg = addr & 0x7F;
+
+    emu.xfers++;
+    emu.bytes += 1 + len;
+
+    if( (emu.bank == 0) && (reg == EMU_ADDR_FIFO_R_W) ) {
+        for( uint32_t i = 0; i < len; i++ ) {
+            data[i] = emu.pattern[emu.pattern_pos];
+            emu.pattern_pos = (emu.pattern_pos + 1) % BENCH_PATTERN_SIZE;
+        }
+        emu.fifo_level = (len < emu.fifo_level) ? (emu.fifo_level - len) : 0;
+    }
+    else {
+        if( (emu.bank == 0) && (reg == EMU_ADDR_FIFO_COUNTH) ) {
+            emu.regs[0][EMU_ADDR_FIFO_COUNTH] = (uint8_t)(emu.fifo_level >> 8);
+            emu.regs[0][EMU_ADDR_FIFO_COUNTH + 1] = (uint8_t)(emu.fifo_level & 0xFF);
+        }
+        for( uint32_t i = 0; i < len; i++ ) {
+            data[i] = emu.regs[emu.bank][(reg + i) & 0x7F];
+        }
+    }
+
+    return 0;
+}
+
+/*!
+ * @brief Emulated write function counting the transaction
+ */
+static int8_t emu_write(const uint8_t addr, const uint8_t *data, const uint32_t len) {
+    emu.xfers++;
+    emu.bytes += 1 + len;
+
+    if( addr == EMU_ADDR_BANK_SEL ) {
+        emu.bank = (data[0] >> 4) & 0x03;
+    }
+    else {
+        for( uint32_t i = 0; i < len; i++ ) {
+            emu.regs[emu.bank][(addr + i) & 0x7F] = data[i];
+        }
+    }
+
+    return 0;
+}
+
+/*!
+ * @brief Emulated delay, nothing to wait for
+ */
+static void emu_delay(uint32_t period) {
+    (void)period;
+}
+
+/*!
+ * @brief Fill the emulator with a repeatable, noisy sample pattern
+ */
+static void emu_reset(void) {
+    uint32_t lfsr = 0xACE1u;
+
+    memset(&emu, 0x00, sizeof(emu));
+    emu.regs[0][0x00] = EMU_WHO_AM_I;
+
+    for( uint32_t i = 0; i < BENCH_PATTERN_SIZE; i++ ) {
+        lfsr = (lfsr >> 1) ^ (-(lfsr & 1u) & 0xB400u);
+        emu.pattern[i] = (uint8_t)lfsr;
+    }
+
+    // Live output registers hold one frame of the same pattern
+    memcpy(&emu.regs[0][0x2D], emu.pattern, EMU_FRAME_SIZE);
+}
+
+/*!
+ * @brief Monotonic time in ns
+ */
+static uint64_t bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ull) + (uint64_t)ts.tv_nsec;
+}
+
+/*!
+ * @brief Points a raw block at its storage with the full capacity
+ */
+static void bench_raw_reset(bench_raw_t *raw) {
+    raw->blk.x = raw->x;
+    raw->blk.y = raw->y;
+    raw->blk.z = raw->z;
+    raw->blk.len = BENCH_BLOCK;
+}
+
+/*!
+ * @brief Fill the raw blocks once from the pattern for the bus-free benchmarks
+ */
+static void bench_fill_raw(void) {
+    int16_t p[BENCH_BLOCK * 6];
+
+    memcpy(p, emu.pattern, sizeof(p));
+    bench_raw_reset(&raw_accel);
+    bench_raw_reset(&raw_gyro);
+    for( uint32_t i = 0; i < BENCH_BLOCK; i++ ) {
+        raw_accel.x[i] = p[(i * 6) + 0];
+        raw_accel.y[i] = p[(i * 6) + 1];
+        raw_accel.z[i] = p[(i * 6) + 2];
+        raw_gyro.x[i] = p[(i * 6) + 3] / 64;
+        raw_gyro.y[i] = p[(i * 6) + 4] / 64;
+        raw_gyro.z[i] = p[(i * 6) + 5] / 64;
+    }
+}
+
+/*!
+ * @brief Raw accel and gyro register reads with the driver's integer conversion
+ */
+static icm20948_return_code_t bench_read_convert(uint64_t samples) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    icm20948_accel_t accel;
+    icm20948_gyro_t gyro;
+
+    for( uint64_t i = 0; (ret == ICM20948_RET_OK) && (i < samples); i++ ) {
+        ret = icm20948_getAccelData(&accel);
+        if( ret == ICM20948_RET_OK ) {
+            ret = icm20948_getGyroData(&gyro);
+        }
+    }
+
+    return ret;
+}
+
+#if ICM20948_FEATURE_FIFO
+/*!
+ * @brief Drain and parse accel+gyro frames from the FIFO a block at a time
+ */
+static icm20948_return_code_t bench_fifo(uint64_t samples) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint64_t done = 0;
+
+    while( (ret == ICM20948_RET_OK) && (done < samples) ) {
+        emu.fifo_level = BENCH_BLOCK * EMU_FRAME_SIZE;
+        bench_raw_reset(&raw_accel);
+        bench_raw_reset(&raw_gyro);
+
+        ret = icm20948_readFifo(&raw_accel.blk, &raw_gyro.blk);
+        if( (ret == ICM20948_RET_OK) && (raw_accel.blk.len == 0) ) {
+            ret = ICM20948_RET_GEN_FAIL;
+        }
+        done += raw_accel.blk.len;
+    }
+
+    return ret;
+}
+#endif
+
+/*!
+ * @brief Scale and mount accel and gyro blocks
+ */
+static icm20948_return_code_t bench_convert(uint64_t samples) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    static bench_float_t out;
+
+    out.blk.x = out.x;
+    out.blk.y = out.y;
+    out.blk.z = out.z;
+
+    for( uint64_t done = 0; (ret == ICM20948_RET_OK) && (done < samples); done += BENCH_BLOCK ) {
+        out.blk.len = BENCH_BLOCK;
+        ret = icm20948_convertBlock(ICM20948_SENSOR_ACCEL, &raw_accel.blk, &out.blk);
+        if( ret == ICM20948_RET_OK ) {
+            out.blk.len = BENCH_BLOCK;
+            ret = icm20948_convertBlock(ICM20948_SENSOR_GYRO, &raw_gyro.blk, &out.blk);
+        }
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief Third order CIC decimation by 4 of the accel block
+ */
+static icm20948_return_code_t bench_decim(uint64_t samples) {
+    const icm20948_decim_cfg_t cfg = { 3, 2 };
+    icm20948_decim_t dec;
+    int32_t x[BENCH_BLOCK];
+    int32_t y[BENCH_BLOCK];
+    int32_t z[BENCH_BLOCK];
+    icm20948_block32_t out = { x, y, z, 0 };
+    icm20948_return_code_t ret = icm20948_decimInit(&dec, &cfg);
+
+    for( uint64_t done = 0; (ret == ICM20948_RET_OK) && (done < samples); done += BENCH_BLOCK ) {
+        out.len = BENCH_BLOCK;
+        ret = icm20948_decimProcess(&dec, &raw_accel.blk, &out);
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief Coning and sculling strapdown integration with an update every 8 samples
+ */
+static icm20948_return_code_t bench_strapdown(uint64_t samples) {
+    icm20948_strapdown_cfg_t cfg;
+    icm20948_strapdown_t sd;
+    icm20948_strapdown_out_t out[BENCH_BLOCK / 8];
+    icm20948_return_code_t ret;
+
+    memset(&cfg, 0x00, sizeof(cfg));
+    cfg.sample_period = 1.0f / 1125.0f;
+    cfg.decim = 8;
+    cfg.gyro_fs = ICM20948_GYRO_FS_SEL_2000DPS;
+    cfg.accel_fs = ICM20948_ACCEL_FS_SEL_16G;
+    cfg.gravity = 9.80665f;
+    cfg.q0.w = 1.0f;
+
+    ret = icm20948_strapdownInit(&sd, &cfg);
+
+    for( uint64_t done = 0; (ret == ICM20948_RET_OK) && (done < samples); done += BENCH_BLOCK ) {
+        uint32_t count = BENCH_BLOCK / 8;
+        ret = icm20948_strapdownProcess(&sd, &raw_accel.blk, &raw_gyro.blk, out, &count);
+    }
+
+    return ret;
+}
+
+/*!
+ * @brief Runs one benchmark repeatedly, keeping the fastest run
+ *
+ * @param[in] name: Name of the benchmark
+ * @param[in] fn: Benchmark body
+ * @param[in] samples: Samples per run
+ * @param[in] repeats: Number of runs
+ * @param[out] res: Pointer to where the result should be placed
+ *
+ * @return Returns the status of the last run
+ */
+static icm20948_return_code_t bench_run(const char *name, icm20948_return_code_t (*fn)(uint64_t), uint64_t samples, uint32_t repeats, bench_result_t *res) {
+    icm20948_return_code_t ret = ICM20948_RET_OK;
+    uint64_t best = UINT64_MAX;
+
+    res->name = name;
+    res->samples = samples;
+
+    for( uint32_t r = 0; (ret == ICM20948_RET_OK) && (r < repeats); r++ ) {
+        uint64_t xfers = emu.xfers;
+        uint64_t bytes = emu.bytes;
+        uint64_t t0 = bench_now();
+
+        ret = fn(samples);
+
+        uint64_t dt = bench_now() - t0;
+        if( dt < best ) {
+            best = dt;
+        }
+        res->xfers = (double)(emu.xfers - xfers) / (double)samples;
+        res->bytes = (double)(emu.bytes - bytes) / (double)samples;
+    }
+
+    res->ns = (double)best / (double)samples;
+
+    return ret;
+}
+
+/*!
+ * @brief Prints the results in the requested format
+ */
+static void bench_report(const bench_result_t *res, uint32_t count, bench_fmt_t fmt) {
+    switch( fmt ) {
+        case BENCH_FMT_CSV:
+            printf("benchmark,samples,ns_per_sample,xfers_per_sample,bytes_per_sample\n");
+            for( uint32_t i = 0; i < count; i++ ) {
+                printf("%s,%llu,%.3f,%.4f,%.4f\n", res[i].name, (unsigned long long)res[i].samples,
+                       res[i].ns, res[i].xfers, res[i].bytes);
+            }
+            break;
+
+        case BENCH_FMT_JSON:
+            printf("[\n");
+            for( uint32_t i = 0; i < count; i++ ) {
+                printf("  {\"benchmark\": \"%s\", \"samples\": %llu, \"ns_per_sample\": %.3f, "
+                       "\"xfers_per_sample\": %.4f, \"bytes_per_sample\": %.4f}%s\n",
+                       res[i].name, (unsigned long long)res[i].samples, res[i].ns, res[i].xfers,
+                       res[i].bytes, (i + 1 < count) ? "," : "");
+            }
+            printf("]\n");
+            break;
+
+        default:
+            printf("%-16s %12s %12s %12s %12s\n", "benchmark", "samples", "ns/sample", "xfers/sample", "bytes/sample");
+            for( uint32_t i = 0; i < count; i++ ) {
+                printf("%-16s %12llu %12.3f %12.4f %12.4f\n", res[i].name, (unsigned long long)res[i].samples,
+                       res[i].ns, res[i].xfers, res[i].bytes);
+            }
+            break;
+    }
+}
+
+int main(int argc, char **argv) {
+    static const struct {
+        const char *name;
+        icm20948_return_code_t (*fn)(uint64_t);
+    } benches[] = {
+        { "read_convert", bench_read_convert },
+#if ICM20948_FEATURE_FIFO
+        { "fifo_drain", bench_fifo },
+#endif
+        { "convert_block", bench_convert },
+        { "decim_cic3", bench_decim },
+        { "strapdown", bench_strapdown },
+    };
+    const uint32_t count = sizeof(benches) / sizeof(benches[0]);
+    bench_result_t res[sizeof(benches) / sizeof(benches[0])];
+    icm20948_settings_t settings;
+    uint64_t samples = BENCH_DEFAULT_SAMPLES;
+    uint32_t repeats = BENCH_DEFAULT_REPEATS;
+    bench_fmt_t fmt = BENCH_FMT_TABLE;
+    int opt;
+
+    while( (opt = getopt(argc, argv, "n:r:cj")) != -1 ) {
+        switch( opt ) {
+            case 'n':
+                samples = strtoull(optarg, NULL, 0);
+                break;
+
+            case 'r':
+                repeats = (uint32_t)atoi(optarg);
+                break;
+
+            case 'c':
+                fmt = BENCH_FMT_CSV;
+                break;
+
+            case 'j':
+                fmt = BENCH_FMT_JSON;
+                break;
+
+            default:
+                fprintf(stderr, "usage: %s [-n samples] [-r repeats] [-c | -j]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    if( (samples == 0) || (repeats == 0) ) {
+        fprintf(stderr, "usage: %s [-n samples] [-r repeats] [-c | -j]\n", argv[0]);
+        return 2;
+    }
+
+    // Block benchmarks run whole blocks, keep every benchmark on the same count
+    samples = ((samples + BENCH_BLOCK - 1) / BENCH_BLOCK) * BENCH_BLOCK;
+
+    emu_reset();
+    bench_fill_raw();
+
+    memset(&settings, 0x00, sizeof(settings));
+    settings.gyro.en = ICM20948_MOD_ENABLED;
+    settings.gyro.fs = ICM20948_GYRO_FS_SEL_2000DPS;
+    settings.accel.en = ICM20948_MOD_ENABLED;
+    settings.accel.fs = ICM20948_ACCEL_FS_SEL_16G;
+
+    if( (icm20948_init(emu_read, emu_write, emu_delay) != ICM20948_RET_OK) ||
+        (icm20948_applySettings(&settings) != ICM20948_RET_OK) ) {
+        fprintf(stderr, "emulated device failed to come up\n");
+        return 1;
+    }
+
+#if ICM20948_FEATURE_FIFO
+    if( icm20948_enableFifo(ICM20948_MOD_ENABLED, ICM20948_MOD_ENABLED) != ICM20948_RET_OK ) {
+        fprintf(stderr, "emulated FIFO failed to come up\n");
+        return 1;
+    }
+#endif
+
+    for( uint32_t i = 0; i < count; i++ ) {
+        if( bench_run(benches[i].name, benches[i].fn, samples, repeats, &res[i]) != ICM20948_RET_OK ) {
+            fprintf(stderr, "%s failed\n", benches[i].name);
+            return 1;
+        }
+    }
+
+    bench_report(res, count, fmt);
+
+    return 0;
+}